@@ -0,0 +1,96 @@
+#pragma once
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+namespace vm
+{
+/**
+ * @brief Counters of the batches read by a BatchBlockLoader
+ */
+struct BlockLoadStatistics
+{
+	size_t blocks = 0;
+	size_t runs = 0;  // sequential reads issued
+	size_t bytes = 0;
+	double seconds = 0;
+
+	double BandwidthInMB() const { return seconds > 0 ? bytes / seconds / 1024 / 1024 : 0; }
+	BlockLoadStatistics &operator+=( const BlockLoadStatistics &other );
+};
+
+/**
+ * @brief Reads batches of blocks of a block file with few large sequential reads.
+ *
+ * The blocks of a batch are sorted by their file offset and adjacent blocks are coalesced
+ * into runs of at most maxRunBytes. All runs are announced to the kernel with
+ * posix_fadvise( WILLNEED ) before a pool of threads reads them with pread, so the disk
+ * sees the whole batch at once instead of one page fault per block through the mapping.
+ *
+ * The blocks are stored one after another from \a dataOffset on, the HeaderSize() of a
+ * .lvd file. With \a direct the file is opened with O_DIRECT where the file system allows it and runs are read through aligned
+ * staging buffers. Only available on POSIX, Valid() is false elsewhere.
+ */
+class BatchBlockLoader
+{
+public:
+	using Request = std::pair<size_t, void *>;	// block id, destination
+
+	BatchBlockLoader( const std::string &fileName, size_t dataOffset, size_t blockCount, size_t blockBytes,
+					  int threadCount = 4, size_t maxRunBytes = 8 * 1024 * 1024, bool direct = false );
+	~BatchBlockLoader();
+	BatchBlockLoader( const BatchBlockLoader & ) = delete;
+	BatchBlockLoader &operator=( const BatchBlockLoader & ) = delete;
+
+	bool Valid() const { return fd >= 0; }
+
+	/**
+	 * @brief Returns true if the file is read with O_DIRECT, bypassing the page cache
+	 */
+	bool DirectIO() const { return directIO; }
+
+	/**
+	 * @brief Reads all requested blocks, blocks that can not be read are zero filled
+	 */
+	BlockLoadStatistics Load( std::vector<Request> requests );
+
+	const BlockLoadStatistics &Statistics() const { return total; }
+	void ResetStatistics() { total = BlockLoadStatistics(); }
+
+private:
+	struct Extent
+	{
+		size_t first;  // index into the sorted requests
+		size_t count;
+	};
+	void Work();
+	bool ReadExtent( const Extent &extent, std::vector<unsigned char> &staging );
+
+	enum : size_t
+	{
+		Alignment = 4096
+	};
+	int fd = -1;
+	bool directIO = false;
+	size_t blockCount;
+	size_t blockBytes;
+	size_t dataOffset = 0;
+	size_t maxRunBytes;
+	BlockLoadStatistics total;
+
+	std::vector<std::thread> workers;
+	std::mutex mtx;
+	std::condition_variable cond;
+	bool stop = false;
+	size_t generation = 0;
+	std::vector<Request> batch;
+	std::vector<Extent> extents;
+	std::atomic<size_t> nextExtent{ 0 };
+	size_t finishedWorkers = 0;
+};
+
+}  // namespace vm
@@ -0,0 +1,57 @@
+#pragma once
+#include <VMUtils/ref.hpp>
+#include <VMCoreExtension/i3dblockfileplugininterface.h>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace vm
+{
+/**
+ * @brief Warms the blocks that upcoming frames will touch on a background thread.
+ *
+ * Block3DCache is not thread safe, so the prefetcher does not populate the cache directly.
+ * Instead it reads the pages of the requested blocks through the block file so that the
+ * following swap-ins of the render thread hit the OS page cache instead of the disk.
+ */
+class BlockPrefetcher
+{
+	Ref<I3DBlockFilePluginInterface> file;
+	Ref<I3DBlockFilePluginInterface> pendingFile;
+	std::vector<size_t> pending;
+	bool hasPending = false;
+	bool busy = false;
+	bool stop = false;
+	size_t prefetchedBlocks = 0;
+	std::mutex mtx;
+	std::condition_variable cond;
+	std::thread worker;
+
+	void Run();
+
+public:
+	explicit BlockPrefetcher( Ref<I3DBlockFilePluginInterface> file );
+	BlockPrefetcher( const BlockPrefetcher & ) = delete;
+	BlockPrefetcher &operator=( const BlockPrefetcher & ) = delete;
+	~BlockPrefetcher();
+
+	/**
+	 * @brief Schedules the blocks given by their linear ids. A request that has not been
+	 * started yet is replaced since it belongs to a frame that is already outdated.
+	 */
+	void Prefetch( std::vector<size_t> blockIDs );
+	/**
+	 * @brief Same as above for the blocks of another file, e.g. the next timestep of a series
+	 */
+	void Prefetch( Ref<I3DBlockFilePluginInterface> blockFile, std::vector<size_t> blockIDs );
+	/**
+	 * @brief Blocks until the scheduled request has been finished.
+	 */
+	void Wait();
+	/**
+	 * @brief Returns the number of blocks that have been read ahead so far.
+	 */
+	size_t PrefetchedBlockCount();
+};
+}  // namespace vm
@@ -0,0 +1,73 @@
+#pragma once
+#include <VMUtils/json_binding.hpp>
+#include <VMGraphics/camera.h>
+#include <vector>
+#include <string>
+
+namespace vm
+{
+/**
+ * @brief Describes a flythrough.
+ *
+ * \a cameras are .cam keyframes. \a framesPerSegment frames are generated between two
+ * consecutive keyframes, 1 renders the keyframes only. \a output is the image file name
+ * pattern in which "{}" is replaced by the zero-padded frame number.
+ */
+struct CameraPathJSONStruct : json::Serializable<CameraPathJSONStruct>
+{
+	VM_JSON_FIELD( std::vector<std::string>, cameras );
+	VM_JSON_FIELD( int, framesPerSegment );
+	VM_JSON_FIELD( std::string, output );
+};
+
+class CameraPath
+{
+	std::vector<ViewingTransform> keyframes;
+	int framesPerSegment = 1;
+
+public:
+	CameraPath( std::vector<ViewingTransform> keyframes, int framesPerSegment );
+	size_t FrameCount() const;
+	/**
+	 * @brief Returns the camera of the \a frame th frame.
+	 *
+	 * Positions are interpolated linearly between keyframes, the viewing and up directions
+	 * are interpolated linearly and renormalized.
+	 */
+	ViewingTransform Frame( size_t frame ) const;
+};
+
+/**
+ * @brief Loads all the keyframes listed in a camera path json file. Throws on failure.
+ */
+CameraPath LoadCameraPath( const std::string &fileName, std::string &outputPattern );
+
+/**
+ * @brief Describes views rendered together.
+ *
+ * \a cameras are .cam files. \a output is the image file name pattern in which "{}" is
+ * replaced by the zero-padded view number.
+ */
+struct ViewSetJSONStruct : json::Serializable<ViewSetJSONStruct>
+{
+	VM_JSON_FIELD( std::vector<std::string>, cameras );
+	VM_JSON_FIELD( std::string, output );
+};
+
+/**
+ * @brief Loads all the cameras listed in a view set json file. Throws on failure.
+ */
+std::vector<ViewingTransform> LoadViewSet( const std::string &fileName, std::string &outputPattern );
+
+/**
+ * @brief Returns the six cameras looking at \a center from \a distance along +x, -x, +y,
+ * -y, +z and -z
+ */
+std::vector<ViewingTransform> AxisAlignedViews( const Point3f &center, float distance );
+
+/**
+ * @brief Replaces "{}" in \a pattern with \a frame padded to 4 digits.
+ */
+std::string FormatFrameFileName( const std::string &pattern, size_t frame );
+
+}  // namespace vm
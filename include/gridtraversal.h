@@ -0,0 +1,106 @@
+#pragma once
+#include <VMat/geometry.h>
+#include <functional>
+#include <vector>
+
+namespace vm
+{
+/**
+ * @brief Walks the cells of a regular grid along a ray with a 3D-DDA.
+ *
+ * Has the members of RayIntervalIter the render loops use: the ray covers
+ * [Pos, next Pos) in CellIndex, and once Valid() turns false Pos is where it leaves the
+ * grid. The per-axis state lives in small arrays and the next axis is picked by two
+ * compares the compiler turns into conditional moves, so a step has no unpredictable branch.
+ */
+class GridDDA
+{
+public:
+	float Pos = 0, Max = 0;
+	Point3i CellIndex;
+
+	bool Valid() const { return valid; }
+	GridDDA &operator++()
+	{
+		const int a = tNext[ 0 ] < tNext[ 1 ] ? ( tNext[ 0 ] < tNext[ 2 ] ? 0 : 2 ) : ( tNext[ 1 ] < tNext[ 2 ] ? 1 : 2 );
+		Pos = tNext[ a ] < Max ? tNext[ a ] : Max;
+		cell[ a ] += step[ a ];
+		tNext[ a ] += tDelta[ a ];
+		valid = Pos < Max && unsigned( cell[ a ] ) < unsigned( count[ a ] );
+		CellIndex = Point3i( cell[ 0 ], cell[ 1 ], cell[ 2 ] );
+		return *this;
+	}
+
+private:
+	friend class GridTraversal;
+	float tNext[ 3 ];
+	float tDelta[ 3 ];
+	int step[ 3 ];
+	int cell[ 3 ];
+	int count[ 3 ];
+	bool valid = false;
+};
+
+/**
+ * @brief Starts GridDDAs over the grid that divides [lo, hi] into \a cellCount cells, as
+ * Bound3::GenGrid does.
+ *
+ * For a film whose rays leave one eye, PrepareTiles() traces the corner rays of every tile.
+ * When all four enter the grid through the same face of the same cell, so does every ray
+ * between them, and Start() takes the entry cell and the entry plane from the tile instead
+ * of clipping the ray against all slabs and locating its cell.
+ */
+class GridTraversal
+{
+public:
+	/**
+	 * @brief Returns the direction of the ray through pixel ( x, y )
+	 */
+	using PixelDirection = std::function<Vec3f( int x, int y )>;
+
+	GridTraversal( const Point3f &lo, const Point3f &hi, const Vec3i &cellCount );
+
+	/**
+	 * @brief Clips the ray against the grid and locates its first cell
+	 */
+	GridDDA IntersectWith( const Point3f &o, const Vec3f &d ) const;
+
+	/**
+	 * @brief Finds the shared entries of the \a tileSize tiles of a \a width x \a height film
+	 * looking from \a eye
+	 */
+	void PrepareTiles( const Point3f &eye, int width, int height, int tileSize, const PixelDirection &direction );
+
+	/**
+	 * @brief Starts the ray of pixel ( x, y ) from the eye of PrepareTiles() along \a d
+	 */
+	GridDDA Start( int x, int y, const Vec3f &d ) const;
+
+	/**
+	 * @brief Returns the number of prepared tiles whose rays share their entry
+	 */
+	size_t SharedTileCount() const;
+	size_t TileCount() const { return tiles.size(); }
+
+private:
+	struct Entry
+	{
+		bool shared;	 // by the rays of the tile
+		int axis;	 // of the entry plane, -1 if the eye is inside the grid
+		float plane;
+		int cell[ 3 ];
+	};
+	bool Enter( const Point3f &o, const Vec3f &d, Entry &entry, float &tEnter, float &tExit ) const;
+	float Exit( const Point3f &o, const float *invD ) const;
+	void Begin( GridDDA &dda, const Point3f &o, const Vec3f &d, const float *invD, const int *cell, float tEnter, float tExit ) const;
+
+	float lo[ 3 ], hi[ 3 ];
+	float cellSize[ 3 ];
+	int count[ 3 ];
+	Point3f eye;
+	int tileSize = 1;
+	int tilesX = 0;
+	std::vector<Entry> tiles;
+};
+
+}  // namespace vm
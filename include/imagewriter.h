@@ -0,0 +1,84 @@
+#pragma once
+#include <voxelman.h>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace vm
+{
+enum class ImageFormat
+{
+	PNG,
+	PPM,  // binary P6, alpha is dropped
+	QOI,
+	RAW	  // tightly packed RGBA8 without any header
+};
+
+/**
+ * @brief Deduces the image format from the extension of \a fileName, PNG by default.
+ */
+ImageFormat ImageFormatFromFileName( const std::string &fileName );
+
+/**
+ * @brief Encodes and writes \a pixels synchronously. Returns false on failure.
+ */
+bool WriteImage( const std::string &fileName, int width, int height, const Pixel_t *pixels );
+
+/**
+ * @brief Sets the zlib level used for PNG, 1 is the fastest. The setting is global.
+ */
+void SetPNGCompressionLevel( int level );
+
+/**
+ * @brief Encodes images on worker threads so that the render thread can start the next frame
+ * right away.
+ *
+ * The queue is bounded: Submit blocks while \a capacity images are waiting, which caps the
+ * memory held by frames in flight when encoding is slower than rendering.
+ */
+class AsyncImageWriter
+{
+	struct Task
+	{
+		std::string fileName;
+		int width;
+		int height;
+		std::vector<Pixel_t> pixels;
+		std::function<void( bool )> done;
+	};
+
+	std::deque<Task> queue;
+	size_t capacity;
+	size_t running = 0;
+	bool stop = false;
+	std::mutex mtx;
+	std::condition_variable cond;
+	std::vector<std::thread> workers;
+
+	void Run();
+
+public:
+	AsyncImageWriter( int workerCount, size_t capacity );
+	AsyncImageWriter( const AsyncImageWriter & ) = delete;
+	AsyncImageWriter &operator=( const AsyncImageWriter & ) = delete;
+	/**
+	 * @brief Waits for all submitted images to be written
+	 */
+	~AsyncImageWriter();
+
+	/**
+	 * @brief Queues \a pixels to be written into \a fileName. \a done, if any, is called on the
+	 * worker thread with the result.
+	 */
+	void Submit( std::string fileName, int width, int height, std::vector<Pixel_t> pixels,
+				 std::function<void( bool )> done = nullptr );
+	/**
+	 * @brief Blocks until the queue is drained and all workers are idle.
+	 */
+	void Wait();
+};
+}  // namespace vm
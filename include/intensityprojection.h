@@ -0,0 +1,53 @@
+#pragma once
+#include <VMat/geometry.h>
+#include <cstddef>
+#include <string>
+
+namespace vm
+{
+enum class IntensityProjection
+{
+	None,  // front-to-back compositing through the transfer function
+	Maximum,
+	Minimum,
+	Average
+};
+
+/**
+ * @brief Returns the projection named by "mip", "minip" or "aip", None otherwise.
+ */
+IntensityProjection IntensityProjectionFromName( const std::string &name );
+
+/**
+ * @brief The samples a ray has projected so far
+ */
+struct IntensityAccumulator
+{
+	float max = 0, min = 255, sum = 0;
+	size_t count = 0;
+
+	/**
+	 * @brief Returns true if no further sample can change the projection of \a mode
+	 */
+	bool Saturated( IntensityProjection mode ) const;
+	/**
+	 * @brief Returns false if samples within [lo, hi] can not change the projection of \a mode
+	 */
+	bool MayChange( IntensityProjection mode, float lo, float hi ) const;
+	/**
+	 * @brief Returns the projected intensity of \a mode, 0 without samples
+	 */
+	float Value( IntensityProjection mode ) const;
+};
+
+/**
+ * @brief Accumulates the \a count trilinear samples at \a p, \a p + \a delta, ... of a \a side^3
+ * block. Beyond the block its edge voxels repeat instead of reading 0 as the compositing
+ * renderer does, a 0 would be the minimum of every ray that leaves a block.
+ *
+ * Positions are local to the block. Four samples are interpolated and accumulated at a time
+ * with SSE2 when available.
+ */
+void AccumulateSamples( const unsigned char *block, int side, const Point3f &p, const Vec3f &delta, int count, IntensityAccumulator &acc );
+
+}  // namespace vm
@@ -0,0 +1,159 @@
+#pragma once
+#include <batchblockloader.h>
+#include <VMat/geometry.h>
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <fstream>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace vm
+{
+/**
+ * @brief Encodes a block of side^3 floats so that no decoded value is further than
+ * \a tolerance from the original.
+ *
+ * Every voxel is predicted from its seven already decoded neighbours of lower x, y and z
+ * (the Lorenzo predictor, neighbours outside the block count as 0) and the residual is
+ * quantized to a multiple of the largest power of two not above 2 * tolerance, so encoder
+ * and decoder agree on every reconstructed value. Smooth data leaves small integers that are
+ * Rice coded with one parameter per block. Values the quantizer can not bring within
+ * \a tolerance, such as NaN, infinities or huge jumps, are stored verbatim.
+ * Returns the number of bytes appended to \a dst.
+ */
+size_t EncodeFloatBlock( const float *src, size_t side, float tolerance, std::vector<unsigned char> &dst );
+
+/**
+ * @brief Decodes \a bytes of a block encoded with the same \a side and \a tolerance into
+ * \a dst. Returns false if the data is truncated.
+ */
+bool DecodeFloatBlock( const unsigned char *src, size_t bytes, size_t side, float tolerance, float *dst );
+
+/**
+ * @brief A float32 .lvd file of lossy compressed blocks.
+ *
+ * The header records compression FixedAccuracy and its errorBound. The encoded blocks
+ * follow the header in block order, and the block table at the header's blockIndexOffset
+ * locates them:
+ *
+ *   uint32 magic, uint32 0, uint64 block count, uint64 offset[ block count + 1 ]
+ *
+ * with offsets relative to the first block. Load() reads and decodes a batch of blocks on
+ * a pool of worker threads, so decoding overlaps with reading when blocks are swapped in.
+ *
+ * The renderer does not read these files, it samples 8-bit volumes through the .lvd plugin.
+ * The reader and CompressedLVDWriter serve the codec's tests and codec_perf.
+ */
+class CompressedLVDFile
+{
+public:
+	enum : uint32_t
+	{
+		TableMagicNumber = 0x5a44564c  // "LVDZ"
+	};
+	using Request = BatchBlockLoader::Request;	// block id, side^3 floats
+
+	explicit CompressedLVDFile( const std::string &fileName, int threadCount = 4 );
+	~CompressedLVDFile();
+	CompressedLVDFile( const CompressedLVDFile & ) = delete;
+	CompressedLVDFile &operator=( const CompressedLVDFile & ) = delete;
+
+	bool Valid() const { return valid; }
+	const std::string &Error() const { return error; }
+
+	size_t BlockCount() const { return offsets.empty() ? 0 : offsets.size() - 1; }
+	size_t BlockSide() const { return side; }
+	/**
+	 * @brief Returns the size of a decoded block
+	 */
+	size_t BlockBytes() const { return side * side * side * sizeof( float ); }
+	float ErrorBound() const { return tolerance; }
+	size_t CompressedBytes( size_t blockID ) const { return offsets[ blockID + 1 ] - offsets[ blockID ]; }
+	size_t CompressedBytes() const { return offsets.empty() ? 0 : offsets.back(); }
+
+	/**
+	 * @brief Reads and decodes one block on the calling thread
+	 */
+	bool ReadBlock( size_t blockID, float *dst ) const;
+
+	/**
+	 * @brief Reads and decodes all requested blocks on the worker threads. Blocks that can
+	 * not be read are zero filled. The bytes of the statistics are those read from disk.
+	 */
+	BlockLoadStatistics Load( std::vector<Request> requests );
+
+	const BlockLoadStatistics &Statistics() const { return total; }
+	/**
+	 * @brief Returns the thread time spent decoding, summed over the workers
+	 */
+	double DecodeSeconds() const { return decodeNanoseconds.load() * 1e-9; }
+
+private:
+	void Work();
+	bool Read( size_t blockID, float *dst, std::vector<unsigned char> &staging ) const;
+
+	int fd = -1;
+	bool valid = false;
+	std::string error;
+	size_t side = 0;
+	float tolerance = 0;
+	size_t dataOffset = 0;
+	std::vector<uint64_t> offsets;
+	BlockLoadStatistics total;
+	mutable std::atomic<uint64_t> decodeNanoseconds{ 0 };
+
+	std::vector<std::thread> workers;
+	std::mutex mtx;
+	std::condition_variable cond;
+	bool stop = false;
+	size_t generation = 0;
+	std::vector<Request> batch;
+	std::atomic<size_t> nextRequest{ 0 };
+	size_t finishedWorkers = 0;
+};
+
+/**
+ * @brief Writes a CompressedLVDFile block by block, in block order.
+ */
+class CompressedLVDWriter
+{
+public:
+	/**
+	 * @brief \a blockDim blocks of 2^blockSideInLog voxels with \a padding, of which the
+	 * volume without padding is \a originalDataSize, coded within \a tolerance
+	 */
+	CompressedLVDWriter( const std::string &fileName, int blockSideInLog, int padding,
+						 const Size3 &blockDim, const Size3 &originalDataSize, float tolerance );
+	~CompressedLVDWriter();
+	CompressedLVDWriter( const CompressedLVDWriter & ) = delete;
+	CompressedLVDWriter &operator=( const CompressedLVDWriter & ) = delete;
+
+	bool Valid() const { return valid; }
+
+	/**
+	 * @brief Encodes and appends the next block, returns its compressed size
+	 */
+	size_t AddBlock( const float *block );
+
+	/**
+	 * @brief Writes the block table and the header, returns false unless every block was added
+	 */
+	bool Close();
+
+private:
+	std::ofstream out;
+	bool valid = false;
+	int blockSideInLog;
+	int padding;
+	Size3 blockDim;
+	Size3 originalDataSize;
+	float tolerance;
+	size_t headerBytes;
+	std::vector<uint64_t> offsets;
+	std::vector<unsigned char> encoded;
+};
+
+}  // namespace vm
@@ -0,0 +1,144 @@
+#pragma once
+#include <VMat/geometry.h>
+#include <cstdint>
+#include <fstream>
+#include <functional>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace vm
+{
+/**
+ * @brief A time series of volumes in one .lvts file, storing every distinct block once.
+ *
+ * The file is a versioned .lvd file whose header describes the volume of one timestep.
+ * The blocks are stored as slots behind the header, and the block index table at the
+ * header's blockIndexOffset maps (timestep, block) to the slot holding its data (see
+ * LVDBlockIndex). A single volume with many identical blocks, such as a label volume,
+ * is a series of one timestep. The .lvd plugin resolves blocks through the index too, so
+ * the file opens as an ordinary volume showing the first timestep.
+ *
+ * Readers key their caches by slot, so identical blocks share one page, and a block that
+ * did not change between timesteps stays resident when stepping through time.
+ */
+class LVDTimeSeriesFile
+{
+public:
+	explicit LVDTimeSeriesFile( const std::string &fileName );
+	~LVDTimeSeriesFile();
+	LVDTimeSeriesFile( const LVDTimeSeriesFile & ) = delete;
+	LVDTimeSeriesFile &operator=( const LVDTimeSeriesFile & ) = delete;
+
+	bool Valid() const { return valid; }
+	const std::string &Error() const { return error; }
+
+	size_t TimestepCount() const { return timestepCount; }
+	size_t BlockCount() const { return blockCount; }
+	size_t SlotCount() const { return slotCount; }
+	size_t BlockBytes() const { return blockBytes; }
+	/**
+	 * @brief Returns the file offset of slot 0
+	 */
+	size_t DataOffset() const { return dataOffset; }
+
+	size_t Slot( size_t timestep, size_t blockID ) const { return slots[ timestep * blockCount + blockID ]; }
+
+	/**
+	 * @brief Returns the number of slots first used by \a timestep
+	 */
+	size_t StoredBlockCount( size_t timestep ) const;
+
+	/**
+	 * @brief Reads the block stored in \a slot, returns false if it can not be read
+	 */
+	bool ReadSlot( size_t slot, void *dst ) const;
+
+	/**
+	 * @brief Asks the kernel to read the slots ahead
+	 */
+	void Prefetch( const std::vector<size_t> &slotIDs ) const;
+
+private:
+	int fd = -1;
+	std::string error;
+	bool valid = false;
+	size_t timestepCount = 0;
+	size_t blockCount = 0;
+	size_t slotCount = 0;
+	size_t blockBytes = 0;
+	size_t dataOffset = 0;
+	std::vector<uint32_t> slots;
+};
+
+/**
+ * @brief Writes a .lvts file timestep by timestep.
+ *
+ * Every block is hashed. A block whose hash matches a stored slot is compared byte by
+ * byte against it and, if equal, refers to that slot instead of being appended. The same
+ * block of the previous timestep is tried first, any other stored block is found through
+ * a hash table. Close() writes the index table.
+ */
+class LVDTimeSeriesWriter
+{
+public:
+	using BlockGetter = std::function<const void *( size_t blockID )>;
+
+	/**
+	 * @brief \a blockDim blocks of 2^blockSideInLog voxels with \a padding, of which the
+	 * volume without padding is \a originalDataSize
+	 */
+	LVDTimeSeriesWriter( const std::string &fileName, int blockSideInLog, int padding,
+						 const Size3 &blockDim, const Size3 &originalDataSize );
+	~LVDTimeSeriesWriter();
+	LVDTimeSeriesWriter( const LVDTimeSeriesWriter & ) = delete;
+	LVDTimeSeriesWriter &operator=( const LVDTimeSeriesWriter & ) = delete;
+
+	bool Valid() const { return valid; }
+
+	/**
+	 * @brief Appends the next timestep, returns the number of blocks stored for it
+	 */
+	size_t AddTimestep( const BlockGetter &getBlock );
+
+	/**
+	 * @brief Writes the index table and the header, returns false if the file is incomplete
+	 */
+	bool Close();
+
+	size_t SlotCount() const { return slotCount; }
+
+private:
+	std::fstream out;
+	std::string fileName;
+	bool valid = false;
+	int blockSideInLog;
+	int padding;
+	Size3 blockDim;
+	Size3 originalDataSize;
+	size_t blockCount;
+	size_t blockBytes;
+	size_t headerBytes;
+	size_t slotCount = 0;
+	size_t timestepCount = 0;
+	std::vector<uint32_t> slots;
+	std::vector<uint64_t> hashes;  // of the previous timestep
+	std::unordered_map<uint64_t, std::vector<uint32_t>> slotsByHash;
+	std::vector<unsigned char> stored;
+
+	enum : size_t
+	{
+		NoSlot = ~size_t( 0 )
+	};
+	/**
+	 * @brief Returns the stored slot equal to \a data or NoSlot
+	 */
+	size_t FindSlot( uint64_t hash, const unsigned char *data );
+};
+
+/**
+ * @brief Hashes a block for change detection, not for security
+ */
+uint64_t HashBlock( const void *data, size_t bytes );
+
+}  // namespace vm
@@ -0,0 +1,117 @@
+#pragma once
+#include <VMat/geometry.h>
+#include <cstdint>
+#include <functional>
+#include <vector>
+
+namespace vm
+{
+/**
+ * @brief A min/max pyramid over the bricks of an 8 bit block volume for empty-space skipping.
+ *
+ * Level 0 splits every block of \a blockSide voxels into bricks of \a brickSide voxels and
+ * records the value range the trilinear sampler can return inside each brick: the brick's
+ * voxels and the next voxel along every axis, or 0 where that voxel lies beyond the block.
+ * Each higher level halves the brick grid along every axis, the node of level
+ * log2( blockSide / brickSide ) covers exactly one block.
+ *
+ * The ranges are built once, on \a threadCount threads reading disjoint blocks. Classify()
+ * marks the nodes whose range maps to zero opacity as empty without reading voxels. Nodes
+ * are grouped by their [min, max] range, which a prefix sum over the opacity tests in O(1),
+ * and a later Classify() only revisits the ranges that overlap values whose visibility
+ * changed, so moving one peak of the transfer function touches the nodes around it.
+ * Positions are voxel coordinates of the block grid, as the renderer samples them.
+ */
+class MinMaxOctree
+{
+public:
+	/**
+	 * @brief Copies the block into \a page, called concurrently for different blocks
+	 */
+	using BlockLoader = std::function<bool( size_t blockID, void *page )>;
+
+	MinMaxOctree( const BlockLoader &loadBlock, const Vec3i &gridCount, int blockSide, int brickSide, int threadCount );
+
+	/**
+	 * @brief Returns false if a block could not be loaded, its bricks then count as visible
+	 */
+	bool Valid() const { return valid; }
+	int LevelCount() const { return int( levels.size() ); }
+	/**
+	 * @brief Returns the number of nodes of \a level along every axis
+	 */
+	const Vec3i &LevelSize( int level ) const { return levels[ level ].size; }
+	int BrickSide() const { return brickSide; }
+	size_t NodeCount() const;
+	double BuildSeconds() const { return buildSeconds; }
+
+	uint8_t Min( int level, const Point3i &node ) const { return range[ 2 * Index( level, node ) ]; }
+	uint8_t Max( int level, const Point3i &node ) const { return range[ 2 * Index( level, node ) + 1 ]; }
+	bool Empty( int level, const Point3i &node ) const { return empty[ Index( level, node ) ] != 0; }
+
+	/**
+	 * @brief Marks the nodes whose values all have zero opacity in \a transferFunction,
+	 * 256 RGBA entries. Returns the number of nodes whose classification changed.
+	 */
+	size_t Classify( const float *transferFunction );
+	/**
+	 * @brief Returns the number of distinct [min, max] ranges of the nodes
+	 */
+	size_t RangeCount() const { return ranges.size(); }
+
+	/**
+	 * @brief Returns true if no sample of the block \a cell is visible
+	 */
+	bool BlockEmpty( const Point3i &cell ) const { return Empty( blockLevel, cell ); }
+	/**
+	 * @brief Returns the range of the samples of the block \a cell, whatever the transfer function
+	 */
+	uint8_t BlockMin( const Point3i &cell ) const { return Min( blockLevel, cell ); }
+	uint8_t BlockMax( const Point3i &cell ) const { return Max( blockLevel, cell ); }
+
+	/**
+	 * @brief Looks up the largest empty node containing o + t * d.
+	 *
+	 * Returns true and the parameter where the ray leaves that node in \a exit. Otherwise
+	 * returns false and the parameter where the ray leaves the visible brick containing the
+	 * point, before which no other lookup can succeed.
+	 */
+	bool SkipEmpty( const Point3f &o, const Vec3f &d, float t, float &exit ) const;
+
+private:
+	struct Level
+	{
+		Vec3i size;
+		size_t offset;	// of the first node
+	};
+	struct Range
+	{
+		uint8_t min, max;
+		bool empty;
+		uint32_t firstNode;	 // into rangeNodes
+	};
+
+	size_t Index( int level, const Point3i &node ) const
+	{
+		const auto &l = levels[ level ];
+		return l.offset + ( size_t( node.z ) * l.size.y + node.y ) * l.size.x + node.x;
+	}
+	void BuildBlock( const uint8_t *block, const Point3i &cell );
+	void GroupRanges();
+	float ExitOf( int level, const Point3i &node, const Point3f &o, const Vec3f &d, float t ) const;
+
+	std::vector<Level> levels;
+	std::vector<uint8_t> range;	 // min, max of every node
+	std::vector<uint8_t> empty;
+	std::vector<Range> ranges;
+	std::vector<uint32_t> rangeNodes;  // nodes grouped by range
+	bool classified = false;
+	bool visible[ 256 ];  // nonzero opacity of the last classification
+	int blockSide;
+	int brickSide;
+	int blockLevel = 0;
+	bool valid = true;
+	double buildSeconds = 0;
+};
+
+}  // namespace vm
@@ -0,0 +1,75 @@
+#pragma once
+#include <VMat/geometry.h>
+#include <VMat/transformation.h>
+#include <vector>
+
+namespace vm
+{
+/**
+ * @brief A coarse screen-space opacity buffer that the next frame culls against.
+ *
+ * While a frame renders, every pixel records the distance from the eye at which its ray
+ * became opaque, or infinity if it never did. A tile keeps the largest distance of its
+ * pixels, so anything behind that distance is hidden in the whole tile. EndFrame()
+ * publishes the tiles together with the camera of the frame, and the next frame asks which
+ * blocks were hidden before it renders. The answer is a hint for prefetching and cache
+ * replacement only, rays still page in every block they reach.
+ */
+class OcclusionBuffer
+{
+public:
+	explicit OcclusionBuffer( int tileSize = 8 );
+
+	/**
+	 * @brief Starts recording a film of \a width x \a height pixels
+	 */
+	void BeginFrame( int width, int height );
+	/**
+	 * @brief Records the distance at which the ray of the pixel became opaque
+	 */
+	void Record( int x, int y, float depth );
+	/**
+	 * @brief Publishes the recorded frame seen through \a worldToScreen from \a eye looking
+	 * along \a front
+	 */
+	void EndFrame( const Transform &worldToScreen, const Point3f &eye, const Vec3f &front );
+
+	/**
+	 * @brief Returns true once a frame has been published
+	 */
+	bool Valid() const { return valid; }
+	const Transform &WorldToScreen() const { return worldToScreen; }
+	const Point3f &Eye() const { return eye; }
+	const Vec3f &Front() const { return front; }
+
+	/**
+	 * @brief Returns true if every tile of the published frame overlapping the screen
+	 * rectangle [x0, x1] x [y0, y1] turned opaque closer than \a depth. A rectangle off the
+	 * film is not occluded.
+	 */
+	bool Occluded( float x0, float y0, float x1, float y1, float depth ) const;
+
+	/**
+	 * @brief Returns true if the box [lo, hi] of world space lies behind the opaque tiles
+	 * of the published frame. Boxes reaching behind its eye are not occluded.
+	 */
+	bool Occluded( const Point3f &lo, const Point3f &hi ) const;
+
+	/**
+	 * @brief Returns the share of tiles of the published frame that are opaque at all
+	 */
+	double OpaqueTileRatio() const;
+
+private:
+	int tileSize;
+	int width = 0, height = 0;
+	int tilesX = 0, tilesY = 0;
+	std::vector<float> recording;
+	std::vector<float> published;
+	Transform worldToScreen;
+	Point3f eye;
+	Vec3f front;
+	bool valid = false;
+};
+
+}  // namespace vm
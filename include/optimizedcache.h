@@ -10,9 +10,18 @@ public:
 	MortonCodeCache( IRefCnt *cnt, I3DBlockDataInterface *pageFile ) :
 	  Block3DCache( cnt, pageFile ) {}
 
+	/**
+	 * @brief Returns the number of pages swapped in, i.e. the number of cache misses
+	 */
+	size_t SwapInCount() const { return swapInCount; }
+	void ResetStatistics() { swapInCount = 0; }
+
 protected:
 	void PageSwapIn_Implement( void *currentLevelPage, const void *nextLevelPage ) override final;
 	void PageSwapOut_Implement( void *nextLevelPage, const void *currentLevel ) override final;
 	void PageWrite_Implement( void *currentLevelPage, const void *userData ) override final;
+
+private:
+	size_t swapInCount = 0;
 };
 }  // namespace vm
\ No newline at end of file
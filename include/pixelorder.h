@@ -0,0 +1,36 @@
+#pragma once
+#include <VMat/geometry.h>
+#include <string>
+#include <vector>
+
+namespace vm
+{
+/**
+ * @brief The order in which the pixels of the film are traced.
+ *
+ * Rays of neighboring pixels walk almost the same blocks. Tracing them one after another
+ * keeps those blocks resident instead of sweeping the whole width of the film in between.
+ */
+enum class PixelOrder
+{
+	RowMajor,
+	Morton,
+	Hilbert
+};
+
+/**
+ * @brief Returns the order named by "rowmajor", "morton" or "hilbert", RowMajor otherwise.
+ */
+PixelOrder PixelOrderFromName( const std::string &name );
+const char *PixelOrderName( PixelOrder order );
+
+/**
+ * @brief Returns all pixels of a \a width x \a height film.
+ *
+ * The film is split into \a tileSize x \a tileSize tiles visited in row-major order and
+ * the pixels inside a tile follow the space filling curve given by \a order. \a tileSize
+ * is rounded up to a power of 2. Pixels outside of the film are skipped.
+ */
+std::vector<Vec2i> GeneratePixelOrder( int width, int height, PixelOrder order, int tileSize );
+
+}  // namespace vm
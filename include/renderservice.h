@@ -0,0 +1,70 @@
+#pragma once
+#include <VMat/geometry.h>
+#include <memory>
+#include <string>
+
+namespace vm
+{
+/**
+ * @brief A single render request handled by the headless service mode.
+ *
+ * A job is described by one line of text of whitespace separated key=value pairs, e.g.
+ *
+ *     cam=front.cam tf=nucleon out=front.png width=1920 height=1080
+ *
+ * Absent keys keep the state left by the previous job so that a stream of jobs
+ * only needs to carry what actually changes.
+ */
+struct RenderJob
+{
+	std::string CameraFileName;
+	std::string TFName;	 // a preset name or a .tf file
+	std::string OutputFileName;
+	Vec2i FilmSize = { 0, 0 };
+	bool Quit = false;
+};
+
+/**
+ * @brief Parses a job line. Returns false and fills \a error if the line is malformed.
+ *
+ * An empty line or a line starting with '#' yields a job with empty output file name.
+ * The line "quit" yields a job with \a Quit set.
+ */
+bool ParseRenderJob( const std::string &line, RenderJob &job, std::string &error );
+
+/**
+ * @brief Line oriented channel from which the service reads jobs and to which it replies.
+ */
+class IRenderJobChannel
+{
+public:
+	virtual ~IRenderJobChannel() = default;
+	/**
+	 * @brief Blocks until a line is available. Returns false when the channel is closed.
+	 */
+	virtual bool ReadLine( std::string &line ) = 0;
+	/**
+	 * @brief Returns the id of the client the last line was read from
+	 */
+	virtual size_t Client() const { return 0; }
+	/**
+	 * @brief Replies to \a client, the reply is dropped if the client has gone. May be called
+	 * from other threads while ReadLine() blocks.
+	 */
+	virtual void ReplyTo( size_t client, const std::string &line ) = 0;
+	/**
+	 * @brief Replies to the client of the last line
+	 */
+	void Reply( const std::string &line ) { ReplyTo( Client(), line ); }
+};
+
+/**
+ * @brief Opens the job channel described by \a endpoint.
+ *
+ * "-" reads from stdin and replies to stdout. Any other value is treated as the path of
+ * a local (unix domain) socket that is created and listened on; clients are served one after
+ * another. Returns nullptr if the endpoint can not be opened.
+ */
+std::unique_ptr<IRenderJobChannel> OpenRenderJobChannel( const std::string &endpoint );
+
+}  // namespace vm
@@ -0,0 +1,44 @@
+#pragma once
+#include <functional>
+#include <vector>
+
+namespace vm
+{
+/**
+ * @brief Block pointers straight into the mapping of a volume that fits in memory.
+ *
+ * Block3DCache copies every block it swaps in from the mapping of the file into one of its
+ * own pages, so a resident volume is held twice. The table keeps the pointers returned by
+ * the file instead and the sampler reads the mapping directly.
+ *
+ * With \a populate the mapped range is faulted in up front (MADV_POPULATE_READ where the
+ * kernel has it, MADV_WILLNEED otherwise) and with \a lock it is also pinned with mlock.
+ * Only valid for files whose GetPage returns stable pointers, such as mapped .lvd files.
+ */
+class ResidentBlockTable
+{
+public:
+	using PageGetter = std::function<const void *( size_t blockID )>;
+
+	ResidentBlockTable( const PageGetter &getPage, size_t blockCount, size_t blockBytes, bool populate, bool lock );
+	~ResidentBlockTable();
+	ResidentBlockTable( const ResidentBlockTable & ) = delete;
+	ResidentBlockTable &operator=( const ResidentBlockTable & ) = delete;
+
+	/**
+	 * @brief Returns false if a block has no pointer
+	 */
+	bool Valid() const { return valid; }
+	bool Locked() const { return locked; }
+	const void *GetPage( size_t blockID ) const { return blocks[ blockID ]; }
+	size_t BlockCount() const { return blocks.size(); }
+
+private:
+	std::vector<const void *> blocks;
+	const char *rangeBegin = nullptr;
+	size_t rangeBytes = 0;
+	bool valid = true;
+	bool locked = false;
+};
+
+}  // namespace vm
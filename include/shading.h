@@ -0,0 +1,135 @@
+#pragma once
+#include <VMat/geometry.h>
+#include <cstdint>
+#include <functional>
+#include <list>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace vm
+{
+enum class ShadingModel
+{
+	None,  // emission-absorption only
+	Phong,
+	BlinnPhong
+};
+
+/**
+ * @brief Returns the model named by "phong" or "blinn", None otherwise.
+ */
+ShadingModel ShadingModelFromName( const std::string &name );
+
+/**
+ * @brief Same terms as PhongShadingEx in blockraycasting_f.glsl
+ */
+struct ShadingParams
+{
+	float ka = 0.1f;
+	float kd = 1.0f;
+	float ks = 0.1f;
+	float shininess = 16.0f;
+};
+
+/**
+ * @brief Shades \a diffuse with a light from \a L seen from \a V.
+ *
+ * The normal is the negated \a gradient. None of the vectors need to be normalized.
+ * A zero gradient (homogeneous region) has no surface to light and returns \a diffuse as is.
+ */
+Vec3f Shade( ShadingModel model, const ShadingParams &params, const Vec3f &diffuse,
+			 const Vec3f &gradient, const Vec3f &L, const Vec3f &V );
+
+/**
+ * @brief Estimates the gradient at \a sp by central differences of six trilinear samples,
+ * as the ILLUMINATION path of the shader does. The unit is value per voxel.
+ */
+Vec3f EstimateGradient( const unsigned char *block, int side, const Point3f &sp );
+
+inline size_t GradientPageBytes( int side ) { return 3 * size_t( side ) * side * side; }
+
+/**
+ * @brief Precomputes the central differences of all voxels of a \a side^3 block.
+ *
+ * The result is stored as three int8 planes (x, y, z) of half differences so that
+ * \a gradientPage must hold GradientPageBytes( side ) bytes. Rows are processed 16 voxels
+ * at a time with SSE2 when available.
+ */
+void ComputeGradientPage( const unsigned char *block, int side, int8_t *gradientPage );
+
+/**
+ * @brief Trilinear interpolation of a precomputed gradient page at \a sp, in the unit of
+ * EstimateGradient
+ */
+Vec3f SampleGradientPage( const int8_t *gradientPage, int side, const Point3f &sp );
+
+/**
+ * @brief Returns the gradient sidecar of a volume file, e.g. foo.grad.lvd for foo.lvd
+ *
+ * The sidecar is an .lvd file with the block side and padding of the volume and three times
+ * as many blocks along z. Component c of block i is stored in block i + c * blockCount as
+ * the half differences of ComputeGradientPage biased by 128.
+ */
+std::string GradientSidecarFileName( const std::string &fileName );
+
+/**
+ * @brief Converts between the signed planes of a gradient page and the unsigned bytes
+ * of a sidecar block. The conversion is its own inverse.
+ */
+void ToggleGradientBias( const void *src, void *dst, size_t bytes );
+
+/**
+ * @brief LRU cache of gradient pages indexed by the same block ids as the scalar cache.
+ *
+ * A page is read by the page loader or, if there is none or it fails, computed from the
+ * scalar block the first time it is requested and then kept until it becomes the least
+ * recently used one.
+ */
+class GradientCache
+{
+public:
+	using PageLoader = std::function<bool( size_t blockID, int8_t *page )>;
+
+private:
+	int side;
+	size_t capacity;
+	std::vector<int8_t> pool;
+	std::list<std::pair<size_t, size_t>> lru;  // (block id, slot), most recent first
+	std::unordered_map<size_t, std::list<std::pair<size_t, size_t>>::iterator> index;
+	size_t hits = 0;
+	size_t misses = 0;
+	PageLoader loader;
+
+public:
+	GradientCache( int blockSide, size_t capacityInPages );
+	void SetPageLoader( PageLoader pageLoader ) { loader = std::move( pageLoader ); }
+	const int8_t *GetPage( size_t blockID, const unsigned char *block );
+	void Clear();
+	size_t HitCount() const { return hits; }
+	size_t MissCount() const { return misses; }
+};
+
+/**
+ * @brief Per-operation costs in seconds used to decide between estimating gradients on the
+ * fly and caching gradient pages.
+ *
+ * On the fly every sample pays otfPerSample. With a cache every sample pays cachedPerSample
+ * and every page miss pays precomputePerVoxel * side^3, so caching wins once a page serves
+ * more than BreakEvenSamplesPerPage samples before it is evicted.
+ */
+struct GradientCostModel
+{
+	double otfPerSample = 0;
+	double cachedPerSample = 0;
+	double precomputePerVoxel = 0;
+
+	double BreakEvenSamplesPerPage( int side ) const;
+};
+
+/**
+ * @brief Measures the cost model on a synthetic \a side^3 block with \a samples random samples
+ */
+GradientCostModel MeasureGradientCostModel( int side, int samples );
+
+}  // namespace vm
@@ -0,0 +1,81 @@
+#pragma once
+#include <VMat/geometry.h>
+#include <cstdint>
+#include <functional>
+#include <vector>
+
+namespace vm
+{
+/**
+ * @brief A planar grid of samples, pixel ( x, y ) lies at origin + u * x + v * y in voxel
+ * coordinates of the block grid
+ */
+struct SlicePlane
+{
+	Point3f origin;
+	Vec3f u, v;
+	int width = 0, height = 0;
+};
+
+/**
+ * @brief Returns the slice at \a position along \a axis of a volume of \a size voxels, one
+ * pixel per voxel. Its pixels run along y and z for x, x and z for y, x and y for z.
+ */
+SlicePlane AxisAlignedSlice( int axis, float position, const Vec3i &size );
+
+/**
+ * @brief Returns the \a width x \a height slice centered at \a center spanned by \a right and
+ * \a up with \a spacing voxels between pixels. Rows run downwards as in an image.
+ */
+SlicePlane ObliqueSlice( const Point3f &center, const Vec3f &right, const Vec3f &up, int width, int height, float spacing );
+
+/**
+ * @brief Resamples planar slices of an 8 bit block volume, touching only the blocks the
+ * slice passes through.
+ *
+ * Every pixel row of a slice crosses the blocks in runs, the runs are grouped by block and
+ * \a threadCount threads each take a block, copy it and resample all its runs. A sample
+ * is interpolated inside the block holding its voxel, repeating the edge voxels of the
+ * block beyond its upper faces. Slices whose pixels lie on voxels are copied without interpolation,
+ * other slices are interpolated four pixels at a time where SSE2 is available.
+ */
+class SliceExtractor
+{
+public:
+	/**
+	 * @brief Returns the page of the block, nullptr if it can not be fetched. Calls are
+	 * serialized and the page is copied before the next call, so it may be evicted by then.
+	 */
+	using BlockFetcher = std::function<const void *( size_t blockID )>;
+
+	SliceExtractor( const BlockFetcher &fetchBlock, const Vec3i &gridCount, int blockSide, int threadCount );
+
+	/**
+	 * @brief Writes the plane.width x plane.height samples of the plane into \a slice, 0
+	 * outside the block grid or where a block could not be fetched
+	 */
+	void Extract( const SlicePlane &plane, uint8_t *slice );
+
+	/**
+	 * @brief Returns the number of blocks the last Extract() fetched
+	 */
+	size_t FetchedBlockCount() const { return fetched; }
+
+private:
+	struct Run
+	{
+		size_t block;
+		int y, x0, x1;	// pixels [x0, x1) of row y
+	};
+	void CollectRuns( const SlicePlane &plane );
+	void Resample( const SlicePlane &plane, const uint8_t *page, const Run &run, bool onVoxels, uint8_t *slice ) const;
+
+	BlockFetcher fetchBlock;
+	Vec3i gridCount;
+	int blockSide;
+	int threadCount;
+	std::vector<Run> runs;
+	size_t fetched = 0;
+};
+
+}  // namespace vm
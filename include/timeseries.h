@@ -0,0 +1,58 @@
+#pragma once
+#include <VMUtils/json_binding.hpp>
+#include <vector>
+#include <string>
+
+namespace vm
+{
+/**
+ * @brief Describes a time-varying volume.
+ *
+ * \a fileNames are the volumes of the timesteps in order, all with the same size and block
+ * layout. \a fps is the target playback rate. \a output is the image file name pattern of
+ * offscreen playback in which "{}" is replaced by the zero-padded timestep.
+ */
+struct TimeSeriesJSONStruct : json::Serializable<TimeSeriesJSONStruct>
+{
+	VM_JSON_FIELD( std::vector<std::string>, fileNames );
+	VM_JSON_FIELD( float, fps );
+	VM_JSON_FIELD( std::string, output );
+};
+
+/**
+ * @brief Loads the timesteps listed in a time series json file. Throws on failure.
+ */
+std::vector<std::string> LoadTimeSeries( const std::string &fileName, float &fps, std::string &outputPattern );
+
+/**
+ * @brief Keeps the playback of a time series at its target frame rate.
+ *
+ * The render time of a frame is roughly inversely proportional to the sampling step, so
+ * after a frame over budget the step is raised right away to what would have fit in 90% of
+ * the budget, and after a frame under budget it creeps back towards \a baseStep. Only once
+ * the step is at \a maxStepScale times \a baseStep and frames still miss the budget are
+ * timesteps skipped to keep up with the wall clock.
+ */
+class FrameRateController
+{
+	double targetSeconds;
+	float baseStep;
+	float maxStep;
+	float step;
+
+public:
+	FrameRateController( double targetSeconds, float baseStep, float maxStepScale = 8 );
+
+	/**
+	 * @brief Returns the sampling step for the next frame
+	 */
+	float Step() const { return step; }
+
+	/**
+	 * @brief Feeds the render time of the last frame and returns the number of timesteps to
+	 * advance, more than 1 drops frames
+	 */
+	size_t Update( double frameSeconds );
+};
+
+}  // namespace vm
@@ -0,0 +1,101 @@
+#pragma once
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <utility>
+#include <vector>
+
+namespace vm
+{
+/**
+ * @brief CPU counterpart of the out-of-core page table of blockraycasting_f.glsl.
+ *
+ * The table maps every virtual block to a page of a fixed size physical pool. A lookup
+ * of an unmapped block does not stall: it records the block id once in the missed block
+ * buffer, guarded by the hash buffer as the shader does with atomicCompSwap, and returns
+ * nullptr so that the ray can be suspended. Refine then loads the recorded blocks as one
+ * batch between two passes, like glCall_Refine.
+ *
+ * Lookup may be called from several threads, Refine must not overlap with lookups.
+ */
+class VirtualPageTable
+{
+public:
+	/**
+	 * @brief Copies the block \a blockID into \a page, returns false if it can not be read
+	 */
+	using BlockLoader = std::function<bool( size_t blockID, void *page )>;
+
+	/**
+	 * @brief Fills the pages of all (block id, page) pairs of a refine at once
+	 */
+	using BatchLoader = std::function<void( std::vector<std::pair<size_t, void *>> requests )>;
+
+	enum : uint32_t
+	{
+		Unmapped = 0xffffffffu
+	};
+
+	VirtualPageTable( size_t blockCount, size_t pageBytes, size_t physicalPageCount );
+
+	/**
+	 * @brief Returns the page of \a blockID or nullptr after recording it as missed
+	 */
+	const void *Lookup( size_t blockID );
+
+	/**
+	 * @brief Maps as many missed blocks as the pool holds and clears the missed block buffer.
+	 *
+	 * Victims are chosen by the clock algorithm over the pages referenced since the last
+	 * refine. Blocks mapped by this refine are never evicted by it. Returns the number of
+	 * loaded blocks.
+	 */
+	size_t Refine( const BlockLoader &loader );
+
+	/**
+	 * @brief Same as Refine but hands all blocks of the refine to \a loader in one call,
+	 * which lets it order and merge the reads
+	 */
+	size_t RefineBatch( const BatchLoader &loader );
+
+	/**
+	 * @brief Returns the number of blocks missed since the last refine
+	 */
+	size_t MissedBlockCount() const;
+
+	/**
+	 * @brief Makes the page of the mapped block \a blockID the first victim of the next
+	 * refines, unless a lookup references it before. Must not overlap with lookups.
+	 * Returns false if the block is not mapped.
+	 */
+	bool Demote( size_t blockID );
+	/**
+	 * @brief Returns the number of demoted pages not yet taken by a refine, at most one
+	 * entry per physical page however often its block is demoted
+	 */
+	size_t DemotedPageCount() const { return demoted.size(); }
+
+	bool Mapped( size_t blockID ) const { return entries[ blockID ].load( std::memory_order_relaxed ) != Unmapped; }
+	size_t PhysicalPageCount() const { return physicalPageCount; }
+	size_t LoadedBlockCount() const { return loadedBlocks; }
+	void Clear();
+
+private:
+	size_t pageBytes;
+	size_t physicalPageCount;
+	std::unique_ptr<unsigned char[]> pool;
+	std::unique_ptr<std::atomic<uint32_t>[]> entries;  // block id -> physical page
+	std::unique_ptr<std::atomic<uint8_t>[]> hash;	  // block id -> already missed
+	std::unique_ptr<uint32_t[]> missedBlockIDs;
+	std::atomic<size_t> missedCount{ 0 };
+	std::vector<uint32_t> owners;  // physical page -> block id
+	std::unique_ptr<std::atomic<uint8_t>[]> referenced;
+	size_t clockHand = 0;
+	std::vector<std::pair<uint32_t, uint32_t>> demoted;  // physical page, its block id when demoted
+	std::vector<bool> listed;							  // physical page -> in demoted
+	size_t blockCount;
+	size_t loadedBlocks = 0;
+};
+
+}  // namespace vm
@@ -4,8 +4,21 @@
 #include <VMat/transformation.h>
 #include <VMUtils/cmdline.hpp>
 #include <VMFoundation/largevolumecache.h>
+#include <VMCoreExtension/i3dblockfileplugininterface.h>
 #include <VMUtils/timer.hpp>
 #include <VMGraphics/camera.h>
+#include <pixelorder.h>
+#include <shading.h>
+#include <virtualpagetable.h>
+#include <batchblockloader.h>
+#include <residentblocks.h>
+#include <timeseries.h>
+#include <lvdtimeseries.h>
+#include <minmaxoctree.h>
+#include <occlusionbuffer.h>
+#include <gridtraversal.h>
+#include <intensityprojection.h>
+#include <deque>
 #include <vector>
 #include <string>
 
@@ -33,6 +46,15 @@ struct App
 	std::string TFFileName;
 	std::string PluginDir;
 	std::string TFPresetDir;
+	std::string ServiceEndpoint;
+	std::string CameraPathFileName;
+	std::string OutputFileName;
+	std::string TimeSeriesFileName;
+	std::string PackTimeSeriesFileName;
+	std::string ViewSetName;
+	std::string SliceSpec;
+	int EncoderCount = 2;
+	bool OrderBenchmark = false;
 
 	bool hasWindow;
 	Transform ModelTransform;
@@ -48,13 +70,54 @@ struct App
 	bool FPSCamera = true;
 
 	float fov = 60.f;
+	bool orthographic = false;
+	float orthoHeight = 0;	// of the film in world space, 0 fits the volume
 	Vec2i screenSize;
 	float aspect;
 	float step = 0.01;
 	float renderProgress = 0.0;
+	PixelOrder pixelOrder = PixelOrder::Hilbert;
+	int tileSize = 32;
+	std::vector<Vec2i> pixelOrderCache;
+	Vec2i pixelOrderFilm = { 0, 0 };
+	size_t blockLookups = 0;
+	bool blockScheduling = false;
+	bool pageTableScheduling = false;
+	size_t pageTableBytes = 0;
+	std::unique_ptr<VirtualPageTable> pageTable;
+	bool batchIO = true;
+	bool directIO = false;
+	std::string zeroCopy = "auto";
+	bool lockVolume = false;
+	size_t hostMemoryBytes = 0;
+	std::unique_ptr<ResidentBlockTable> residentBlocks;
+	int ioThreadCount = 4;
+	std::unique_ptr<BatchBlockLoader> batchLoader;
+	ShadingModel shading = ShadingModel::None;
+	ShadingParams shadingParams;
+	bool cacheGradients = false;
+	bool gradientSidecar = false;
+	bool MakeGradientSidecar = false;
+	size_t gradientCacheBytes = 0;
+	std::unique_ptr<GradientCache> gradientCache;
+	Ref<I3DBlockFilePluginInterface> gradientFile;
+	std::vector<std::string> timeSeriesFileNames;
+	std::string timeSeriesOutput;
+	float timeSeriesFPS = 10;
+	size_t timeStep = 0;
+	vector<Ref<I3DBlockFilePluginInterface>> timeSeriesFiles;	// null until the timestep is opened
+	std::deque<size_t> openTimesteps;	// open entries of timeSeriesFiles, most recently used last
+	std::unique_ptr<LVDTimeSeriesFile> timeSeriesContainer;
+	bool skipEmptySpace = false;
+	int brickSize = 8;
+	std::unique_ptr<MinMaxOctree> emptySpace;
+	std::unique_ptr<OcclusionBuffer> occlusion;
+	bool ddaTraversal = false;
+	IntensityProjection intensityProjection = IntensityProjection::None;
 
 	// Volume data
 	vector<Ref<Block3DCache>> volumeData;
+	vector<Ref<I3DBlockFilePluginInterface>> volumeFiles;
 	Vec3i dataResolution;
 	Bound3i dataBound;
 	Vec3i blockSize;
@@ -0,0 +1,207 @@
+#include <batchblockloader.h>
+#include <VMUtils/timer.hpp>
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace vm
+{
+BlockLoadStatistics &BlockLoadStatistics::operator+=( const BlockLoadStatistics &other )
+{
+	blocks += other.blocks;
+	runs += other.runs;
+	bytes += other.bytes;
+	seconds += other.seconds;
+	return *this;
+}
+
+BatchBlockLoader::BatchBlockLoader( const std::string &fileName, size_t dataOffset, size_t blockCount, size_t blockBytes,
+									int threadCount, size_t maxRunBytes, bool direct ) :
+  blockCount( blockCount ),
+  blockBytes( blockBytes ),
+  maxRunBytes( ( std::max )( maxRunBytes, blockBytes ) )
+{
+#ifndef _WIN32
+#ifdef O_DIRECT
+	if ( direct ) {
+		fd = open( fileName.c_str(), O_RDONLY | O_DIRECT );
+		directIO = fd >= 0;
+	}
+#endif
+	if ( fd < 0 ) {
+		fd = open( fileName.c_str(), O_RDONLY );
+	}
+	if ( fd < 0 ) {
+		return;
+	}
+	struct stat st;
+	if ( fstat( fd, &st ) != 0 || size_t( st.st_size ) < dataOffset + blockCount * blockBytes ) {
+		close( fd );
+		fd = -1;
+		return;
+	}
+	this->dataOffset = dataOffset;
+	threadCount = ( std::max )( threadCount, 1 );
+	for ( int i = 0; i < threadCount; i++ ) {
+		workers.emplace_back( [ this ]() { Work(); } );
+	}
+#else
+	(void)fileName;
+	(void)threadCount;
+	(void)direct;
+	(void)dataOffset;
+#endif
+}
+
+BatchBlockLoader::~BatchBlockLoader()
+{
+	{
+		std::lock_guard<std::mutex> lk( mtx );
+		stop = true;
+	}
+	cond.notify_all();
+	for ( auto &w : workers ) {
+		w.join();
+	}
+#ifndef _WIN32
+	if ( fd >= 0 ) {
+		close( fd );
+	}
+#endif
+}
+
+BlockLoadStatistics BatchBlockLoader::Load( std::vector<Request> requests )
+{
+	BlockLoadStatistics stat;
+	if ( requests.empty() ) {
+		return stat;
+	}
+	Timer timer;
+	timer.start();
+
+	std::sort( requests.begin(), requests.end(), []( const Request &a, const Request &b ) { return a.first < b.first; } );
+	std::vector<Extent> newExtents;
+	const size_t maxBlocksPerRun = maxRunBytes / blockBytes;
+	for ( size_t i = 0; i < requests.size(); ) {
+		size_t count = 1;
+		while ( i + count < requests.size() && count < maxBlocksPerRun &&
+				requests[ i + count ].first == requests[ i + count - 1 ].first + 1 ) {
+			count++;
+		}
+		newExtents.push_back( Extent{ i, count } );
+		i += count;
+	}
+
+#ifndef _WIN32
+	// the whole batch is queued to the disk before the first read blocks
+	for ( const auto &e : newExtents ) {
+		const auto id = requests[ e.first ].first;
+		if ( id < blockCount ) {
+			posix_fadvise( fd, dataOffset + id * blockBytes, e.count * blockBytes, POSIX_FADV_WILLNEED );
+		}
+	}
+#endif
+
+	std::unique_lock<std::mutex> lk( mtx );
+	batch = std::move( requests );
+	extents = std::move( newExtents );
+	nextExtent = 0;
+	finishedWorkers = 0;
+	generation++;
+	lk.unlock();
+	cond.notify_all();
+
+	lk.lock();
+	cond.wait( lk, [ this ]() { return finishedWorkers == workers.size(); } );
+	stat.blocks = batch.size();
+	stat.runs = extents.size();
+	stat.bytes = batch.size() * blockBytes;
+	if ( workers.empty() ) {
+		// no reader, the pages are still defined
+		for ( const auto &r : batch ) {
+			memset( r.second, 0, blockBytes );
+		}
+		stat.bytes = 0;
+	}
+	lk.unlock();
+
+	stat.seconds = timer.elapsed().s();
+	total += stat;
+	return stat;
+}
+
+void BatchBlockLoader::Work()
+{
+	std::vector<unsigned char> staging;
+	size_t seen = 0;
+	while ( true ) {
+		std::unique_lock<std::mutex> lk( mtx );
+		cond.wait( lk, [ this, seen ]() { return stop || generation != seen; } );
+		if ( stop ) {
+			return;
+		}
+		seen = generation;
+		lk.unlock();
+
+		for ( auto i = nextExtent++; i < extents.size(); i = nextExtent++ ) {
+			ReadExtent( extents[ i ], staging );
+		}
+
+		lk.lock();
+		finishedWorkers++;
+		lk.unlock();
+		cond.notify_all();
+	}
+}
+
+bool BatchBlockLoader::ReadExtent( const Extent &extent, std::vector<unsigned char> &staging )
+{
+	const auto firstID = batch[ extent.first ].first;
+	const auto bytes = extent.count * blockBytes;
+	bool ok = firstID + extent.count <= blockCount;
+#ifndef _WIN32
+	const size_t offset = dataOffset + firstID * blockBytes;
+	// O_DIRECT needs aligned offsets, lengths and buffers, the run is read with its surroundings
+	const size_t begin = directIO ? offset / Alignment * Alignment : offset;
+	const size_t needed = offset - begin + bytes;
+	const size_t length = directIO ? ( needed + Alignment - 1 ) / Alignment * Alignment : needed;
+	unsigned char *buf = nullptr;
+	if ( !directIO && extent.count == 1 ) {
+		buf = (unsigned char *)batch[ extent.first ].second;
+	} else {
+		staging.resize( length + Alignment );
+		buf = staging.data() + ( Alignment - uintptr_t( staging.data() ) % Alignment ) % Alignment;
+	}
+	size_t done = 0;
+	while ( ok && done < needed ) {
+		const auto n = pread( fd, buf + done, length - done, begin + done );
+		if ( n <= 0 ) {
+			break;	// the aligned tail may run past the end of the file
+		}
+		done += n;
+	}
+	ok = ok && done >= needed;
+	const auto src = buf + ( offset - begin );
+	if ( ok && src != batch[ extent.first ].second ) {
+		for ( size_t i = 0; i < extent.count; i++ ) {
+			memcpy( batch[ extent.first + i ].second, src + i * blockBytes, blockBytes );
+		}
+	}
+#else
+	ok = false;
+#endif
+	if ( !ok ) {
+		for ( size_t i = 0; i < extent.count; i++ ) {
+			memset( batch[ extent.first + i ].second, 0, blockBytes );
+		}
+	}
+	return ok;
+}
+
+}  // namespace vm
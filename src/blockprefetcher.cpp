@@ -0,0 +1,84 @@
+#include <blockprefetcher.h>
+
+namespace vm
+{
+BlockPrefetcher::BlockPrefetcher( Ref<I3DBlockFilePluginInterface> file ) :
+  file( std::move( file ) )
+{
+	worker = std::thread( [ this ]() { Run(); } );
+}
+
+BlockPrefetcher::~BlockPrefetcher()
+{
+	{
+		std::lock_guard<std::mutex> lk( mtx );
+		stop = true;
+	}
+	cond.notify_all();
+	worker.join();
+}
+
+void BlockPrefetcher::Prefetch( std::vector<size_t> blockIDs )
+{
+	Prefetch( file, std::move( blockIDs ) );
+}
+
+void BlockPrefetcher::Prefetch( Ref<I3DBlockFilePluginInterface> blockFile, std::vector<size_t> blockIDs )
+{
+	{
+		std::lock_guard<std::mutex> lk( mtx );
+		pendingFile = std::move( blockFile );
+		pending = std::move( blockIDs );
+		hasPending = true;
+	}
+	cond.notify_all();
+}
+
+void BlockPrefetcher::Wait()
+{
+	std::unique_lock<std::mutex> lk( mtx );
+	cond.wait( lk, [ this ]() { return !hasPending && !busy; } );
+}
+
+size_t BlockPrefetcher::PrefetchedBlockCount()
+{
+	std::lock_guard<std::mutex> lk( mtx );
+	return prefetchedBlocks;
+}
+
+void BlockPrefetcher::Run()
+{
+	constexpr size_t osPageSize = 4096;
+	std::vector<size_t> blocks;
+	Ref<I3DBlockFilePluginInterface> current;
+	while ( true ) {
+		{
+			std::unique_lock<std::mutex> lk( mtx );
+			busy = false;
+			cond.notify_all();
+			cond.wait( lk, [ this ]() { return stop || hasPending; } );
+			if ( stop ) return;
+			blocks.swap( pending );
+			current = pendingFile;
+			hasPending = false;
+			busy = true;
+		}
+		const auto pageBytes = current->Get3DPageSize().Prod();
+		const auto pageCount = current->GetVirtualPageCount();
+		size_t count = 0;
+		volatile unsigned char sink = 0;
+		for ( const auto id : blocks ) {
+			if ( id >= pageCount ) continue;
+			const auto page = static_cast<const unsigned char *>( current->GetPage( id ) );
+			if ( page == nullptr ) continue;
+			for ( size_t offset = 0; offset < pageBytes; offset += osPageSize ) {
+				sink = sink + page[ offset ];
+			}
+			current->UnlockPage( id );
+			count++;
+		}
+		std::lock_guard<std::mutex> lk( mtx );
+		prefetchedBlocks += count;
+	}
+}
+}  // namespace vm
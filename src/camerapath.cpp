@@ -0,0 +1,100 @@
+#include <camerapath.h>
+#include <fstream>
+#include <stdexcept>
+
+namespace vm
+{
+CameraPath::CameraPath( std::vector<ViewingTransform> keyframes, int framesPerSegment ) :
+  keyframes( std::move( keyframes ) ),
+  framesPerSegment( ( std::max )( framesPerSegment, 1 ) )
+{
+}
+
+size_t CameraPath::FrameCount() const
+{
+	if ( keyframes.empty() ) return 0;
+	return ( keyframes.size() - 1 ) * framesPerSegment + 1;
+}
+
+ViewingTransform CameraPath::Frame( size_t frame ) const
+{
+	const auto segment = frame / framesPerSegment;
+	if ( segment + 1 >= keyframes.size() ) {
+		return keyframes.back();
+	}
+	const float t = float( frame % framesPerSegment ) / framesPerSegment;
+	auto &a = keyframes[ segment ].GetViewMatrixWrapper();
+	auto &b = keyframes[ segment + 1 ].GetViewMatrixWrapper();
+	const Point3f pa = a.GetPosition(), pb = b.GetPosition();
+	const auto eye = pa + ( pb - pa ) * t;
+	const auto front = ( a.GetFront().Normalized() * ( 1 - t ) + b.GetFront().Normalized() * t ).Normalized();
+	const auto up = ( a.GetUp().Normalized() * ( 1 - t ) + b.GetUp().Normalized() * t ).Normalized();
+	return ViewingTransform( eye, up, eye + front );
+}
+
+CameraPath LoadCameraPath( const std::string &fileName, std::string &outputPattern )
+{
+	std::ifstream in( fileName );
+	if ( !in.is_open() ) {
+		throw std::runtime_error( "can not open camera path file: " + fileName );
+	}
+	CameraPathJSONStruct json;
+	in >> json;
+	std::vector<ViewingTransform> keyframes;
+	for ( const auto &cam : json.cameras ) {
+		keyframes.push_back( ConfigCamera( cam ) );
+	}
+	if ( keyframes.empty() ) {
+		throw std::runtime_error( "camera path has no keyframes: " + fileName );
+	}
+	outputPattern = json.output.empty() ? "frame_{}.png" : json.output;
+	return CameraPath( std::move( keyframes ), json.framesPerSegment );
+}
+
+std::vector<ViewingTransform> LoadViewSet( const std::string &fileName, std::string &outputPattern )
+{
+	std::ifstream in( fileName );
+	if ( !in.is_open() ) {
+		throw std::runtime_error( "can not open view set file: " + fileName );
+	}
+	ViewSetJSONStruct json;
+	in >> json;
+	std::vector<ViewingTransform> views;
+	for ( const auto &cam : json.cameras ) {
+		views.push_back( ConfigCamera( cam ) );
+	}
+	if ( views.empty() ) {
+		throw std::runtime_error( "view set has no cameras: " + fileName );
+	}
+	outputPattern = json.output.empty() ? "view_{}.png" : json.output;
+	return views;
+}
+
+std::vector<ViewingTransform> AxisAlignedViews( const Point3f &center, float distance )
+{
+	std::vector<ViewingTransform> views;
+	for ( int axis = 0; axis < 3; axis++ ) {
+		for ( const float sign : { 1.f, -1.f } ) {
+			Vec3f offset( 0, 0, 0 );
+			offset[ axis ] = sign * distance;
+			// the up direction must not be parallel to the viewing direction
+			const auto up = axis == 1 ? Vec3f( 0, 0, 1 ) : Vec3f( 0, 1, 0 );
+			views.emplace_back( center + offset, up, center );
+		}
+	}
+	return views;
+}
+
+std::string FormatFrameFileName( const std::string &pattern, size_t frame )
+{
+	auto number = std::to_string( frame );
+	if ( number.size() < 4 ) number.insert( 0, 4 - number.size(), '0' );
+	auto name = pattern;
+	const auto pos = name.find( "{}" );
+	if ( pos == std::string::npos ) {
+		return number + "_" + name;
+	}
+	return name.replace( pos, 2, number );
+}
+
+}  // namespace vm
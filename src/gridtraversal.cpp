@@ -0,0 +1,179 @@
+#include <gridtraversal.h>
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+namespace vm
+{
+namespace
+{
+constexpr float Infinity = std::numeric_limits<float>::infinity();
+
+void InverseDirection( const Vec3f &d, float *invD )
+{
+	const float dir[] = { d.x, d.y, d.z };
+	for ( int a = 0; a < 3; a++ ) {
+		invD[ a ] = dir[ a ] != 0 ? 1.f / dir[ a ] : Infinity;
+	}
+}
+}  // namespace
+
+GridTraversal::GridTraversal( const Point3f &lo, const Point3f &hi, const Vec3i &cellCount )
+{
+	const float l[] = { lo.x, lo.y, lo.z };
+	const float h[] = { hi.x, hi.y, hi.z };
+	const int c[] = { cellCount.x, cellCount.y, cellCount.z };
+	for ( int a = 0; a < 3; a++ ) {
+		this->lo[ a ] = l[ a ];
+		this->hi[ a ] = h[ a ];
+		count[ a ] = ( std::max )( c[ a ], 1 );
+		cellSize[ a ] = ( h[ a ] - l[ a ] ) / count[ a ];
+	}
+}
+
+bool GridTraversal::Enter( const Point3f &o, const Vec3f &d, Entry &entry, float &tEnter, float &tExit ) const
+{
+	const float origin[] = { o.x, o.y, o.z };
+	const float dir[] = { d.x, d.y, d.z };
+	float t0 = 0, t1 = Infinity;
+	entry.axis = -1;
+	entry.plane = 0;
+	for ( int a = 0; a < 3; a++ ) {
+		if ( dir[ a ] == 0 ) {
+			if ( origin[ a ] < lo[ a ] || origin[ a ] > hi[ a ] ) {
+				return false;
+			}
+			continue;
+		}
+		const float inv = 1.f / dir[ a ];
+		const float tLo = ( lo[ a ] - origin[ a ] ) * inv;
+		const float tHi = ( hi[ a ] - origin[ a ] ) * inv;
+		const float tNear = ( std::min )( tLo, tHi );
+		if ( tNear > t0 ) {
+			t0 = tNear;
+			entry.axis = a;
+			entry.plane = dir[ a ] > 0 ? lo[ a ] : hi[ a ];
+		}
+		t1 = ( std::min )( t1, ( std::max )( tLo, tHi ) );
+	}
+	if ( t0 >= t1 ) {
+		return false;
+	}
+	for ( int a = 0; a < 3; a++ ) {
+		if ( a == entry.axis ) {
+			// exactly on the face, rounding must not put the ray outside
+			entry.cell[ a ] = dir[ a ] > 0 ? 0 : count[ a ] - 1;
+		} else {
+			const int c = int( std::floor( ( origin[ a ] + dir[ a ] * t0 - lo[ a ] ) / cellSize[ a ] ) );
+			entry.cell[ a ] = ( std::min )( ( std::max )( c, 0 ), count[ a ] - 1 );
+		}
+	}
+	tEnter = t0;
+	tExit = t1;
+	return true;
+}
+
+float GridTraversal::Exit( const Point3f &o, const float *invD ) const
+{
+	const float origin[] = { o.x, o.y, o.z };
+	float t = Infinity;
+	for ( int a = 0; a < 3; a++ ) {
+		if ( invD[ a ] != Infinity ) {
+			t = ( std::min )( t, ( ( invD[ a ] > 0 ? hi[ a ] : lo[ a ] ) - origin[ a ] ) * invD[ a ] );
+		}
+	}
+	return t;
+}
+
+void GridTraversal::Begin( GridDDA &dda, const Point3f &o, const Vec3f &d, const float *invD, const int *cell, float tEnter, float tExit ) const
+{
+	const float origin[] = { o.x, o.y, o.z };
+	const float dir[] = { d.x, d.y, d.z };
+	for ( int a = 0; a < 3; a++ ) {
+		dda.cell[ a ] = cell[ a ];
+		dda.count[ a ] = count[ a ];
+		if ( dir[ a ] > 0 ) {
+			dda.step[ a ] = 1;
+			dda.tNext[ a ] = ( lo[ a ] + ( cell[ a ] + 1 ) * cellSize[ a ] - origin[ a ] ) * invD[ a ];
+			dda.tDelta[ a ] = cellSize[ a ] * invD[ a ];
+		} else if ( dir[ a ] < 0 ) {
+			dda.step[ a ] = -1;
+			dda.tNext[ a ] = ( lo[ a ] + cell[ a ] * cellSize[ a ] - origin[ a ] ) * invD[ a ];
+			dda.tDelta[ a ] = -cellSize[ a ] * invD[ a ];
+		} else {
+			dda.step[ a ] = 0;
+			dda.tNext[ a ] = Infinity;
+			dda.tDelta[ a ] = Infinity;
+		}
+	}
+	dda.Pos = tEnter;
+	dda.Max = tExit;
+	dda.valid = tEnter < tExit;
+	dda.CellIndex = Point3i( cell[ 0 ], cell[ 1 ], cell[ 2 ] );
+}
+
+GridDDA GridTraversal::IntersectWith( const Point3f &o, const Vec3f &d ) const
+{
+	GridDDA dda;
+	Entry entry;
+	float tEnter, tExit;
+	if ( !Enter( o, d, entry, tEnter, tExit ) ) {
+		return dda;
+	}
+	float invD[ 3 ];
+	InverseDirection( d, invD );
+	Begin( dda, o, d, invD, entry.cell, tEnter, tExit );
+	return dda;
+}
+
+void GridTraversal::PrepareTiles( const Point3f &eye, int width, int height, int tileSize, const PixelDirection &direction )
+{
+	this->eye = eye;
+	this->tileSize = ( std::max )( tileSize, 1 );
+	tilesX = ( width + this->tileSize - 1 ) / this->tileSize;
+	const int tilesY = ( height + this->tileSize - 1 ) / this->tileSize;
+	tiles.assign( size_t( tilesX ) * tilesY, Entry{ false, -1, 0, { 0, 0, 0 } } );
+	for ( int ty = 0; ty < tilesY; ty++ ) {
+		for ( int tx = 0; tx < tilesX; tx++ ) {
+			const int x0 = tx * this->tileSize, x1 = ( std::min )( x0 + this->tileSize, width ) - 1;
+			const int y0 = ty * this->tileSize, y1 = ( std::min )( y0 + this->tileSize, height ) - 1;
+			const int corners[ 4 ][ 2 ] = { { x0, y0 }, { x1, y0 }, { x0, y1 }, { x1, y1 } };
+			Entry first, e;
+			float tEnter, tExit;
+			bool shared = true;
+			for ( int i = 0; i < 4 && shared; i++ ) {
+				// the rays of the tile lie between the corner rays, they enter the face of
+				// the cell wherever all corner rays do
+				shared = Enter( eye, direction( corners[ i ][ 0 ], corners[ i ][ 1 ] ), i ? e : first, tEnter, tExit );
+				shared = shared && ( i == 0 || ( e.axis == first.axis && e.plane == first.plane && e.cell[ 0 ] == first.cell[ 0 ] &&
+												 e.cell[ 1 ] == first.cell[ 1 ] && e.cell[ 2 ] == first.cell[ 2 ] ) );
+			}
+			if ( shared ) {
+				first.shared = true;
+				tiles[ size_t( ty ) * tilesX + tx ] = first;
+			}
+		}
+	}
+}
+
+GridDDA GridTraversal::Start( int x, int y, const Vec3f &d ) const
+{
+	const auto &tile = tiles[ size_t( y / tileSize ) * tilesX + x / tileSize ];
+	if ( !tile.shared ) {
+		return IntersectWith( eye, d );
+	}
+	GridDDA dda;
+	float invD[ 3 ];
+	InverseDirection( d, invD );
+	const float origin[] = { eye.x, eye.y, eye.z };
+	const float tEnter = tile.axis < 0 ? 0.f : ( tile.plane - origin[ tile.axis ] ) * invD[ tile.axis ];
+	Begin( dda, eye, d, invD, tile.cell, tEnter, Exit( eye, invD ) );
+	return dda;
+}
+
+size_t GridTraversal::SharedTileCount() const
+{
+	return std::count_if( tiles.begin(), tiles.end(), []( const Entry &e ) { return e.shared; } );
+}
+
+}  // namespace vm
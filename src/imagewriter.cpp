@@ -0,0 +1,201 @@
+#include <imagewriter.h>
+#include <VMFoundation/logger.h>
+#include <3rdparty/stb_image_write.h>
+#include <algorithm>
+#include <cctype>
+#include <cstdio>
+
+namespace vm
+{
+namespace
+{
+bool WriteBytes( const std::string &fileName, const char *header, size_t headerBytes, const unsigned char *data, size_t bytes )
+{
+	auto fp = fopen( fileName.c_str(), "wb" );
+	if ( fp == nullptr ) {
+		return false;
+	}
+	bool ok = fwrite( header, 1, headerBytes, fp ) == headerBytes;
+	ok = ok && fwrite( data, 1, bytes, fp ) == bytes;
+	return fclose( fp ) == 0 && ok;
+}
+
+bool WritePPM( const std::string &fileName, int width, int height, const Pixel_t *pixels )
+{
+	const size_t count = size_t( width ) * height;
+	std::vector<unsigned char> rgb( count * 3 );
+	for ( size_t i = 0; i < count; i++ ) {
+		rgb[ 3 * i ] = pixels[ i ].Comp.r;
+		rgb[ 3 * i + 1 ] = pixels[ i ].Comp.g;
+		rgb[ 3 * i + 2 ] = pixels[ i ].Comp.b;
+	}
+	const auto header = "P6\n" + std::to_string( width ) + " " + std::to_string( height ) + "\n255\n";
+	return WriteBytes( fileName, header.data(), header.size(), rgb.data(), rgb.size() );
+}
+
+/**
+ * @brief Encodes RGBA8 pixels as QOI, see https://qoiformat.org/qoi-specification.pdf
+ */
+bool WriteQOI( const std::string &fileName, int width, int height, const Pixel_t *pixels )
+{
+	const size_t count = size_t( width ) * height;
+	std::vector<unsigned char> out;
+	out.reserve( count * 5 + 22 );
+	auto put32 = [ &out ]( uint32_t v ) {
+		out.push_back( v >> 24 );
+		out.push_back( v >> 16 );
+		out.push_back( v >> 8 );
+		out.push_back( v );
+	};
+	const char magic[] = "qoif";
+	out.insert( out.end(), magic, magic + 4 );
+	put32( width );
+	put32( height );
+	out.push_back( 4 );	 // channels
+	out.push_back( 0 );	 // sRGB with linear alpha
+
+	Pixel_t index[ 64 ] = {};
+	Pixel_t prev;
+	prev.Comp = { 0, 0, 0, 255 };
+	int run = 0;
+	for ( size_t i = 0; i < count; i++ ) {
+		const auto px = pixels[ i ];
+		if ( px.Pixel == prev.Pixel ) {
+			if ( ++run == 62 || i + 1 == count ) {
+				out.push_back( 0xc0 | ( run - 1 ) );
+				run = 0;
+			}
+			continue;
+		}
+		if ( run > 0 ) {
+			out.push_back( 0xc0 | ( run - 1 ) );
+			run = 0;
+		}
+		const auto &c = px.Comp;
+		const int hash = ( c.r * 3 + c.g * 5 + c.b * 7 + c.a * 11 ) % 64;
+		if ( index[ hash ].Pixel == px.Pixel ) {
+			out.push_back( hash );
+		} else {
+			index[ hash ] = px;
+			if ( c.a == prev.Comp.a ) {
+				const int8_t vr = c.r - prev.Comp.r;
+				const int8_t vg = c.g - prev.Comp.g;
+				const int8_t vb = c.b - prev.Comp.b;
+				const int8_t vgr = vr - vg;
+				const int8_t vgb = vb - vg;
+				if ( vr > -3 && vr < 2 && vg > -3 && vg < 2 && vb > -3 && vb < 2 ) {
+					out.push_back( 0x40 | ( vr + 2 ) << 4 | ( vg + 2 ) << 2 | ( vb + 2 ) );
+				} else if ( vgr > -9 && vgr < 8 && vg > -33 && vg < 32 && vgb > -9 && vgb < 8 ) {
+					out.push_back( 0x80 | ( vg + 32 ) );
+					out.push_back( ( vgr + 8 ) << 4 | ( vgb + 8 ) );
+				} else {
+					out.insert( out.end(), { 0xfe, c.r, c.g, c.b } );
+				}
+			} else {
+				out.insert( out.end(), { 0xff, c.r, c.g, c.b, c.a } );
+			}
+		}
+		prev = px;
+	}
+	out.insert( out.end(), { 0, 0, 0, 0, 0, 0, 0, 1 } );
+	return WriteBytes( fileName, nullptr, 0, out.data(), out.size() );
+}
+}  // namespace
+
+ImageFormat ImageFormatFromFileName( const std::string &fileName )
+{
+	const auto dot = fileName.find_last_of( '.' );
+	if ( dot == std::string::npos ) {
+		return ImageFormat::PNG;
+	}
+	auto ext = fileName.substr( dot );
+	std::transform( ext.begin(), ext.end(), ext.begin(), []( unsigned char c ) { return std::tolower( c ); } );
+	if ( ext == ".ppm" ) return ImageFormat::PPM;
+	if ( ext == ".qoi" ) return ImageFormat::QOI;
+	if ( ext == ".raw" ) return ImageFormat::RAW;
+	return ImageFormat::PNG;
+}
+
+bool WriteImage( const std::string &fileName, int width, int height, const Pixel_t *pixels )
+{
+	switch ( ImageFormatFromFileName( fileName ) ) {
+	case ImageFormat::PPM: return WritePPM( fileName, width, height, pixels );
+	case ImageFormat::QOI: return WriteQOI( fileName, width, height, pixels );
+	case ImageFormat::RAW: return WriteBytes( fileName, nullptr, 0, (const unsigned char *)pixels, size_t( width ) * height * 4 );
+	default: return stbi_write_png( fileName.c_str(), width, height, 4, pixels, width * 4 ) != 0;
+	}
+}
+
+void SetPNGCompressionLevel( int level )
+{
+	stbi_write_png_compression_level = level;
+}
+
+AsyncImageWriter::AsyncImageWriter( int workerCount, size_t capacity ) :
+  capacity( ( std::max )( capacity, size_t( 1 ) ) )
+{
+	workerCount = ( std::max )( workerCount, 1 );
+	for ( int i = 0; i < workerCount; i++ ) {
+		workers.emplace_back( [ this ]() { Run(); } );
+	}
+}
+
+AsyncImageWriter::~AsyncImageWriter()
+{
+	{
+		std::lock_guard<std::mutex> lk( mtx );
+		stop = true;
+	}
+	cond.notify_all();
+	for ( auto &w : workers ) {
+		w.join();
+	}
+}
+
+void AsyncImageWriter::Submit( std::string fileName, int width, int height, std::vector<Pixel_t> pixels,
+							   std::function<void( bool )> done )
+{
+	std::unique_lock<std::mutex> lk( mtx );
+	cond.wait( lk, [ this ]() { return queue.size() < capacity; } );
+	queue.push_back( Task{ std::move( fileName ), width, height, std::move( pixels ), std::move( done ) } );
+	lk.unlock();
+	cond.notify_all();
+}
+
+void AsyncImageWriter::Wait()
+{
+	std::unique_lock<std::mutex> lk( mtx );
+	cond.wait( lk, [ this ]() { return queue.empty() && running == 0; } );
+}
+
+void AsyncImageWriter::Run()
+{
+	while ( true ) {
+		std::unique_lock<std::mutex> lk( mtx );
+		// queued images are still written when stopping
+		cond.wait( lk, [ this ]() { return stop || !queue.empty(); } );
+		if ( queue.empty() ) {
+			return;
+		}
+		auto task = std::move( queue.front() );
+		queue.pop_front();
+		running++;
+		lk.unlock();
+		cond.notify_all();
+
+		const auto ok = WriteImage( task.fileName, task.width, task.height, task.pixels.data() );
+		if ( !ok ) {
+			LOG_CRITICAL << "Failed to write image: " << task.fileName;
+		}
+		if ( task.done ) {
+			task.done( ok );
+		}
+
+		lk.lock();
+		running--;
+		lk.unlock();
+		cond.notify_all();
+	}
+}
+
+}  // namespace vm
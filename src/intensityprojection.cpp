@@ -0,0 +1,158 @@
+#include <intensityprojection.h>
+#include <algorithm>
+#include <cstdint>
+
+#if defined( __SSE2__ ) || defined( _M_X64 )
+#include <emmintrin.h>
+#define VM_PROJECTION_SSE2
+#endif
+
+namespace vm
+{
+namespace
+{
+/**
+ * @brief Returns the voxel, the edge voxels of the block repeat beyond its upper faces
+ */
+inline float Voxel( const unsigned char *block, int side, int x, int y, int z )
+{
+	x = ( std::min )( x, side - 1 );
+	y = ( std::min )( y, side - 1 );
+	z = ( std::min )( z, side - 1 );
+	return block[ ( size_t( z ) * side + y ) * side + x ];
+}
+
+inline float Mix( float t, float a, float b )
+{
+	return a + ( b - a ) * t;
+}
+
+float Trilinear( const unsigned char *block, int side, float x, float y, float z )
+{
+	const int ix = int( x ), iy = int( y ), iz = int( z );
+	const float fx = x - ix, fy = y - iy, fz = z - iz;
+	const float c00 = Mix( fx, Voxel( block, side, ix, iy, iz ), Voxel( block, side, ix + 1, iy, iz ) );
+	const float c10 = Mix( fx, Voxel( block, side, ix, iy + 1, iz ), Voxel( block, side, ix + 1, iy + 1, iz ) );
+	const float c01 = Mix( fx, Voxel( block, side, ix, iy, iz + 1 ), Voxel( block, side, ix + 1, iy, iz + 1 ) );
+	const float c11 = Mix( fx, Voxel( block, side, ix, iy + 1, iz + 1 ), Voxel( block, side, ix + 1, iy + 1, iz + 1 ) );
+	return Mix( fz, Mix( fy, c00, c10 ), Mix( fy, c01, c11 ) );
+}
+
+#ifdef VM_PROJECTION_SSE2
+inline __m128 Mix4( __m128 t, __m128 a, __m128 b )
+{
+	return _mm_add_ps( a, _mm_mul_ps( _mm_sub_ps( b, a ), t ) );
+}
+
+inline float HorizontalMax( __m128 v )
+{
+	v = _mm_max_ps( v, _mm_shuffle_ps( v, v, _MM_SHUFFLE( 2, 3, 0, 1 ) ) );
+	v = _mm_max_ps( v, _mm_shuffle_ps( v, v, _MM_SHUFFLE( 1, 0, 3, 2 ) ) );
+	return _mm_cvtss_f32( v );
+}
+
+inline float HorizontalMin( __m128 v )
+{
+	v = _mm_min_ps( v, _mm_shuffle_ps( v, v, _MM_SHUFFLE( 2, 3, 0, 1 ) ) );
+	v = _mm_min_ps( v, _mm_shuffle_ps( v, v, _MM_SHUFFLE( 1, 0, 3, 2 ) ) );
+	return _mm_cvtss_f32( v );
+}
+#endif
+}  // namespace
+
+IntensityProjection IntensityProjectionFromName( const std::string &name )
+{
+	if ( name == "mip" ) return IntensityProjection::Maximum;
+	if ( name == "minip" ) return IntensityProjection::Minimum;
+	if ( name == "aip" ) return IntensityProjection::Average;
+	return IntensityProjection::None;
+}
+
+bool IntensityAccumulator::Saturated( IntensityProjection mode ) const
+{
+	switch ( mode ) {
+	case IntensityProjection::Maximum: return max >= 255;
+	case IntensityProjection::Minimum: return count > 0 && min <= 0;
+	default: return false;
+	}
+}
+
+bool IntensityAccumulator::MayChange( IntensityProjection mode, float lo, float hi ) const
+{
+	switch ( mode ) {
+	case IntensityProjection::Maximum: return hi > max;
+	// the first samples set the minimum whatever they are
+	case IntensityProjection::Minimum: return count == 0 || lo < min;
+	default: return true;
+	}
+}
+
+float IntensityAccumulator::Value( IntensityProjection mode ) const
+{
+	if ( count == 0 ) {
+		return 0;
+	}
+	switch ( mode ) {
+	case IntensityProjection::Maximum: return max;
+	case IntensityProjection::Minimum: return min;
+	case IntensityProjection::Average: return sum / count;
+	default: return 0;
+	}
+}
+
+void AccumulateSamples( const unsigned char *block, int side, const Point3f &p, const Vec3f &delta, int count, IntensityAccumulator &acc )
+{
+	if ( count <= 0 ) {
+		return;
+	}
+	const float o[] = { p.x, p.y, p.z };
+	const float d[] = { delta.x, delta.y, delta.z };
+	int k = 0;
+#ifdef VM_PROJECTION_SSE2
+	if ( count >= 4 ) {
+		__m128 vmax = _mm_set1_ps( acc.max ), vmin = _mm_set1_ps( acc.min ), vsum = _mm_setzero_ps();
+		const __m128 zero = _mm_setzero_ps();
+		for ( ; k + 4 <= count; k += 4 ) {
+			const __m128 ks = _mm_cvtepi32_ps( _mm_setr_epi32( k, k + 1, k + 2, k + 3 ) );
+			alignas( 16 ) int32_t i[ 3 ][ 4 ];
+			__m128 f[ 3 ];
+			for ( int a = 0; a < 3; a++ ) {
+				// a sample on the lower face may round to just outside of it
+				const __m128 pa = _mm_max_ps( _mm_add_ps( _mm_set1_ps( o[ a ] ), _mm_mul_ps( _mm_set1_ps( d[ a ] ), ks ) ), zero );
+				const __m128i ip = _mm_cvttps_epi32( pa );
+				_mm_store_si128( (__m128i *)i[ a ], ip );
+				f[ a ] = _mm_sub_ps( pa, _mm_cvtepi32_ps( ip ) );
+			}
+			alignas( 16 ) float c[ 8 ][ 4 ];
+			for ( int lane = 0; lane < 4; lane++ ) {
+				for ( int n = 0; n < 8; n++ ) {
+					c[ n ][ lane ] = Voxel( block, side, i[ 0 ][ lane ] + ( n & 1 ), i[ 1 ][ lane ] + ( n >> 1 & 1 ), i[ 2 ][ lane ] + ( n >> 2 ) );
+				}
+			}
+			const __m128 c00 = Mix4( f[ 0 ], _mm_load_ps( c[ 0 ] ), _mm_load_ps( c[ 1 ] ) );
+			const __m128 c10 = Mix4( f[ 0 ], _mm_load_ps( c[ 2 ] ), _mm_load_ps( c[ 3 ] ) );
+			const __m128 c01 = Mix4( f[ 0 ], _mm_load_ps( c[ 4 ] ), _mm_load_ps( c[ 5 ] ) );
+			const __m128 c11 = Mix4( f[ 0 ], _mm_load_ps( c[ 6 ] ), _mm_load_ps( c[ 7 ] ) );
+			const __m128 value = Mix4( f[ 2 ], Mix4( f[ 1 ], c00, c10 ), Mix4( f[ 1 ], c01, c11 ) );
+			vmax = _mm_max_ps( vmax, value );
+			vmin = _mm_min_ps( vmin, value );
+			vsum = _mm_add_ps( vsum, value );
+		}
+		alignas( 16 ) float sums[ 4 ];
+		_mm_store_ps( sums, vsum );
+		acc.max = HorizontalMax( vmax );
+		acc.min = HorizontalMin( vmin );
+		acc.sum += ( sums[ 0 ] + sums[ 1 ] ) + ( sums[ 2 ] + sums[ 3 ] );
+		acc.count += k;
+	}
+#endif
+	for ( ; k < count; k++ ) {
+		const float value = Trilinear( block, side, ( std::max )( o[ 0 ] + d[ 0 ] * k, 0.f ), ( std::max )( o[ 1 ] + d[ 1 ] * k, 0.f ), ( std::max )( o[ 2 ] + d[ 2 ] * k, 0.f ) );
+		acc.max = ( std::max )( acc.max, value );
+		acc.min = ( std::min )( acc.min, value );
+		acc.sum += value;
+		acc.count++;
+	}
+}
+
+}  // namespace vm
@@ -0,0 +1,532 @@
+#include <lossyblockcodec.h>
+#include "plugins/lvdfileheader.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+namespace vm
+{
+namespace
+{
+// quotients from MaxUnary on are escaped to a raw 32 bit symbol
+constexpr int MaxUnary = 24;
+// the escaped symbol of a value stored verbatim, zigzag coded quanta stay below 2^31
+constexpr uint32_t VerbatimSymbol = 0xffffffffu;
+constexpr double MaxQuantum = double( 1 << 30 );
+// a block header byte instead of the Rice parameter: every residual is 0
+constexpr unsigned char ZeroBlock = 0xff;
+
+int CountTrailingOnes( uint64_t v )
+{
+#if defined( __GNUC__ ) || defined( __clang__ )
+	return ~v ? __builtin_ctzll( ~v ) : 64;
+#else
+	int n = 0;
+	for ( ; n < 64 && ( v & 1 ); v >>= 1 ) {
+		n++;
+	}
+	return n;
+#endif
+}
+
+class BitWriter
+{
+public:
+	explicit BitWriter( std::vector<unsigned char> &out ) :
+	  out( out ) {}
+
+	/**
+	 * @brief Appends the low \a count bits of \a bits, at most 32
+	 */
+	void Write( uint64_t bits, int count )
+	{
+		acc |= ( bits & ( ( uint64_t( 1 ) << count ) - 1 ) ) << n;
+		n += count;
+		while ( n >= 8 ) {
+			out.push_back( (unsigned char)acc );
+			acc >>= 8;
+			n -= 8;
+		}
+	}
+	void Finish()
+	{
+		if ( n > 0 ) {
+			out.push_back( (unsigned char)acc );
+		}
+		acc = 0;
+		n = 0;
+	}
+
+private:
+	std::vector<unsigned char> &out;
+	uint64_t acc = 0;
+	int n = 0;
+};
+
+class BitReader
+{
+public:
+	BitReader( const unsigned char *begin, const unsigned char *end ) :
+	  p( begin ), end( end ) {}
+
+	bool Read( int count, uint32_t &value )
+	{
+		if ( count == 0 ) {
+			value = 0;
+			return true;
+		}
+		Refill();
+		if ( n < count ) {
+			return false;
+		}
+		value = uint32_t( acc & ( ( uint64_t( 1 ) << count ) - 1 ) );
+		acc >>= count;
+		n -= count;
+		return true;
+	}
+	/**
+	 * @brief Reads ones up to the terminating zero or MaxUnary of them
+	 */
+	bool ReadUnary( int &ones )
+	{
+		Refill();
+		ones = ( std::min )( CountTrailingOnes( acc ), MaxUnary );
+		const int used = ones < MaxUnary ? ones + 1 : MaxUnary;
+		if ( used > n ) {
+			return false;
+		}
+		acc >>= used;
+		n -= used;
+		return true;
+	}
+
+private:
+	void Refill()
+	{
+		while ( n <= 56 && p < end ) {
+			acc |= uint64_t( *p++ ) << n;
+			n += 8;
+		}
+	}
+	const unsigned char *p;
+	const unsigned char *end;
+	uint64_t acc = 0;
+	int n = 0;
+};
+
+/**
+ * @brief Returns the quantization step, the largest power of two not above 2 * tolerance.
+ * Multiples of it are exact in double, so encoder and decoder reconstruct the same values
+ * whether or not the compiler fuses the multiply and add.
+ */
+double QuantumOf( float tolerance )
+{
+	int exponent;
+	std::frexp( 2.0 * tolerance, &exponent );
+	return std::ldexp( 1.0, exponent - 1 );
+}
+
+/**
+ * @brief Decoded voxels with a zero border at x, y or z = -1, the predictor reads them
+ */
+class ReconstructedBlock
+{
+public:
+	explicit ReconstructedBlock( size_t side ) :
+	  s1( side + 1 ), values( s1 * s1 * s1, 0.f ) {}
+
+	double Predict( size_t x, size_t y, size_t z ) const
+	{
+		const auto i = Index( x, y, z );
+		const size_t dx = 1, dy = s1, dz = s1 * s1;
+		return double( values[ i - dx ] ) + values[ i - dy ] + values[ i - dz ] - values[ i - dx - dy ] -
+			   values[ i - dx - dz ] - values[ i - dy - dz ] + values[ i - dx - dy - dz ];
+	}
+	void Set( size_t x, size_t y, size_t z, float v )
+	{
+		// a NaN or infinity would spoil every prediction after it
+		values[ Index( x, y, z ) ] = std::isfinite( v ) ? v : 0.f;
+	}
+
+private:
+	size_t Index( size_t x, size_t y, size_t z ) const { return ( ( z + 1 ) * s1 + y + 1 ) * s1 + x + 1; }
+	size_t s1;
+	std::vector<float> values;
+};
+
+}  // namespace
+
+size_t EncodeFloatBlock( const float *src, size_t side, float tolerance, std::vector<unsigned char> &dst )
+{
+	const auto begin = dst.size();
+	const double quantum = QuantumOf( tolerance );
+	ReconstructedBlock recon( side );
+	std::vector<uint32_t> symbols( side * side * side );
+	std::vector<float> verbatim;
+	uint64_t sum = 0;
+	size_t i = 0;
+	for ( size_t z = 0; z < side; z++ ) {
+		for ( size_t y = 0; y < side; y++ ) {
+			for ( size_t x = 0; x < side; x++, i++ ) {
+				const float v = src[ i ];
+				const double pred = recon.Predict( x, y, z );
+				const double q = std::nearbyint( ( v - pred ) / quantum );
+				const float r = float( pred + q * quantum );
+				if ( std::abs( q ) < MaxQuantum && std::abs( double( r ) - v ) <= tolerance ) {
+					const auto iq = int32_t( q );
+					symbols[ i ] = iq >= 0 ? uint32_t( iq ) << 1 : ( uint32_t( -iq ) << 1 ) - 1;
+					sum += symbols[ i ];
+					recon.Set( x, y, z, r );
+				} else {
+					symbols[ i ] = VerbatimSymbol;
+					verbatim.push_back( v );
+					recon.Set( x, y, z, v );
+				}
+			}
+		}
+	}
+	if ( sum == 0 && verbatim.empty() ) {
+		dst.push_back( ZeroBlock );
+		return 1;
+	}
+
+	// the Rice parameter that fits the mean symbol
+	const auto mean = sum / symbols.size();
+	int k = 0;
+	while ( k < 31 && ( uint64_t( 2 ) << k ) <= mean ) {
+		k++;
+	}
+	dst.push_back( (unsigned char)k );
+	BitWriter bits( dst );
+	size_t nextVerbatim = 0;
+	for ( const auto s : symbols ) {
+		const auto quotient = s == VerbatimSymbol ? MaxUnary : s >> k;
+		if ( quotient < MaxUnary ) {
+			bits.Write( ( uint64_t( 1 ) << quotient ) - 1, quotient + 1 );
+			bits.Write( s, k );
+			continue;
+		}
+		bits.Write( ( uint64_t( 1 ) << MaxUnary ) - 1, MaxUnary );
+		bits.Write( s, 32 );
+		if ( s == VerbatimSymbol ) {
+			uint32_t raw;
+			memcpy( &raw, &verbatim[ nextVerbatim++ ], sizeof( raw ) );
+			bits.Write( raw, 32 );
+		}
+	}
+	bits.Finish();
+	return dst.size() - begin;
+}
+
+bool DecodeFloatBlock( const unsigned char *src, size_t bytes, size_t side, float tolerance, float *dst )
+{
+	if ( bytes == 0 ) {
+		return false;
+	}
+	const double quantum = QuantumOf( tolerance );
+	ReconstructedBlock recon( side );
+	const int k = src[ 0 ];
+	if ( k != ZeroBlock && k > 31 ) {
+		return false;
+	}
+	BitReader bits( src + 1, src + bytes );
+	size_t i = 0;
+	for ( size_t z = 0; z < side; z++ ) {
+		for ( size_t y = 0; y < side; y++ ) {
+			for ( size_t x = 0; x < side; x++, i++ ) {
+				const double pred = recon.Predict( x, y, z );
+				uint32_t s = 0;
+				if ( k != ZeroBlock ) {
+					int quotient;
+					if ( !bits.ReadUnary( quotient ) ) {
+						return false;
+					}
+					uint32_t low;
+					if ( quotient < MaxUnary ) {
+						if ( !bits.Read( k, low ) ) {
+							return false;
+						}
+						s = ( uint32_t( quotient ) << k ) | low;
+					} else if ( !bits.Read( 32, s ) ) {
+						return false;
+					}
+				}
+				if ( s == VerbatimSymbol ) {
+					uint32_t raw;
+					if ( !bits.Read( 32, raw ) ) {
+						return false;
+					}
+					memcpy( &dst[ i ], &raw, sizeof( raw ) );
+					recon.Set( x, y, z, dst[ i ] );
+					continue;
+				}
+				const double q = ( s & 1 ) ? -double( ( s + 1 ) >> 1 ) : double( s >> 1 );
+				dst[ i ] = float( pred + q * quantum );
+				recon.Set( x, y, z, dst[ i ] );
+			}
+		}
+	}
+	return true;
+}
+
+CompressedLVDFile::CompressedLVDFile( const std::string &fileName, int threadCount )
+{
+	LVDFileHeader header;
+	if ( !ReadLVDFileHeader( fileName, header, error ) ) {
+		return;
+	}
+	if ( header.voxelType != LVDFileHeader::Float32 || header.compression != LVDFileHeader::FixedAccuracy ) {
+		error = "not a lossy compressed float volume";
+		return;
+	}
+	side = size_t( 1 ) << header.blockLengthInLog;
+	tolerance = header.errorBound;
+	dataOffset = header.HeaderSize();
+	const size_t blockCount = size_t( header.dataDim[ 0 ] / side ) * ( header.dataDim[ 1 ] / side ) * ( header.dataDim[ 2 ] / side );
+
+	std::ifstream in( fileName, std::ios::binary );
+	in.seekg( header.blockIndexOffset );
+	uint32_t magic = 0, reserved = 0;
+	uint64_t count = 0;
+	in.read( (char *)&magic, sizeof( magic ) );
+	in.read( (char *)&reserved, sizeof( reserved ) );
+	in.read( (char *)&count, sizeof( count ) );
+	if ( !in || magic != TableMagicNumber || count != blockCount ) {
+		error = "corrupted block table";
+		return;
+	}
+	std::vector<uint64_t> table( blockCount + 1 );
+	in.read( (char *)table.data(), table.size() * sizeof( uint64_t ) );
+	if ( !in ) {
+		error = "truncated block table";
+		return;
+	}
+	if ( table[ 0 ] != 0 || !std::is_sorted( table.begin(), table.end() ) || dataOffset + table.back() > header.blockIndexOffset ) {
+		error = "block table does not match the data";
+		return;
+	}
+	offsets = std::move( table );
+#ifndef _WIN32
+	fd = open( fileName.c_str(), O_RDONLY );
+	valid = fd >= 0;
+	if ( !valid ) {
+		error = "can not open " + fileName;
+		return;
+	}
+	threadCount = ( std::max )( threadCount, 1 );
+	for ( int i = 0; i < threadCount; i++ ) {
+		workers.emplace_back( [ this ]() { Work(); } );
+	}
+#else
+	(void)threadCount;
+	error = "compressed volumes are only read on POSIX systems";
+#endif
+}
+
+CompressedLVDFile::~CompressedLVDFile()
+{
+	{
+		std::lock_guard<std::mutex> lk( mtx );
+		stop = true;
+	}
+	cond.notify_all();
+	for ( auto &w : workers ) {
+		w.join();
+	}
+#ifndef _WIN32
+	if ( fd >= 0 ) {
+		close( fd );
+	}
+#endif
+}
+
+bool CompressedLVDFile::Read( size_t blockID, float *dst, std::vector<unsigned char> &staging ) const
+{
+#ifndef _WIN32
+	if ( !valid || blockID >= BlockCount() ) {
+		return false;
+	}
+	const auto bytes = CompressedBytes( blockID );
+	staging.resize( bytes );
+	size_t done = 0;
+	while ( done < bytes ) {
+		const auto n = pread( fd, staging.data() + done, bytes - done, dataOffset + offsets[ blockID ] + done );
+		if ( n <= 0 ) {
+			return false;
+		}
+		done += n;
+	}
+	const auto start = std::chrono::steady_clock::now();
+	const bool ok = DecodeFloatBlock( staging.data(), bytes, side, tolerance, dst );
+	decodeNanoseconds += std::chrono::duration_cast<std::chrono::nanoseconds>( std::chrono::steady_clock::now() - start ).count();
+	return ok;
+#else
+	(void)blockID;
+	(void)dst;
+	(void)staging;
+	return false;
+#endif
+}
+
+bool CompressedLVDFile::ReadBlock( size_t blockID, float *dst ) const
+{
+	std::vector<unsigned char> staging;
+	return Read( blockID, dst, staging );
+}
+
+BlockLoadStatistics CompressedLVDFile::Load( std::vector<Request> requests )
+{
+	BlockLoadStatistics stat;
+	if ( requests.empty() ) {
+		return stat;
+	}
+	const auto start = std::chrono::steady_clock::now();
+	// block order is file order, the whole batch is queued to the disk before the first read blocks
+	std::sort( requests.begin(), requests.end(), []( const Request &a, const Request &b ) { return a.first < b.first; } );
+	for ( const auto &r : requests ) {
+		if ( r.first < BlockCount() ) {
+			stat.bytes += CompressedBytes( r.first );
+#ifndef _WIN32
+			posix_fadvise( fd, dataOffset + offsets[ r.first ], CompressedBytes( r.first ), POSIX_FADV_WILLNEED );
+#endif
+		}
+	}
+
+	std::unique_lock<std::mutex> lk( mtx );
+	batch = std::move( requests );
+	nextRequest = 0;
+	finishedWorkers = 0;
+	generation++;
+	lk.unlock();
+	cond.notify_all();
+
+	lk.lock();
+	cond.wait( lk, [ this ]() { return finishedWorkers == workers.size(); } );
+	stat.blocks = batch.size();
+	stat.runs = batch.size();
+	if ( workers.empty() ) {
+		// no reader, the blocks are still defined
+		for ( const auto &r : batch ) {
+			memset( r.second, 0, BlockBytes() );
+		}
+		stat.bytes = 0;
+	}
+	lk.unlock();
+
+	stat.seconds = std::chrono::duration<double>( std::chrono::steady_clock::now() - start ).count();
+	total += stat;
+	return stat;
+}
+
+void CompressedLVDFile::Work()
+{
+	std::vector<unsigned char> staging;
+	size_t seen = 0;
+	while ( true ) {
+		std::unique_lock<std::mutex> lk( mtx );
+		cond.wait( lk, [ this, seen ]() { return stop || generation != seen; } );
+		if ( stop ) {
+			return;
+		}
+		seen = generation;
+		lk.unlock();
+
+		for ( auto i = nextRequest++; i < batch.size(); i = nextRequest++ ) {
+			const auto &r = batch[ i ];
+			if ( !Read( r.first, (float *)r.second, staging ) ) {
+				memset( r.second, 0, BlockBytes() );
+			}
+		}
+
+		lk.lock();
+		finishedWorkers++;
+		lk.unlock();
+		cond.notify_all();
+	}
+}
+
+CompressedLVDWriter::CompressedLVDWriter( const std::string &fileName, int blockSideInLog, int padding,
+										  const Size3 &blockDim, const Size3 &originalDataSize, float tolerance ) :
+  blockSideInLog( blockSideInLog ),
+  padding( padding ),
+  blockDim( blockDim ),
+  originalDataSize( originalDataSize ),
+  tolerance( tolerance ),
+  headerBytes( LVDFileHeader::DefaultHeaderSize ),
+  offsets( 1, 0 )
+{
+	out.open( fileName, std::ios::binary | std::ios::trunc );
+	valid = out.is_open() && tolerance > 0;
+	if ( valid ) {
+		// the header is written by Close() once the table offset is known
+		const std::vector<char> placeholder( headerBytes );
+		out.write( placeholder.data(), placeholder.size() );
+	}
+}
+
+CompressedLVDWriter::~CompressedLVDWriter()
+{
+	if ( out.is_open() ) {
+		Close();
+	}
+}
+
+size_t CompressedLVDWriter::AddBlock( const float *block )
+{
+	if ( !valid ) {
+		return 0;
+	}
+	encoded.clear();
+	const auto bytes = EncodeFloatBlock( block, size_t( 1 ) << blockSideInLog, tolerance, encoded );
+	out.write( (const char *)encoded.data(), bytes );
+	offsets.push_back( offsets.back() + bytes );
+	valid = bool( out );
+	return bytes;
+}
+
+bool CompressedLVDWriter::Close()
+{
+	if ( !out.is_open() ) {
+		return false;
+	}
+	const uint64_t blockCount = blockDim.Prod();
+	const bool complete = offsets.size() == blockCount + 1;
+	const uint64_t tableOffset = headerBytes + offsets.back();
+	const uint32_t magic = CompressedLVDFile::TableMagicNumber, reserved = 0;
+	out.seekp( tableOffset );
+	out.write( (const char *)&magic, sizeof( magic ) );
+	out.write( (const char *)&reserved, sizeof( reserved ) );
+	out.write( (const char *)&blockCount, sizeof( blockCount ) );
+	out.write( (const char *)offsets.data(), offsets.size() * sizeof( uint64_t ) );
+
+	LVDFileHeader header;
+	header.SetCurrentVersion();
+	header.headerSize = uint32_t( headerBytes );
+	header.blockLengthInLog = blockSideInLog;
+	header.padding = padding;
+	const size_t side = size_t( 1 ) << blockSideInLog;
+	header.dataDim[ 0 ] = uint32_t( blockDim.x * side );
+	header.dataDim[ 1 ] = uint32_t( blockDim.y * side );
+	header.dataDim[ 2 ] = uint32_t( blockDim.z * side );
+	header.originalDataDim[ 0 ] = uint32_t( originalDataSize.x );
+	header.originalDataDim[ 1 ] = uint32_t( originalDataSize.y );
+	header.originalDataDim[ 2 ] = uint32_t( originalDataSize.z );
+	header.voxelType = LVDFileHeader::Float32;
+	header.compression = LVDFileHeader::FixedAccuracy;
+	header.errorBound = tolerance;
+	header.blockIndexOffset = tableOffset;
+	out.seekp( 0 );
+	out.write( (const char *)header.Encode(), header.HeaderSize() );
+	const bool ok = valid && bool( out ) && complete;
+	out.close();
+	valid = false;
+	return ok;
+}
+
+}  // namespace vm
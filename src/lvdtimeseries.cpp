@@ -0,0 +1,254 @@
+#include <lvdtimeseries.h>
+#include "plugins/lvdfileheader.h"
+#include <algorithm>
+#include <cstring>
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+namespace vm
+{
+uint64_t HashBlock( const void *data, size_t bytes )
+{
+	const auto p = static_cast<const unsigned char *>( data );
+	uint64_t h = 0xcbf29ce484222325ull ^ bytes;
+	size_t i = 0;
+	// FNV-1a over 64 bit words with an extra shift to mix the high bits down
+	for ( ; i + 8 <= bytes; i += 8 ) {
+		uint64_t w;
+		memcpy( &w, p + i, 8 );
+		h = ( h ^ w ) * 0x100000001b3ull;
+		h ^= h >> 29;
+	}
+	for ( ; i < bytes; i++ ) {
+		h = ( h ^ p[ i ] ) * 0x100000001b3ull;
+	}
+	return h;
+}
+
+LVDTimeSeriesFile::LVDTimeSeriesFile( const std::string &fileName )
+{
+	LVDFileHeader header;
+	if ( !ReadLVDFileHeader( fileName, header, error ) ) {
+		return;
+	}
+	if ( header.voxelType != LVDFileHeader::UInt8 ) {
+		error = "only 8-bit voxels are supported";
+		return;
+	}
+	LVDBlockIndex index;
+	if ( !ReadLVDBlockIndex( fileName, header, index, error ) ) {
+		if ( error.empty() ) {
+			error = "no block index";
+		}
+		return;
+	}
+	const size_t side = size_t( 1 ) << header.blockLengthInLog;
+	blockBytes = side * side * side;
+	blockCount = index.blockCount;
+	dataOffset = header.HeaderSize();
+	timestepCount = index.timestepCount;
+	slotCount = index.slotCount;
+	slots = std::move( index.slots );
+#ifndef _WIN32
+	fd = open( fileName.c_str(), O_RDONLY );
+	valid = fd >= 0;
+	if ( !valid ) {
+		error = "can not open " + fileName;
+	}
+#else
+	error = "time series are only read on POSIX systems";
+#endif
+}
+
+LVDTimeSeriesFile::~LVDTimeSeriesFile()
+{
+#ifndef _WIN32
+	if ( fd >= 0 ) {
+		close( fd );
+	}
+#endif
+}
+
+size_t LVDTimeSeriesFile::StoredBlockCount( size_t timestep ) const
+{
+	// slots are appended in order, the new ones of a timestep lie above all earlier ones
+	size_t end = 0;
+	for ( size_t t = 0; t < timestep; t++ ) {
+		for ( size_t i = 0; i < blockCount; i++ ) {
+			end = ( std::max )( end, Slot( t, i ) + 1 );
+		}
+	}
+	size_t count = 0;
+	for ( size_t i = 0; i < blockCount; i++ ) {
+		count = ( std::max )( count, Slot( timestep, i ) + 1 );
+	}
+	return count > end ? count - end : 0;
+}
+
+bool LVDTimeSeriesFile::ReadSlot( size_t slot, void *dst ) const
+{
+#ifndef _WIN32
+	if ( !valid || slot >= slotCount ) {
+		return false;
+	}
+	size_t done = 0;
+	while ( done < blockBytes ) {
+		const auto n = pread( fd, (char *)dst + done, blockBytes - done, dataOffset + slot * blockBytes + done );
+		if ( n <= 0 ) {
+			return false;
+		}
+		done += n;
+	}
+	return true;
+#else
+	(void)slot;
+	(void)dst;
+	return false;
+#endif
+}
+
+void LVDTimeSeriesFile::Prefetch( const std::vector<size_t> &slotIDs ) const
+{
+#ifndef _WIN32
+	for ( const auto slot : slotIDs ) {
+		if ( valid && slot < slotCount ) {
+			posix_fadvise( fd, dataOffset + slot * blockBytes, blockBytes, POSIX_FADV_WILLNEED );
+		}
+	}
+#else
+	(void)slotIDs;
+#endif
+}
+
+LVDTimeSeriesWriter::LVDTimeSeriesWriter( const std::string &fileName, int blockSideInLog, int padding,
+										  const Size3 &blockDim, const Size3 &originalDataSize ) :
+  fileName( fileName ),
+  blockSideInLog( blockSideInLog ),
+  padding( padding ),
+  blockDim( blockDim ),
+  originalDataSize( originalDataSize ),
+  blockCount( blockDim.Prod() ),
+  blockBytes( size_t( 1 ) << ( 3 * blockSideInLog ) ),
+  headerBytes( LVDFileHeader::DefaultHeaderSize ),
+  stored( blockBytes )
+{
+	out.open( fileName, std::ios::in | std::ios::out | std::ios::binary | std::ios::trunc );
+	valid = out.is_open();
+	if ( valid ) {
+		// the header is written by Close() once the index offset is known
+		const std::vector<char> placeholder( headerBytes );
+		out.write( placeholder.data(), placeholder.size() );
+	}
+}
+
+LVDTimeSeriesWriter::~LVDTimeSeriesWriter()
+{
+	if ( out.is_open() ) {
+		Close();
+	}
+}
+
+size_t LVDTimeSeriesWriter::FindSlot( uint64_t hash, const unsigned char *data )
+{
+	const auto it = slotsByHash.find( hash );
+	if ( it == slotsByHash.end() ) {
+		return NoSlot;
+	}
+	// a hash match is only a candidate, the stored block decides
+	for ( const auto slot : it->second ) {
+		out.seekg( headerBytes + size_t( slot ) * blockBytes );
+		out.read( (char *)stored.data(), blockBytes );
+		if ( !out ) {
+			out.clear();
+			continue;
+		}
+		if ( memcmp( stored.data(), data, blockBytes ) == 0 ) {
+			return slot;
+		}
+	}
+	return NoSlot;
+}
+
+size_t LVDTimeSeriesWriter::AddTimestep( const BlockGetter &getBlock )
+{
+	if ( !valid ) {
+		return 0;
+	}
+	const std::vector<unsigned char> zero( blockBytes, 0 );
+	const size_t base = slots.size();
+	slots.resize( base + blockCount );
+	std::vector<uint64_t> current( blockCount );
+	size_t added = 0;
+	for ( size_t i = 0; i < blockCount; i++ ) {
+		auto data = (const unsigned char *)getBlock( i );
+		if ( data == nullptr ) {
+			data = zero.data();
+		}
+		const auto hash = HashBlock( data, blockBytes );
+		current[ i ] = hash;
+		// the same block of the previous timestep is the likeliest match and needs no lookup
+		if ( timestepCount > 0 && hash == hashes[ i ] ) {
+			const auto previous = slots[ base - blockCount + i ];
+			out.seekg( headerBytes + previous * blockBytes );
+			out.read( (char *)stored.data(), blockBytes );
+			if ( out && memcmp( stored.data(), data, blockBytes ) == 0 ) {
+				slots[ base + i ] = previous;
+				continue;
+			}
+			out.clear();
+		}
+		auto slot = FindSlot( hash, data );
+		if ( slot == NoSlot ) {
+			slot = slotCount++;
+			out.seekp( headerBytes + slot * blockBytes );
+			out.write( (const char *)data, blockBytes );
+			slotsByHash[ hash ].push_back( uint32_t( slot ) );
+			added++;
+		}
+		slots[ base + i ] = uint32_t( slot );
+	}
+	hashes = std::move( current );
+	valid = bool( out );
+	timestepCount++;
+	return added;
+}
+
+bool LVDTimeSeriesWriter::Close()
+{
+	if ( !out.is_open() ) {
+		return false;
+	}
+	const uint64_t indexOffset = headerBytes + slotCount * blockBytes;
+	const uint32_t magic = LVDBlockIndex::MagicNumber, count = uint32_t( timestepCount );
+	const uint64_t slotTotal = slotCount;
+	out.seekp( indexOffset );
+	out.write( (const char *)&magic, sizeof( magic ) );
+	out.write( (const char *)&count, sizeof( count ) );
+	out.write( (const char *)&slotTotal, sizeof( slotTotal ) );
+	out.write( (const char *)slots.data(), slots.size() * sizeof( uint32_t ) );
+
+	LVDFileHeader header;
+	header.SetCurrentVersion();
+	header.headerSize = uint32_t( headerBytes );
+	header.blockLengthInLog = blockSideInLog;
+	header.padding = padding;
+	const size_t side = size_t( 1 ) << blockSideInLog;
+	header.dataDim[ 0 ] = uint32_t( blockDim.x * side );
+	header.dataDim[ 1 ] = uint32_t( blockDim.y * side );
+	header.dataDim[ 2 ] = uint32_t( blockDim.z * side );
+	header.originalDataDim[ 0 ] = uint32_t( originalDataSize.x );
+	header.originalDataDim[ 1 ] = uint32_t( originalDataSize.y );
+	header.originalDataDim[ 2 ] = uint32_t( originalDataSize.z );
+	header.blockIndexOffset = indexOffset;
+	out.seekp( 0 );
+	out.write( (const char *)header.Encode(), header.HeaderSize() );
+	const bool ok = valid && bool( out ) && timestepCount > 0;
+	out.close();
+	valid = false;
+	return ok;
+}
+
+}  // namespace vm
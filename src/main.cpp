@@ -1,8 +1,10 @@
 // std related
 #include <iostream>
 #include <fstream>
+#include <limits>
 #include <memory>
 #include <random>
+#include <thread>
 
 // other dependences
 #include <VMat/geometry.h>
@@ -27,6 +29,17 @@
 
 #include <voxelman.h>
 #include <optimizedcache.h>
+#include <renderservice.h>
+#include <camerapath.h>
+#include <blockprefetcher.h>
+#include <imagewriter.h>
+#include <shading.h>
+#include <virtualpagetable.h>
+#include <batchblockloader.h>
+#include <residentblocks.h>
+#include <timeseries.h>
+#include <sliceextractor.h>
+#include "plugins/lvdfileheader.h"
 using namespace vm;
 using namespace std;
 
@@ -46,10 +59,12 @@ string GetTextFromFile( const string &fileName )
 vector<Ref<Block3DCache>> SetupVolumeData(
   const std::string &fileName,
   PluginLoader &pluginLoader,
-  size_t availableHostMemoryHint, bool create, const Block3DDataFileDesc *desc )
+  size_t availableHostMemoryHint, bool create, const Block3DDataFileDesc *desc,
+  vector<Ref<I3DBlockFilePluginInterface>> &volumeFiles, bool directIO = false )
 {
 	int lodCount = 1;
 	vector<Ref<Block3DCache>> volumeData( lodCount );
+	volumeFiles.assign( lodCount, nullptr );
 	if ( create == false ) {
 		if ( fileName.empty() ) {
 			return {};
@@ -57,12 +72,15 @@ vector<Ref<Block3DCache>> SetupVolumeData(
 		try {
 			for ( int i = 0; i < lodCount; i++ ) {
 				const auto cap = fileName.substr( fileName.find_last_of( '.' ) );
-				auto p = pluginLoader.CreatePlugin<I3DBlockFilePluginInterface>( cap );
+				// .lvd files can be read with O_DIRECT instead of being mapped
+				const auto key = directIO && cap == ".lvd" ? cap + ".direct" : cap;
+				auto p = pluginLoader.CreatePlugin<I3DBlockFilePluginInterface>( key );
 				if ( !p ) {
 					LOG_DEBUG << "Failed to load plugin to read " << cap << " file.";
 					return {};
 				}
 				p->Open( fileName.c_str() );
+				volumeFiles[ i ] = p;
 				volumeData[ i ] = VM_NEW<MortonCodeCache>( p, [ &availableHostMemoryHint ]( I3DBlockDataInterface *p ) {
 					// this a
 					const auto bytes = p->GetDataSizeWithoutPadding().Prod();
@@ -97,6 +115,7 @@ vector<Ref<Block3DCache>> SetupVolumeData(
 			LOG_DEBUG << "Can not create data file";
 			return {};
 		}
+		volumeFiles[ 0 ] = p;
 		volumeData[ 0 ] = VM_NEW<Block3DCache>( p, [ &availableHostMemoryHint ]( I3DBlockDataInterface *p ) {
 			const auto bytes = p->GetDataSizeWithoutPadding().Prod();
 			size_t th = 2 * 1024 * 1024 * size_t( 1024 );  // 2GB as default
@@ -141,6 +160,35 @@ int main( int argc, char **argv )
 		app->cmd.add<string>( "tf", '\0', "Specifies transfer function name", false );
 		app->cmd.add<string>( "pd", '\0', "Specifies plugin load directoy", false, "plugins" );
 		app->cmd.add<string>( "nw", 'n', "Launches without window, just render one frame and output", false );
+		app->cmd.add<string>( "service", '\0', "Runs as a headless render service reading jobs from stdin (-) or a local socket path", false );
+		app->cmd.add<string>( "campath", '\0', "Renders all frames of a camera path json file without window", false );
+		app->cmd.add<string>( "timeseries", '\0', "Plays the timesteps of a time series json file at its frame rate, sharing the page table budget (ptmem) across timesteps", false );
+		app->cmd.add<string>( "pack", '\0', "Packs the time series, or the volume, into a .lvts file that stores identical blocks once and exits", false );
+		app->cmd.add<string>( "out", 'o', "Specifies the image file of offscreen rendering, .png, .ppm, .qoi or .raw", false, "render_result.png" );
+		app->cmd.add<int>( "encoders", '\0', "Specifies the number of image encoding threads", false, 2 );
+		app->cmd.add<int>( "png-level", '\0', "Specifies the PNG compression level, 1 is the fastest", false, 8 );
+		app->cmd.add<string>( "order", '\0', "Specifies the pixel traversal order, rowmajor, morton or hilbert", false, "hilbert" );
+		app->cmd.add<int>( "tile", '\0', "Specifies the tile size of morton and hilbert pixel order", false, 32 );
+		app->cmd.add<string>( "schedule", '\0', "Specifies ray scheduling, ray traces each ray to the end, block processes all rays of a block at once, pagetable suspends rays at unmapped blocks and refines in passes", false, "ray" );
+		app->cmd.add<string>( "zero-copy", '\0', "Specifies whether a resident .lvd volume is sampled straight from its mapping, auto does so if it fits in hmem", false, "auto" );
+		app->cmd.add( "mlock", '\0', "Locks a zero copy volume in memory" );
+		app->cmd.add<string>( "io", '\0', "Specifies how blocks are read, mmap maps the file, batch reads missed blocks of the page table as sorted and merged runs with pread, direct also bypasses the page cache with O_DIRECT", false, "batch" );
+		app->cmd.add<int>( "io-threads", '\0', "Specifies the number of threads reading missed blocks", false, 4 );
+		app->cmd.add<size_t>( "ptmem", '\0', "Specifies the physical memory of the page table in MB", false, 1024 );
+		app->cmd.add<string>( "shading", '\0', "Specifies the shading model, none, phong or blinn", false, "none" );
+		app->cmd.add<string>( "gradient", '\0', "Specifies how shading gets gradients, otf estimates them per sample, cache precomputes them per block, file reads them from the gradient sidecar", false, "otf" );
+		app->cmd.add<size_t>( "gmem", '\0', "Specifies the memory of the gradient cache in MB", false, 512 );
+		app->cmd.add( "make-gradient", '\0', "Writes the gradient sidecar .grad.lvd of the data file and exits" );
+		app->cmd.add( "skip-empty", '\0', "Builds a min/max octree of the volume when it opens and leaps over space the transfer function makes transparent" );
+		app->cmd.add<int>( "brick", '\0', "Specifies the side of the smallest octree node of empty space skipping", false, 8 );
+		app->cmd.add<string>( "traversal", '\0', "Specifies how rays of the ray schedule walk the block grid, vmat uses the VMat interval iterator, dda a 3D-DDA sharing the entry of 8x8 pixel tiles", false, "vmat" );
+		app->cmd.add( "occlusion", '\0', "Records where rays turn opaque, blocks hidden in the last frame are prefetched last and evicted first" );
+		app->cmd.add<string>( "projection", '\0', "Specifies the projection of the CPU renderer, perspective or orthographic", false, "perspective" );
+		app->cmd.add<float>( "ortho-height", '\0', "Specifies the world space height of the orthographic film, 0 fits the volume", false, 0 );
+		app->cmd.add<string>( "views", '\0', "Renders the views of a view set json file, or the six axis views of the volume with axes, in one block scheduled pass without window", false );
+		app->cmd.add<string>( "slice", '\0', "Writes slices of the volume as images without window, axis:position (e.g. z:128) for one axis aligned slice, axis:all for all of them, view for the oblique slice through the volume center facing the camera", false );
+		app->cmd.add<string>( "mode", '\0', "Specifies how the ray schedule combines samples, composite blends them through the transfer function, mip, minip and aip project their maximum, minimum or average intensity", false, "composite" );
+		app->cmd.add( "order-bench", '\0', "Compares frame time and cache hit rate of all pixel orders and exits" );
 		app->cmd.parse_check( argc, argv );
 
 		app->WindowSize.x = app->cmd.get<int>( "width" );
@@ -150,6 +198,70 @@ int main( int argc, char **argv )
 		app->TFFileName = app->cmd.get<string>( "tf" );
 		app->PluginDir = app->cmd.get<string>( "pd" );
 		app->hasWindow = app->cmd.exist( "nw" );
+		app->ServiceEndpoint = app->cmd.get<string>( "service" );
+		app->CameraPathFileName = app->cmd.get<string>( "campath" );
+		app->OutputFileName = app->cmd.get<string>( "out" );
+		app->EncoderCount = app->cmd.get<int>( "encoders" );
+		SetPNGCompressionLevel( app->cmd.get<int>( "png-level" ) );
+		app->pixelOrder = PixelOrderFromName( app->cmd.get<string>( "order" ) );
+		app->tileSize = app->cmd.get<int>( "tile" );
+		app->OrderBenchmark = app->cmd.exist( "order-bench" );
+		app->blockScheduling = app->cmd.get<string>( "schedule" ) == "block";
+		app->pageTableScheduling = app->cmd.get<string>( "schedule" ) == "pagetable";
+		app->pageTableBytes = app->cmd.get<size_t>( "ptmem" ) * 1024 * 1024;
+		app->directIO = app->cmd.get<string>( "io" ) == "direct";
+		app->zeroCopy = app->cmd.get<string>( "zero-copy" );
+		app->lockVolume = app->cmd.exist( "mlock" );
+		app->hostMemoryBytes = app->cmd.get<size_t>( "hmem" ) * 1024 * 1024;
+		app->batchIO = app->cmd.get<string>( "io" ) == "batch" || app->directIO;
+		app->ioThreadCount = app->cmd.get<int>( "io-threads" );
+		app->shading = ShadingModelFromName( app->cmd.get<string>( "shading" ) );
+		app->cacheGradients = app->cmd.get<string>( "gradient" ) != "otf";
+		app->gradientSidecar = app->cmd.get<string>( "gradient" ) == "file";
+		app->MakeGradientSidecar = app->cmd.exist( "make-gradient" );
+		app->gradientCacheBytes = app->cmd.get<size_t>( "gmem" ) * 1024 * 1024;
+		app->TimeSeriesFileName = app->cmd.get<string>( "timeseries" );
+		app->PackTimeSeriesFileName = app->cmd.get<string>( "pack" );
+		app->skipEmptySpace = app->cmd.exist( "skip-empty" );
+		app->brickSize = app->cmd.get<int>( "brick" );
+		app->ddaTraversal = app->cmd.get<string>( "traversal" ) == "dda";
+		app->orthographic = app->cmd.get<string>( "projection" ) == "orthographic";
+		app->orthoHeight = app->cmd.get<float>( "ortho-height" );
+		app->ViewSetName = app->cmd.get<string>( "views" );
+		app->SliceSpec = app->cmd.get<string>( "slice" );
+		if ( app->cmd.exist( "occlusion" ) ) {
+			if ( app->orthographic ) {
+				// the buffer culls by distance from the eye, orthographic rays have none
+				LOG_INFO << "Occlusion culling is not available with orthographic projection";
+			} else {
+				app->occlusion = std::make_unique<OcclusionBuffer>( 8 );
+			}
+		}
+		if ( !app->TimeSeriesFileName.empty() ) {
+			try {
+				app->timeSeriesFileNames = LoadTimeSeries( app->TimeSeriesFileName, app->timeSeriesFPS, app->timeSeriesOutput );
+			} catch ( std::exception &e ) {
+				LOG_CRITICAL << e.what();
+			}
+			if ( !app->timeSeriesFileNames.empty() ) {
+				// the layout comes from the first timestep, blocks of all timesteps go through one page table
+				app->DataFileName = app->timeSeriesFileNames[ 0 ];
+				app->pageTableScheduling = true;
+			}
+		}
+
+		app->intensityProjection = IntensityProjectionFromName( app->cmd.get<string>( "mode" ) );
+		if ( app->intensityProjection != IntensityProjection::None ) {
+			if ( !app->timeSeriesFileNames.empty() || !app->ViewSetName.empty() ) {
+				// both composite through blocks in their own order
+				LOG_INFO << "Intensity projection is not available for time series and view sets";
+				app->intensityProjection = IntensityProjection::None;
+			} else {
+				// samples are projected ray by ray, there is no opacity to cull by
+				app->blockScheduling = app->pageTableScheduling = false;
+				app->occlusion = nullptr;
+			}
+		}
 
 		LOG_INFO << "Load plugins from " << app->PluginDir;
 		vm::PluginLoader::LoadPlugins( app->PluginDir );  // load plugins from the directory
@@ -201,8 +313,280 @@ int main( int argc, char **argv )
 		app->screenToWorld = app->inverseLookAt * app->invPersp * screenToPerps;
 	};
 
+	auto ApplyCamera = [ & ]( const ViewingTransform &camera ) {
+		app->camera = camera;
+		app->eye = app->camera.GetViewMatrixWrapper().GetPosition();
+		UpdateTransform();
+	};
+
+	/**
+	 * @brief Returns the ray of pixel ( x, y ) of the current film. Perspective rays leave the
+	 * eye, orthographic rays leave the plane through the eye facing the viewing direction.
+	 */
+	auto PixelRay = [ & ]( int x, int y ) -> Ray {
+		if ( !app->orthographic ) {
+			cauto pWorld = app->screenToWorld * Point3f( x, y, 0 );
+			return Ray( pWorld - app->eye, app->eye );
+		}
+		cauto &view = app->camera.GetViewMatrixWrapper();
+		cauto &size = app->dataResolution;
+		cauto height = app->orthoHeight > 0 ? app->orthoHeight : std::sqrt( float( size.x * size.x + size.y * size.y + size.z * size.z ) );
+		cauto u = ( 2.f * x / app->screenSize.x - 1 ) * 0.5f * height * app->aspect;
+		cauto v = ( 1 - 2.f * y / app->screenSize.y ) * 0.5f * height;
+		return Ray( view.GetFront().Normalized(), app->eye + view.GetRight().Normalized() * u + view.GetUp().Normalized() * v );
+	};
+
+	auto ApplyCameraFromFile = [ & ]( const std::string &fileName ) -> bool {
+		try {
+			ApplyCamera( ConfigCamera( fileName ) );
+		} catch ( std::exception &e ) {
+			LOG_CRITICAL << "Can not open .cam file: " << e.what();
+			return false;
+		}
+		return true;
+	};
+
+	auto OpenGradientSidecar = [ & ]( const std::string &fileName ) {
+		app->gradientFile = nullptr;
+		cauto sidecarName = GradientSidecarFileName( fileName );
+		if ( ifstream( sidecarName ).good() == false ) {
+			LOG_INFO << "No gradient sidecar " << sidecarName << ", gradients are computed per block";
+			return;
+		}
+		Ref<I3DBlockFilePluginInterface> sidecar = PluginLoader::GetPluginLoader()->CreatePlugin<I3DBlockFilePluginInterface>( ".lvd" );
+		if ( !sidecar ) {
+			LOG_CRITICAL << "Failed to load plugin to read gradient sidecar";
+			return;
+		}
+		try {
+			sidecar->Open( sidecarName );
+		} catch ( std::runtime_error &e ) {
+			LOG_CRITICAL << e.what();
+			return;
+		}
+		cauto blockCount = size_t( app->gridCount.Prod() );
+		if ( int( sidecar->Get3DPageSize().x ) != app->blockSize.x || sidecar->GetVirtualPageCount() != 3 * blockCount ) {
+			LOG_CRITICAL << "Gradient sidecar " << sidecarName << " does not match the block layout of " << fileName;
+			return;
+		}
+		app->gradientFile = sidecar;
+		cauto planeBytes = GradientPageBytes( app->blockSize.x ) / 3;
+		app->gradientCache->SetPageLoader( [ sidecar, blockCount, planeBytes ]( size_t blockID, int8_t *page ) {
+			for ( int c = 0; c < 3; c++ ) {
+				cauto src = sidecar->GetPage( blockID + c * blockCount );
+				if ( src == nullptr ) {
+					return false;
+				}
+				ToggleGradientBias( src, page + c * planeBytes, planeBytes );
+			}
+			return true;
+		} );
+		LOG_INFO << "Gradients are read from " << sidecarName;
+	};
+
+	/**
+	 * @brief Samples a resident volume from the mapping of its file instead of copying it into the cache
+	 */
+	auto SetupZeroCopy = [ & ]( const std::string &fileName ) {
+		cauto blockCount = size_t( app->gridCount.Prod() );
+		cauto blockBytes = size_t( app->blockSize.Prod() );
+		cauto isLVD = fileName.size() > 4 && fileName.substr( fileName.size() - 4 ) == ".lvd";
+		// the direct backend hands out short lived read buffers, not the mapping
+		if ( app->zeroCopy == "off" || app->directIO || !isLVD ) {
+			return;
+		}
+		if ( app->zeroCopy == "auto" && blockCount * blockBytes > app->hostMemoryBytes ) {
+			return;
+		}
+		// the pixel order benchmark measures the cache, a mapped volume would never miss it
+		if ( app->OrderBenchmark ) {
+			LOG_INFO << "Zero copy is off while the pixel orders are compared";
+			return;
+		}
+		auto file = app->volumeFiles[ 0 ];
+		auto table = std::make_unique<ResidentBlockTable>(
+		  [ file ]( size_t blockID ) { return file->GetPage( blockID ); }, blockCount, blockBytes, true, app->lockVolume );
+		if ( table->Valid() == false ) {
+			return;
+		}
+		app->residentBlocks = std::move( table );
+		// the cache is only asked for the volume layout from now on
+		app->volumeData[ 0 ] = VM_NEW<MortonCodeCache>( file, []( I3DBlockDataInterface * ) { return Size3{ 1, 1, 1 }; } );
+		LOG_INFO << "Zero copy: sampling " << blockCount * blockBytes / 1024 / 1024 << " MB straight from the mapping"
+				 << ( app->residentBlocks->Locked() ? ", locked" : "" );
+	};
+
+	/**
+	 * @brief Builds the min/max octree of the opened volume on all cores and classifies it
+	 * with the current transfer function
+	 */
+	auto BuildEmptySpaceOctree = [ & ]() {
+		app->emptySpace = nullptr;
+		cauto &blockSize = app->blockSize;
+		if ( blockSize.x != blockSize.y || blockSize.x != blockSize.z ) {
+			LOG_CRITICAL << "Empty space skipping needs cubic blocks";
+			return;
+		}
+		cauto blockBytes = size_t( blockSize.Prod() );
+		auto file = app->volumeFiles[ 0 ];
+		auto LoadBlock = [ &, file ]( size_t blockID, void *page ) {
+			if ( app->residentBlocks ) {
+				memcpy( page, app->residentBlocks->GetPage( blockID ), blockBytes );
+				return true;
+			}
+			cauto src = file->GetPage( blockID );
+			if ( src == nullptr ) {
+				return false;
+			}
+			memcpy( page, src, blockBytes );
+			file->UnlockPage( blockID );
+			return true;
+		};
+		cauto threadCount = int( ( std::max )( std::thread::hardware_concurrency(), 1u ) );
+		app->emptySpace = std::make_unique<MinMaxOctree>( LoadBlock, app->gridCount, blockSize.x, app->brickSize, threadCount );
+		app->emptySpace->Classify( app->transferFunction.data() );
+		if ( !app->emptySpace->Valid() ) {
+			LOG_CRITICAL << "Some blocks could not be read, they are never skipped";
+		}
+		LOG_INFO << "Empty space octree: " << app->emptySpace->LevelCount() << " levels, " << app->emptySpace->NodeCount()
+				 << " nodes, built in " << app->emptySpace->BuildSeconds() << "(s) on " << threadCount << " threads";
+	};
+
+	/**
+	 * @brief Opens the loader the page table reads the missed blocks of \a fileName with, if batched
+	 */
+	auto OpenBatchLoader = [ & ]( const std::string &fileName ) {
+		cauto pageBytes = size_t( app->blockSize.Prod() );
+		app->batchLoader = nullptr;
+		if ( app->batchIO && fileName.substr( fileName.find_last_of( '.' ) ) == ".lvd" ) {
+			LVDFileHeader header;
+			std::string error;
+			if ( !ReadLVDFileHeader( fileName, header, error ) ) {
+				LOG_CRITICAL << fileName << ": " << error << ", missed blocks are copied from the mapping";
+				return;
+			}
+			app->batchLoader = std::make_unique<BatchBlockLoader>( fileName, header.HeaderSize(), app->gridCount.Prod(), pageBytes,
+																   app->ioThreadCount, 8 * 1024 * 1024, app->directIO );
+			if ( app->batchLoader->Valid() == false ) {
+				LOG_CRITICAL << "Batched block reading is not available, missed blocks are copied from the mapping";
+				app->batchLoader = nullptr;
+			}
+		}
+	};
+
+	/**
+	 * @brief Opens a file with a block index (a .lvts time series or a deduplicated volume)
+	 * for the page table. Its virtual pages are the stored slots, so identical blocks and
+	 * blocks unchanged between timesteps are one resident page. Returns false if
+	 * \a fileName has no usable index.
+	 */
+	auto OpenBlockIndexedFile = [ & ]( const std::string &fileName ) -> bool {
+		cauto blockCount = size_t( app->gridCount.Prod() );
+		cauto pageBytes = size_t( app->blockSize.Prod() );
+		app->timeSeriesContainer = nullptr;
+		auto container = std::make_unique<LVDTimeSeriesFile>( fileName );
+		if ( !container->Valid() ) {
+			return false;
+		}
+		if ( container->BlockCount() != blockCount || container->BlockBytes() != pageBytes ) {
+			LOG_CRITICAL << fileName << ": block index does not match the volume";
+			return false;
+		}
+		cauto slotCount = container->SlotCount();
+		app->pageTable = std::make_unique<VirtualPageTable>( slotCount, pageBytes, app->pageTableBytes / pageBytes );
+		app->batchLoader = nullptr;
+		if ( app->batchIO ) {
+			app->batchLoader = std::make_unique<BatchBlockLoader>( fileName, container->DataOffset(), slotCount, pageBytes,
+																   app->ioThreadCount, 8 * 1024 * 1024, app->directIO );
+			if ( app->batchLoader->Valid() == false ) {
+				app->batchLoader = nullptr;
+			}
+		}
+		LOG_INFO << fileName << ": " << container->TimestepCount() << " timesteps, " << slotCount << " stored blocks for "
+				 << blockCount * container->TimestepCount() << " blocks";
+		app->timeSeriesContainer = std::move( container );
+		return true;
+	};
+
+	/**
+	 * @brief Returns the file of timestep \a t of a series of files, opening it on first use.
+	 * Only the most recently used timesteps stay open, each open file holds a descriptor and
+	 * possibly a mapping. A prefetch still reading a closed timestep keeps its reference.
+	 * Returns nullptr if the file can not be opened or its blocks differ from the volume's.
+	 */
+	auto OpenTimestep = [ & ]( size_t t ) -> Ref<I3DBlockFilePluginInterface> {
+		constexpr size_t MaxOpenTimesteps = 4;
+		auto &open = app->openTimesteps;
+		cauto it = std::find( open.begin(), open.end(), t );
+		if ( it != open.end() ) {
+			open.erase( it );
+			open.push_back( t );
+			return app->timeSeriesFiles[ t ];
+		}
+		cauto &fileName = app->timeSeriesFileNames[ t ];
+		cauto ext = fileName.substr( fileName.find_last_of( '.' ) );
+		auto file = PluginLoader::GetPluginLoader()->CreatePlugin<I3DBlockFilePluginInterface>( app->directIO && ext == ".lvd" ? ext + ".direct" : ext );
+		if ( !file ) {
+			LOG_CRITICAL << "Failed to load plugin to read " << ext << " file.";
+			return nullptr;
+		}
+		try {
+			file->Open( fileName );
+		} catch ( std::exception &e ) {
+			LOG_CRITICAL << fileName << ": " << e.what();
+			return nullptr;
+		}
+		if ( file->GetVirtualPageCount() != size_t( app->gridCount.Prod() ) || size_t( file->Get3DPageSize().Prod() ) != size_t( app->blockSize.Prod() ) ) {
+			LOG_CRITICAL << fileName << " does not have the block layout of the first timestep";
+			return nullptr;
+		}
+		if ( open.size() >= MaxOpenTimesteps ) {
+			app->timeSeriesFiles[ open.front() ] = nullptr;
+			open.pop_front();
+		}
+		app->timeSeriesFiles[ t ] = file;
+		open.push_back( t );
+		return file;
+	};
+
+	/**
+	 * @brief Opens the first timestep of the series, the others are opened by OpenTimestep as
+	 * they are played. Timestep t owns the virtual pages [t * blockCount, (t + 1) * blockCount)
+	 * of one page table, so all timesteps compete for the same physical pages. A .lvts
+	 * container is opened by OpenBlockIndexedFile.
+	 */
+	auto OpenTimeSeries = [ & ]() -> bool {
+		cauto blockCount = size_t( app->gridCount.Prod() );
+		cauto pageBytes = size_t( app->blockSize.Prod() );
+		cauto &firstName = app->timeSeriesFileNames[ 0 ];
+		app->timeSeriesFiles.clear();
+		app->openTimesteps.clear();
+		app->timeSeriesContainer = nullptr;
+		app->timeStep = 0;
+		if ( firstName.size() > 5 && firstName.substr( firstName.size() - 5 ) == ".lvts" ) {
+			if ( !OpenBlockIndexedFile( firstName ) ) {
+				LOG_CRITICAL << "Failed to open the time series container " << firstName;
+				return false;
+			}
+			return true;
+		}
+		app->timeSeriesFiles.assign( app->timeSeriesFileNames.size(), nullptr );
+		if ( !OpenTimestep( 0 ) ) {
+			return false;
+		}
+		app->pageTable = std::make_unique<VirtualPageTable>( blockCount * app->timeSeriesFiles.size(), pageBytes, app->pageTableBytes / pageBytes );
+		OpenBatchLoader( app->timeSeriesFileNames[ 0 ] );
+		LOG_INFO << "Time series of " << app->timeSeriesFiles.size() << " timesteps, " << app->pageTableBytes / pageBytes
+				 << " pages shared by " << blockCount * app->timeSeriesFiles.size() << " blocks";
+		return true;
+	};
+
 	auto OpenVolumeDataFromFile = [ & ]( const std::string &fileName ) {
-		app->volumeData = SetupVolumeData( fileName, *PluginLoader::GetPluginLoader(), 2000, false, nullptr );
+		app->residentBlocks = nullptr;
+		app->timeSeriesContainer = nullptr;
+		app->emptySpace = nullptr;
+		app->volumeData = SetupVolumeData( fileName, *PluginLoader::GetPluginLoader(), 2000, false, nullptr, app->volumeFiles, app->directIO );
+		app->gradientCache = nullptr;
 		// update Bound
 		if ( app->volumeData.empty() == false ) {
 			Point3i minP{ 0, 0, 0 };
@@ -213,11 +597,41 @@ int main( int argc, char **argv )
 			app->dataResolution = Vec3i( dataSize );
 			app->gridCount = Vec3i( volume->BlockDim() );
 			app->blockSize = Vec3i( volume->BlockSize() );
+			if ( app->timeSeriesFileNames.empty() ) {
+				SetupZeroCopy( fileName );
+			}
+			if ( app->cacheGradients ) {
+				cauto pages = app->gradientCacheBytes / GradientPageBytes( app->blockSize.x );
+				app->gradientCache = std::make_unique<GradientCache>( app->blockSize.x, pages );
+			}
+			if ( app->gradientSidecar && app->timeSeriesFileNames.empty() ) {
+				OpenGradientSidecar( fileName );
+			} else if ( app->gradientSidecar ) {
+				LOG_INFO << "Gradient sidecars are not read for time series, gradients are computed";
+			}
+			if ( !app->timeSeriesFileNames.empty() ) {
+				if ( !OpenTimeSeries() ) {
+					app->timeSeriesFiles.clear();
+					app->openTimesteps.clear();
+				}
+			} else if ( app->pageTableScheduling && !OpenBlockIndexedFile( fileName ) ) {
+				cauto pageBytes = size_t( app->blockSize.Prod() );
+				app->pageTable = std::make_unique<VirtualPageTable>( app->gridCount.Prod(), pageBytes, app->pageTableBytes / pageBytes );
+				OpenBatchLoader( fileName );
+			}
+			// the octree holds one volume, timesteps would each need their own
+			// the block ranges of the octree let MIP and MinIP skip blocks
+			cauto needRanges = app->intensityProjection == IntensityProjection::Maximum || app->intensityProjection == IntensityProjection::Minimum;
+			if ( ( app->skipEmptySpace || needRanges ) && app->timeSeriesFileNames.empty() ) {
+				BuildEmptySpaceOctree();
+			} else if ( app->skipEmptySpace ) {
+				LOG_INFO << "Empty space is not skipped in time series";
+			}
 		}
 	};
 
 	auto CreateVolumeDataIntoFile = [ & ]( const Block3DDataFileDesc &desc ) {
-		app->volumeData = SetupVolumeData( "", *PluginLoader::GetPluginLoader(), 2000, true, &desc );
+		app->volumeData = SetupVolumeData( "", *PluginLoader::GetPluginLoader(), 2000, true, &desc, app->volumeFiles );
 		// update Bound
 		if ( app->volumeData.empty() == false ) {
 			Point3i minP{ 0, 0, 0 };
@@ -231,12 +645,24 @@ int main( int argc, char **argv )
 		}
 	};
 
+	/**
+	 * @brief Reclassifies the empty space after the transfer function changed. Voxels are not
+	 * read and only nodes holding values whose opacity became or stopped being zero are visited.
+	 */
+	auto TransferFunctionChanged = [ & ]() {
+		if ( app->emptySpace ) {
+			cauto flipped = app->emptySpace->Classify( app->transferFunction.data() );
+			LOG_INFO << "Transfer function changed the visibility of " << flipped << " of " << app->emptySpace->NodeCount() << " octree nodes";
+		}
+	};
+
 	auto UpdateTransferFunctionFromFile = [ & ]( const std::string &fileName, int dimension ) {
 		assert( dimension == 256 );
 		if ( !fileName.empty() ) {
 			ColorInterpulator a( fileName );
 			if ( a.valid() ) {
 				a.FetchData( app->transferFunction.data(), dimension );
+				TransferFunctionChanged();
 			}
 		}
 	};
@@ -248,10 +674,20 @@ int main( int argc, char **argv )
 			a.ReadFromText(text);
 			if ( a.valid() ) {
 				a.FetchData( app->transferFunction.data(), 256 );
+				TransferFunctionChanged();
 			}
 		}
 	};
 
+	auto UpdateTransferFunction = [ & ]( const std::string &tf ) {
+		const auto dot = tf.find_last_of( '.' );
+		if ( dot != std::string::npos && tf.substr( dot ) == ".tf" ) {
+			UpdateTransferFunctionFromFile( tf, app->dimension );
+		} else {
+			UpdateTransferFunctionByName( tf );
+		}
+	};
+
 	auto MouseEventHandler = [ & ]( void *, MouseButton buttons, EventAction action, int xpos, int ypos ) {
 		static Vec2i lastMousePos;
 		static bool pressed = false;
@@ -401,7 +837,72 @@ int main( int argc, char **argv )
 		return Lerp( d.z, d0, d1 );
 	};
 
-	auto Raycast = [ & ]( const Ray &ray, RayIntervalIter &intervalIter ) -> Vec4f {
+	auto GetBlock = [ & ]( const Point3i &c ) -> const void * {
+		if ( app->residentBlocks ) {
+			return app->residentBlocks->GetPage( Linear( c, Size2( app->gridCount.x, app->gridCount.y ) ) );
+		}
+		return app->volumeData[ 0 ]->GetPage( { c.x, c.y, c.z } );
+	};
+
+	/**
+	 * @brief Returns false if the transfer function makes all of the block \a c transparent
+	 */
+	auto BlockVisible = [ & ]( const Point3i &c ) -> bool {
+		cauto &g = app->gridCount;
+		// intensity projection ignores the transfer function
+		return app->emptySpace == nullptr || app->intensityProjection != IntensityProjection::None || c.x < 0 || c.y < 0 || c.z < 0 || c.x >= g.x || c.y >= g.y || c.z >= g.z ||
+			   !app->emptySpace->BlockEmpty( c );
+	};
+
+	/**
+	 * @brief Composites the samples of \a ray in [tBegin, min(tEnd, tMax)) which lie in the block \a cellIndex
+	 */
+	auto IntegrateBlock = [ & ]( const Ray &ray, const void *blockData, const Point3i &cellIndex, float tBegin, float tEnd, float tMax, Vec4f &color ) {
+		cauto &step = app->step;
+		cauto shading = app->shading;
+		cauto octree = app->emptySpace.get();
+		cauto origin = ray( 0 );
+		cauto dir = ray( 1 ) - origin;
+		float visibleUntil = tBegin;  // the samples before lie in a visible brick
+		const int8_t *gradientPage = nullptr;
+		if ( shading != ShadingModel::None && app->gradientCache && tBegin < tEnd ) {
+			cauto linear = Linear( cellIndex, Size2( app->gridCount.x, app->gridCount.y ) );
+			cauto blockID = app->timeSeriesContainer ? app->timeSeriesContainer->Slot( app->timeStep, linear ) : linear + app->timeStep * app->gridCount.Prod();
+			gradientPage = app->gradientCache->GetPage( blockID, (const unsigned char *)blockData );
+		}
+		while ( tBegin < tEnd && tBegin < tMax && color.w < 0.99 ) {
+			if ( octree && tBegin >= visibleUntil ) {
+				float exit;
+				if ( octree->SkipEmpty( origin, dir, tBegin, exit ) ) {
+					// whole steps keep the samples where they are without skipping
+					tBegin += std::ceil( ( exit - tBegin ) / step ) * step;
+					continue;
+				}
+				visibleUntil = exit;
+			}
+			cauto globalPos = ray( tBegin );
+			auto innerOffset = ( globalPos.ToVector3() - Vec3f( cellIndex.ToVector3() * app->blockSize ) ).ToPoint3();
+			cauto val = TrilinearSampler( (const unsigned char *)blockData, innerOffset );
+			auto sampledColorAndOpacity = SampleFromTransferFunction( val );
+			if ( shading != ShadingModel::None && sampledColorAndOpacity.w > 0 ) {
+				cauto gradient = gradientPage ?
+								   SampleGradientPage( gradientPage, app->blockSize.x, innerOffset ) :
+								   EstimateGradient( (const unsigned char *)blockData, app->blockSize.x, innerOffset );
+				// head light
+				cauto V = origin - globalPos;
+				cauto diffuse = Vec3f( sampledColorAndOpacity.x, sampledColorAndOpacity.y, sampledColorAndOpacity.z );
+				sampledColorAndOpacity = Vec4f( Shade( shading, app->shadingParams, diffuse, gradient, V, V ), sampledColorAndOpacity.w );
+			}
+			color = color + sampledColorAndOpacity * Vec4f( Vec3f(sampledColorAndOpacity.w), 1.0 ) * ( 1.0 - color.w );
+			tBegin += step;
+		}
+	};
+
+	/**
+	 * @brief Traces \a ray through the grid with a RayIntervalIter or a GridDDA and returns its
+	 * color, \a tEnd is where it stopped
+	 */
+	auto Raycast = [ & ]( const Ray &ray, auto &intervalIter, float &tEnd ) -> Vec4f {
 		cauto &step = app->step;
 		float tPrev = intervalIter.Pos, tCur, tMax = intervalIter.Max - step;
 		Point3i cellIndex = intervalIter.CellIndex;
@@ -409,48 +910,1002 @@ int main( int argc, char **argv )
 		while ( intervalIter.Valid() && color.w < 0.99 ) {
 			++intervalIter;
 			tCur = intervalIter.Pos;
-			auto blockData = app->volumeData[ 0 ]->GetPage( { cellIndex.x, cellIndex.y, cellIndex.z } );
-			while ( tPrev < tCur && tPrev < tMax && color.w < 0.99 ) {
-				cauto globalPos = ray( tPrev );
-				auto innerOffset = ( globalPos.ToVector3() - Vec3f( cellIndex.ToVector3() * app->blockSize ) ).ToPoint3();
-				cauto val = TrilinearSampler( (const unsigned char *)blockData, innerOffset );
-				cauto sampledColorAndOpacity = SampleFromTransferFunction( val );
-				color = color + sampledColorAndOpacity * Vec4f( Vec3f(sampledColorAndOpacity.w), 1.0 ) * ( 1.0 - color.w );
-				tPrev += step;
+			// transparent blocks are never paged in
+			if ( BlockVisible( cellIndex ) ) {
+				auto blockData = GetBlock( cellIndex );
+				app->blockLookups++;
+				IntegrateBlock( ray, blockData, cellIndex, tPrev, tCur, tMax, color );
 			}
 			cellIndex = intervalIter.CellIndex;
 			tPrev = tCur;
 		}
+		tEnd = tPrev;
 		return color;
 	};
 
-	auto CPURenderLoop = [ & ]( Pixel_t *buffer, int width, int height, const auto &grid ) {
-		int rayCount = 0;
+	/**
+	 * @brief Projects the intensities along \a ray as app->intensityProjection says and returns
+	 * them as gray. Blocks whose value range can not change the projection are not paged in,
+	 * and the ray stops once no sample can change it.
+	 */
+	auto ProjectRay = [ & ]( const Ray &ray, auto &intervalIter ) -> Vec4f {
+		cauto mode = app->intensityProjection;
+		cauto &step = app->step;
+		cauto &gridCount = app->gridCount;
+		cauto ranges = app->emptySpace.get();
+		cauto dir = ray( 1 ) - ray( 0 );
+		const float tMax = intervalIter.Max - step;
+		float tPrev = intervalIter.Pos, tCur;
+		Point3i cellIndex = intervalIter.CellIndex;
+		IntensityAccumulator acc;
+		while ( intervalIter.Valid() && !acc.Saturated( mode ) ) {
+			++intervalIter;
+			tCur = intervalIter.Pos;
+			cauto &c = cellIndex;
+			cauto tEnd = ( std::min )( tCur, tMax );
+			if ( c.x >= 0 && c.y >= 0 && c.z >= 0 && c.x < gridCount.x && c.y < gridCount.y && c.z < gridCount.z && tEnd > tPrev &&
+				 ( ranges == nullptr || acc.MayChange( mode, ranges->BlockMin( c ), ranges->BlockMax( c ) ) ) ) {
+				auto blockData = GetBlock( c );
+				app->blockLookups++;
+				cauto local = ( ray( tPrev ).ToVector3() - Vec3f( c.ToVector3() * app->blockSize ) ).ToPoint3();
+				AccumulateSamples( (const unsigned char *)blockData, app->blockSize.x, local, dir * step, int( std::ceil( ( tEnd - tPrev ) / step ) ), acc );
+			}
+			cellIndex = intervalIter.CellIndex;
+			tPrev = tCur;
+		}
+		cauto v = acc.Value( mode ) / 255;
+		return Vec4f( v, v, v, acc.count ? 1.f : 0.f );
+	};
+
+	/**
+	 * @brief Records in the occlusion buffer how far the ray of pixel \a x, \a y got if it
+	 * turned opaque at or before \a tEnd
+	 */
+	auto RecordOpacity = [ & ]( int x, int y, const Ray &ray, float tEnd, const Vec4f &color ) {
+		if ( app->occlusion == nullptr ) {
+			return;
+		}
+		auto depth = std::numeric_limits<float>::infinity();
+		if ( color.w >= 0.99 ) {
+			cauto v = ray( tEnd ) - app->eye;
+			depth = std::sqrt( v.x * v.x + v.y * v.y + v.z * v.z );
+		}
+		app->occlusion->Record( x, y, depth );
+	};
+
+	/**
+	 * @brief Returns true if the block \a c was hidden behind opaque samples in the last frame
+	 */
+	auto BlockOccluded = [ & ]( const Point3i &c ) -> bool {
+		if ( app->occlusion == nullptr ) {
+			return false;
+		}
+		cauto &b = app->blockSize;
+		cauto lo = Point3f( c.x * b.x, c.y * b.y, c.z * b.z );
+		return app->occlusion->Occluded( lo, lo + Vec3f( b.x, b.y, b.z ) );
+	};
+
+	auto StorePixel = [ & ]( Pixel_t *pixel, const Vec4f &color ) {
+		// specular highlights may exceed 1
+		pixel->Comp.r = ( std::min )( color.x, 1.f ) * 255;
+		pixel->Comp.g = ( std::min )( color.y, 1.f ) * 255;
+		pixel->Comp.b = ( std::min )( color.z, 1.f ) * 255;
+		pixel->Comp.a = ( std::min )( color.w, 1.f ) * 255;
+	};
+
+	/**
+	 * @brief Renders the film block by block instead of ray by ray.
+	 *
+	 * Every ray waits in the queue of the block it enters next. A block is paged in once,
+	 * all its waiting rays are composited through it and are then moved to the queues of their
+	 * next blocks. Rays start at the eye and move away from it along every axis, so the
+	 * block distance to the eye grows with every block a ray enters. Visiting the blocks by
+	 * increasing distance therefore finds all the rays of a block already waiting and each
+	 * block is loaded once per frame regardless of the cache size. Orthographic rays are
+	 * parallel, there the blocks are visited along the viewing direction instead.
+	 */
+	auto BlockScheduledRenderLoop = [ & ]( Pixel_t *buffer, int width, int height, const auto &grid ) {
+		struct RayState
+		{
+			Ray ray;
+			RayIntervalIter iter;
+			Vec4f color;
+			float tPrev, tCur, tMax;
+			Point3i cellIndex;
+			int pixel;
+		};
+		cauto &gridCount = app->gridCount;
+		cauto &blockSize = app->blockSize;
+		cauto blockCount = size_t( gridCount.Prod() );
+		std::vector<RayState> rays;
+		rays.reserve( size_t( width ) * height );
+		std::vector<std::vector<uint32_t>> queues( blockCount );
+		size_t waiting = 0;
+
+		auto Enqueue = [ & ]( uint32_t rayID ) {
+			auto &s = rays[ rayID ];
+			while ( s.iter.Valid() && s.color.w < 0.99 ) {
+				s.cellIndex = s.iter.CellIndex;
+				++s.iter;
+				s.tCur = s.iter.Pos;
+				cauto &c = s.cellIndex;
+				if ( c.x >= 0 && c.y >= 0 && c.z >= 0 && c.x < gridCount.x && c.y < gridCount.y && c.z < gridCount.z && BlockVisible( c ) ) {
+					queues[ Linear( c, Size2( gridCount.x, gridCount.y ) ) ].push_back( rayID );
+					waiting++;
+					return;
+				}
+				s.tPrev = s.tCur;
+			}
+			StorePixel( buffer + s.pixel, s.color );
+			RecordOpacity( s.pixel % width, s.pixel / width, s.ray, s.tPrev, s.color );
+		};
+
+		for ( int y = 0; y < height; y++ ) {
+			for ( int x = 0; x < width; x++ ) {
+				auto r = PixelRay( x, y );
+				auto iter = grid.IntersectWith( r );
+				const float tBegin = iter.Pos, tMax = iter.Max - app->step;
+				rays.push_back( RayState{ r, iter, Vec4f( 0, 0, 0, 0 ), tBegin, tBegin, tMax, iter.CellIndex, y * width + x } );
+				Enqueue( rays.size() - 1 );
+			}
+		}
+
+		const Point3i eyeCell( std::floor( app->eye.x / blockSize.x ), std::floor( app->eye.y / blockSize.y ), std::floor( app->eye.z / blockSize.z ) );
+		// parallel rays all move the same way along every axis
+		cauto front = app->camera.GetViewMatrixWrapper().GetFront();
+		const Vec3i sign( ( front.x > 0 ) - ( front.x < 0 ), ( front.y > 0 ) - ( front.y < 0 ), ( front.z > 0 ) - ( front.z < 0 ) );
+		std::vector<uint32_t> blockOrder( blockCount );
+		std::vector<int> distance( blockCount );
+		for ( size_t i = 0; i < blockCount; i++ ) {
+			cauto c = Vec3i( Dim( i, { gridCount.x, gridCount.y } ) );
+			distance[ i ] = app->orthographic ? c.x * sign.x + c.y * sign.y + c.z * sign.z :
+												std::abs( c.x - eyeCell.x ) + std::abs( c.y - eyeCell.y ) + std::abs( c.z - eyeCell.z );
+			blockOrder[ i ] = i;
+		}
+		std::stable_sort( blockOrder.begin(), blockOrder.end(), [ &distance ]( uint32_t a, uint32_t b ) { return distance[ a ] < distance[ b ]; } );
+
+		// A ray crossing a block boundary exactly at the eye's cell may step back into a block
+		// already visited. Another pass picks such rays up.
+		std::vector<uint32_t> current;
+		while ( waiting > 0 ) {
+			for ( cauto id : blockOrder ) {
+				if ( queues[ id ].empty() ) {
+					continue;
+				}
+				current.clear();
+				current.swap( queues[ id ] );
+				waiting -= current.size();
+				cauto c = Vec3i( Dim( id, { gridCount.x, gridCount.y } ) );
+				auto blockData = GetBlock( Point3i( c.x, c.y, c.z ) );
+				app->blockLookups++;
+				for ( cauto rayID : current ) {
+					auto &s = rays[ rayID ];
+					IntegrateBlock( s.ray, blockData, s.cellIndex, s.tPrev, s.tCur, s.tMax, s.color );
+					s.tPrev = s.tCur;
+					Enqueue( rayID );
+				}
+			}
+		}
+		app->renderProgress = 1.0;
+	};
+
+	/**
+	 * @brief Renders the film in passes over a VirtualPageTable, as the GL out-of-core renderer does.
+	 *
+	 * A ray that reaches an unmapped block is suspended with its color and position and the
+	 * block is recorded as missed. After each pass the missed blocks are loaded as one batch
+	 * from the block file and the suspended rays resume in the next pass. For a time series
+	 * the blocks of the current timestep are looked up behind those of the earlier ones.
+	 */
+	auto PageTableRenderLoop = [ & ]( Pixel_t *buffer, int width, int height, const auto &grid ) {
+		struct RayState
+		{
+			Ray ray;
+			RayIntervalIter iter;
+			Vec4f color;
+			float tPrev, tCur, tMax;
+			Point3i cellIndex;
+			int pixel;
+			bool pending;  // [tPrev, tCur) in cellIndex is not integrated yet
+		};
+		auto &pageTable = *app->pageTable;
+		auto &volumeFile = app->timeSeriesFiles.empty() ? app->volumeFiles[ 0 ] : app->timeSeriesFiles[ app->timeStep ];
+		cauto &gridCount = app->gridCount;
+		cauto pageBytes = size_t( app->blockSize.Prod() );
+		cauto container = app->timeSeriesContainer.get();
+		cauto blockBase = container ? 0 : app->timeStep * gridCount.Prod();
+
+		// returns false if the ray is suspended at an unmapped block
+		auto Advance = [ & ]( RayState &s ) -> bool {
+			while ( ( s.pending || s.iter.Valid() ) && s.color.w < 0.99 ) {
+				if ( !s.pending ) {
+					s.cellIndex = s.iter.CellIndex;
+					++s.iter;
+					s.tCur = s.iter.Pos;
+					s.pending = true;
+				}
+				cauto &c = s.cellIndex;
+				if ( c.x >= 0 && c.y >= 0 && c.z >= 0 && c.x < gridCount.x && c.y < gridCount.y && c.z < gridCount.z && BlockVisible( c ) ) {
+					cauto linear = Linear( c, Size2( gridCount.x, gridCount.y ) );
+					cauto blockData = pageTable.Lookup( container ? container->Slot( app->timeStep, linear ) : blockBase + linear );
+					app->blockLookups++;
+					if ( blockData == nullptr ) {
+						return false;
+					}
+					IntegrateBlock( s.ray, blockData, c, s.tPrev, s.tCur, s.tMax, s.color );
+				}
+				s.tPrev = s.tCur;
+				s.pending = false;
+			}
+			return true;
+		};
+
+		std::vector<RayState> rays;
+		rays.reserve( size_t( width ) * height );
 		for ( int y = 0; y < height; y++ ) {
 			for ( int x = 0; x < width; x++ ) {
-				cauto pScreen = Point3f(x, y, 0);
-				cauto pWorld = app->screenToWorld * pScreen;
-				cauto dir = pWorld - app->eye;
-				auto r = Ray( dir, app->eye );
+				auto r = PixelRay( x, y );
 				auto iter = grid.IntersectWith( r );
-				auto color = Raycast( r, iter );
-				auto pixel = buffer + y * width + x;
-				pixel->Comp.r = color.x * 255;
-				pixel->Comp.g = color.y * 255;
-				pixel->Comp.b = color.z * 255;
-				pixel->Comp.a = color.w * 255;
-				rayCount++;
-				if ( rayCount % ( ( width * height ) / 100 ) == 0 ) {
-					app->renderProgress = rayCount * 1.0 / ( width * height );
+				const float tBegin = iter.Pos, tMax = iter.Max - app->step;
+				rays.push_back( RayState{ r, iter, Vec4f( 0, 0, 0, 0 ), tBegin, tBegin, tMax, iter.CellIndex, y * width + x, false } );
+			}
+		}
+
+		// only blocks of the current timestep are missed, of a container they are slots
+		auto LoadBlock = [ &volumeFile, pageBytes, blockBase, container ]( size_t blockID, void *page ) {
+			if ( container ) {
+				return container->ReadSlot( blockID, page );
+			}
+			cauto src = volumeFile->GetPage( blockID - blockBase );
+			if ( src == nullptr ) {
+				return false;
+			}
+			memcpy( page, src, pageBytes );
+			volumeFile->UnlockPage( blockID - blockBase );
+			return true;
+		};
+
+		auto LoadBatch = [ & ]( std::vector<std::pair<size_t, void *>> requests ) {
+			for ( auto &r : requests ) {
+				r.first -= blockBase;
+			}
+			app->batchLoader->Load( std::move( requests ) );
+		};
+
+		cauto total = rays.size();
+		size_t passes = 0, loaded = 0;
+		if ( app->batchLoader ) {
+			app->batchLoader->ResetStatistics();
+		}
+		while ( rays.empty() == false ) {
+			passes++;
+			size_t active = 0;
+			for ( size_t i = 0; i < rays.size(); i++ ) {
+				auto &s = rays[ i ];
+				if ( Advance( s ) ) {
+					StorePixel( buffer + s.pixel, s.color );
+					RecordOpacity( s.pixel % width, s.pixel / width, s.ray, s.tPrev, s.color );
+				} else {
+					rays[ active++ ] = s;
 				}
 			}
+			rays.erase( rays.begin() + active, rays.end() );
+			app->renderProgress = 1.0 - double( active ) / ( std::max )( total, size_t( 1 ) );
+			if ( active > 0 ) {
+				loaded += app->batchLoader ? pageTable.RefineBatch( LoadBatch ) : pageTable.Refine( LoadBlock );
+			}
+		}
+		LOG_INFO << "Page table rendering: " << passes << " passes, " << loaded << " blocks loaded";
+		if ( app->batchLoader ) {
+			cauto &stat = app->batchLoader->Statistics();
+			LOG_INFO << "Batched reads: " << stat.blocks << " blocks in " << stat.runs << " runs, "
+					 << stat.bytes / 1024.0 / 1024 << " MB in " << stat.seconds << "(s), " << stat.BandwidthInMB() << " MB/s";
 		}
 	};
 
+	auto TraceFrame = [ & ]( Pixel_t *buffer, int width, int height, const auto &grid ) {
+		if ( app->pageTableScheduling && app->pageTable ) {
+			PageTableRenderLoop( buffer, width, height, grid );
+			return;
+		}
+		if ( app->blockScheduling ) {
+			BlockScheduledRenderLoop( buffer, width, height, grid );
+			return;
+		}
+		int rayCount = 0;
+		const int progressStep = ( std::max )( width * height / 100, 1 );
+		std::unique_ptr<GridTraversal> traversal;
+		if ( app->ddaTraversal ) {
+			cauto &size = app->dataResolution;
+			traversal = std::make_unique<GridTraversal>( Point3f( 0, 0, 0 ), Point3f( size.x, size.y, size.z ), app->gridCount );
+			// orthographic rays do not share an origin to enter the grid from
+			if ( !app->orthographic ) {
+				traversal->PrepareTiles( app->eye, width, height, 8, [ & ]( int x, int y ) { return app->screenToWorld * Point3f( x, y, 0 ) - app->eye; } );
+			}
+		}
+		cauto projection = app->intensityProjection != IntensityProjection::None;
+		auto RenderPixel = [ & ]( int x, int y ) {
+			auto r = PixelRay( x, y );
+			float tEnd = 0;
+			Vec4f color;
+			if ( traversal ) {
+				cauto dir = r( 1 ) - r( 0 );
+				auto iter = app->orthographic ? traversal->IntersectWith( r( 0 ), dir ) : traversal->Start( x, y, dir );
+				color = projection ? ProjectRay( r, iter ) : Raycast( r, iter, tEnd );
+			} else {
+				auto iter = grid.IntersectWith( r );
+				color = projection ? ProjectRay( r, iter ) : Raycast( r, iter, tEnd );
+			}
+			StorePixel( buffer + y * width + x, color );
+			RecordOpacity( x, y, r, tEnd, color );
+			rayCount++;
+			if ( rayCount % progressStep == 0 ) {
+				app->renderProgress = rayCount * 1.0 / ( width * height );
+			}
+		};
+		if ( app->pixelOrder == PixelOrder::RowMajor ) {
+			for ( int y = 0; y < height; y++ ) {
+				for ( int x = 0; x < width; x++ ) {
+					RenderPixel( x, y );
+				}
+			}
+			return;
+		}
+		if ( app->pixelOrderFilm.x != width || app->pixelOrderFilm.y != height ) {
+			app->pixelOrderCache = GeneratePixelOrder( width, height, app->pixelOrder, app->tileSize );
+			app->pixelOrderFilm = Vec2i( width, height );
+		}
+		for ( cauto &p : app->pixelOrderCache ) {
+			RenderPixel( p.x, p.y );
+		}
+	};
+
+	/**
+	 * @brief Renders a frame and publishes where it turned opaque. With a page table, the
+	 * mapped blocks of the current timestep hidden in this frame become the first victims.
+	 */
+	auto CPURenderLoop = [ & ]( Pixel_t *buffer, int width, int height, const auto &grid ) {
+		if ( app->occlusion ) {
+			app->occlusion->BeginFrame( width, height );
+		}
+		TraceFrame( buffer, width, height, grid );
+		if ( app->occlusion == nullptr ) {
+			return;
+		}
+		app->occlusion->EndFrame( app->screenToWorld.Inversed(), app->eye, app->camera.GetViewMatrixWrapper().GetFront() );
+		if ( !app->pageTableScheduling || !app->pageTable ) {
+			return;
+		}
+		cauto &gridCount = app->gridCount;
+		cauto container = app->timeSeriesContainer.get();
+		cauto blockCount = size_t( gridCount.Prod() );
+		size_t demoted = 0;
+		for ( size_t i = 0; i < blockCount; i++ ) {
+			cauto id = container ? container->Slot( app->timeStep, i ) : app->timeStep * blockCount + i;
+			if ( app->pageTable->Mapped( id ) ) {
+				cauto c = Vec3i( Dim( i, { gridCount.x, gridCount.y } ) );
+				if ( BlockOccluded( Point3i( c.x, c.y, c.z ) ) && app->pageTable->Demote( id ) ) {
+					demoted++;
+				}
+			}
+		}
+		LOG_INFO << "Occlusion: " << app->occlusion->OpaqueTileRatio() * 100 << "% opaque tiles, " << demoted << " hidden blocks demoted";
+	};
+
+	/**
+	 * @brief Renders the current view once per pixel order, each from a cold cache, and reports
+	 * frame time and block cache hit rate
+	 */
+	auto PixelOrderBenchmark = [ & ]( const auto &grid ) -> int {
+		cauto &screenSize = app->screenSize;
+		std::vector<Pixel_t> image( screenSize.Prod() );
+		cauto userOrder = app->pixelOrder;
+		for ( cauto order : { PixelOrder::RowMajor, PixelOrder::Morton, PixelOrder::Hilbert } ) {
+			OpenVolumeDataFromFile( app->DataFileName );
+			if ( app->volumeData.empty() ) {
+				LOG_CRITICAL << "No volume data to benchmark";
+				return -1;
+			}
+			app->pixelOrder = order;
+			app->pixelOrderFilm = Vec2i( 0, 0 );
+			app->blockLookups = 0;
+			auto start = app->Time.elapsed();
+			CPURenderLoop( image.data(), screenSize.x, screenSize.y, grid );
+			auto end = app->Time.elapsed();
+			Block3DCache *cache = app->volumeData[ 0 ];
+			cauto mortonCache = dynamic_cast<MortonCodeCache *>( cache );
+			cauto misses = mortonCache ? mortonCache->SwapInCount() : 0;
+			cauto hitRate = app->blockLookups ? 1.0 - double( misses ) / app->blockLookups : 1.0;
+			LOG_INFO << PixelOrderName( order ) << ": " << end.s() - start.s() << "(s), block lookups: " << app->blockLookups
+					 << ", misses: " << misses << ", hit rate: " << hitRate * 100 << "%\n";
+		}
+		app->pixelOrder = userOrder;
+		app->pixelOrderFilm = Vec2i( 0, 0 );
+		return 0;
+	};
+
+	/**
+	 * @brief Returns the linear ids of the blocks hit by every \a stride th ray in both
+	 * directions of the film under the current transform
+	 */
+	auto CollectFrameBlocks = [ & ]( const auto &grid, int stride ) -> std::vector<size_t> {
+		cauto &gridCount = app->gridCount;
+		std::vector<bool> visited( gridCount.Prod(), false );
+		std::vector<size_t> blocks;
+		for ( int y = 0; y < app->screenSize.y; y += stride ) {
+			for ( int x = 0; x < app->screenSize.x; x += stride ) {
+				auto r = PixelRay( x, y );
+				auto iter = grid.IntersectWith( r );
+				while ( iter.Valid() ) {
+					cauto c = iter.CellIndex;
+					if ( c.x >= 0 && c.y >= 0 && c.z >= 0 && c.x < gridCount.x && c.y < gridCount.y && c.z < gridCount.z && BlockVisible( c ) ) {
+						cauto id = Linear( c, Size2( gridCount.x, gridCount.y ) );
+						if ( !visited[ id ] ) {
+							visited[ id ] = true;
+							blocks.push_back( id );
+						}
+					}
+					++iter;
+				}
+			}
+		}
+		// blocks hidden in the last frame are read last
+		if ( app->occlusion && app->occlusion->Valid() ) {
+			std::stable_partition( blocks.begin(), blocks.end(), [ & ]( size_t id ) {
+				cauto c = Vec3i( Dim( id, { gridCount.x, gridCount.y } ) );
+				return !BlockOccluded( Point3i( c.x, c.y, c.z ) );
+			} );
+		}
+		return blocks;
+	};
+
+	/**
+	 * @brief Renders all views of a view set in one block scheduled pass and writes an image per view.
+	 *
+	 * The rays of every view wait in the queue of the block they enter next and the blocks
+	 * are visited by increasing linear id. A ray that moves towards larger coordinates along
+	 * every axis enters blocks by increasing id and composites front to back. A ray moving
+	 * towards smaller coordinates along every axis is walked backwards from where it leaves
+	 * the grid, which again enters blocks by increasing id, and the color of each block
+	 * segment is composited over the color behind it. Axis aligned orthographic views consist
+	 * of such rays only and every block is loaded once for all of them. Other rays may step
+	 * back to a block already visited and are picked up by further passes.
+	 */
+	auto MultiViewLoop = [ & ]( const auto &grid ) -> int {
+		std::vector<ViewingTransform> cameras;
+		std::string outputPattern = app->OutputFileName;
+		if ( app->ViewSetName == "axes" ) {
+			cauto &size = app->dataResolution;
+			cauto center = Point3f( size.x / 2.f, size.y / 2.f, size.z / 2.f );
+			cameras = AxisAlignedViews( center, std::sqrt( float( size.x * size.x + size.y * size.y + size.z * size.z ) ) );
+		} else {
+			try {
+				cameras = LoadViewSet( app->ViewSetName, outputPattern );
+			} catch ( std::exception &e ) {
+				LOG_CRITICAL << e.what();
+				return -1;
+			}
+		}
+		struct RayState
+		{
+			Ray ray;
+			RayIntervalIter iter;
+			Vec4f color;
+			float tPrev, tCur, tMax;
+			float tFlip;  // a backward ray is at tFlip - t of the ray
+			Point3i cellIndex;
+			uint32_t view;
+			int pixel;
+			bool backward;
+		};
+		cauto &screenSize = app->screenSize;
+		cauto &gridCount = app->gridCount;
+		cauto blockCount = size_t( gridCount.Prod() );
+		std::vector<std::vector<Pixel_t>> images( cameras.size(), std::vector<Pixel_t>( screenSize.Prod() ) );
+		std::vector<RayState> rays;
+		rays.reserve( cameras.size() * screenSize.Prod() );
+		std::vector<std::vector<uint32_t>> queues( blockCount );
+		size_t waiting = 0, forward = 0;
+
+		auto Enqueue = [ & ]( uint32_t rayID ) {
+			auto &s = rays[ rayID ];
+			// composited back to front, a backward ray can not terminate early
+			while ( s.iter.Valid() && ( s.backward || s.color.w < 0.99 ) ) {
+				s.cellIndex = s.iter.CellIndex;
+				++s.iter;
+				s.tCur = s.iter.Pos;
+				cauto &c = s.cellIndex;
+				if ( c.x >= 0 && c.y >= 0 && c.z >= 0 && c.x < gridCount.x && c.y < gridCount.y && c.z < gridCount.z && BlockVisible( c ) ) {
+					queues[ Linear( c, Size2( gridCount.x, gridCount.y ) ) ].push_back( rayID );
+					waiting++;
+					return;
+				}
+				s.tPrev = s.tCur;
+			}
+			StorePixel( images[ s.view ].data() + s.pixel, s.color );
+		};
+
+		cauto start = app->Time.elapsed();
+		for ( size_t v = 0; v < cameras.size(); v++ ) {
+			ApplyCamera( cameras[ v ] );
+			for ( int y = 0; y < screenSize.y; y++ ) {
+				for ( int x = 0; x < screenSize.x; x++ ) {
+					auto r = PixelRay( x, y );
+					auto iter = grid.IntersectWith( r );
+					cauto d = r( 1 ) - r( 0 );
+					cauto backward = iter.Valid() && ( d.x > 0 || d.y > 0 || d.z > 0 ) == false && ( d.x < 0 || d.y < 0 || d.z < 0 );
+					const float tMax = iter.Max - app->step;
+					float tFlip = 0;
+					if ( backward ) {
+						// from a point outside the grid behind the exit
+						tFlip = iter.Max + 1;
+						iter = grid.IntersectWith( Ray( -d, r( tFlip ) ) );
+					} else {
+						forward++;
+					}
+					const float tBegin = iter.Pos;
+					rays.push_back( RayState{ r, iter, Vec4f( 0, 0, 0, 0 ), tBegin, tBegin, tMax, tFlip, iter.CellIndex, uint32_t( v ), y * screenSize.x + x, backward } );
+					Enqueue( rays.size() - 1 );
+				}
+			}
+		}
+
+		size_t passes = 0, loaded = 0;
+		std::vector<uint32_t> current;
+		while ( waiting > 0 ) {
+			passes++;
+			for ( size_t id = 0; id < blockCount; id++ ) {
+				if ( queues[ id ].empty() ) {
+					continue;
+				}
+				current.clear();
+				current.swap( queues[ id ] );
+				waiting -= current.size();
+				cauto c = Vec3i( Dim( id, { gridCount.x, gridCount.y } ) );
+				auto blockData = GetBlock( Point3i( c.x, c.y, c.z ) );
+				app->blockLookups++;
+				loaded++;
+				for ( cauto rayID : current ) {
+					auto &s = rays[ rayID ];
+					if ( s.backward ) {
+						Vec4f segment( 0, 0, 0, 0 );
+						IntegrateBlock( s.ray, blockData, s.cellIndex, s.tFlip - s.tCur, s.tFlip - s.tPrev, s.tMax, segment );
+						s.color = segment + s.color * ( 1.0 - segment.w );
+					} else {
+						IntegrateBlock( s.ray, blockData, s.cellIndex, s.tPrev, s.tCur, s.tMax, s.color );
+					}
+					s.tPrev = s.tCur;
+					Enqueue( rayID );
+				}
+			}
+		}
+		LOG_INFO << "Rendered " << cameras.size() << " views in " << app->Time.elapsed().s() - start.s() << "(s): " << passes << " passes, "
+				 << loaded << " block loads for " << blockCount << " blocks, " << rays.size() - forward << " of " << rays.size() << " rays walked backwards";
+		AsyncImageWriter writer( app->EncoderCount, 2 * app->EncoderCount );
+		for ( size_t v = 0; v < cameras.size(); v++ ) {
+			writer.Submit( FormatFrameFileName( outputPattern, v ), screenSize.x, screenSize.y, std::move( images[ v ] ) );
+		}
+		writer.Wait();
+		return 0;
+	};
+
+	/**
+	 * @brief Extracts the slices of --slice from the block cache and writes them as gray images
+	 */
+	auto SliceLoop = [ & ]() -> int {
+		if ( app->volumeData.empty() ) {
+			LOG_CRITICAL << "No volume data to slice";
+			return -1;
+		}
+		cauto &size = app->dataResolution;
+		cauto &gridCount = app->gridCount;
+		std::vector<SlicePlane> planes;
+		cauto &spec = app->SliceSpec;
+		cauto axis = spec.size() > 2 && spec[ 1 ] == ':' ? std::string( "xyz" ).find( spec[ 0 ] ) : std::string::npos;
+		if ( spec == "view" ) {
+			cauto &view = app->camera.GetViewMatrixWrapper();
+			cauto &film = app->screenSize;
+			// the volume diagonal fits the film height
+			cauto spacing = std::sqrt( float( size.x * size.x + size.y * size.y + size.z * size.z ) ) / film.y;
+			planes.push_back( ObliqueSlice( Point3f( size.x / 2.f, size.y / 2.f, size.z / 2.f ), view.GetRight(), view.GetUp(), film.x, film.y, spacing ) );
+		} else if ( axis != std::string::npos && spec.substr( 2 ) == "all" ) {
+			for ( int i = 0; i < size[ axis ]; i++ ) {
+				planes.push_back( AxisAlignedSlice( int( axis ), i, size ) );
+			}
+		} else if ( axis != std::string::npos ) {
+			try {
+				planes.push_back( AxisAlignedSlice( int( axis ), std::stof( spec.substr( 2 ) ), size ) );
+			} catch ( std::exception & ) {
+				LOG_CRITICAL << "Invalid slice position: " << spec;
+				return -1;
+			}
+		} else {
+			LOG_CRITICAL << "Unknown slice: " << spec;
+			return -1;
+		}
+		if ( app->blockSize.x != app->blockSize.y || app->blockSize.x != app->blockSize.z ) {
+			LOG_CRITICAL << "Slicing needs cubic blocks";
+			return -1;
+		}
+		auto FetchBlock = [ & ]( size_t blockID ) {
+			cauto c = Vec3i( Dim( blockID, { gridCount.x, gridCount.y } ) );
+			return GetBlock( Point3i( c.x, c.y, c.z ) );
+		};
+		SliceExtractor extractor( FetchBlock, gridCount, app->blockSize.x, ( std::max )( int( std::thread::hardware_concurrency() ), 1 ) );
+		AsyncImageWriter writer( app->EncoderCount, 2 * app->EncoderCount );
+		std::vector<uint8_t> slice;
+		size_t fetched = 0;
+		double total = 0, maxSec = 0;
+		for ( size_t i = 0; i < planes.size(); i++ ) {
+			cauto &plane = planes[ i ];
+			slice.resize( size_t( plane.width ) * plane.height );
+			auto start = app->Time.elapsed();
+			extractor.Extract( plane, slice.data() );
+			const double sec = app->Time.elapsed().s() - start.s();
+			std::vector<Pixel_t> image( slice.size() );
+			for ( size_t p = 0; p < slice.size(); p++ ) {
+				image[ p ].Comp.r = image[ p ].Comp.g = image[ p ].Comp.b = slice[ p ];
+				image[ p ].Comp.a = 255;
+			}
+			cauto fileName = planes.size() > 1 ? FormatFrameFileName( app->OutputFileName, i ) : app->OutputFileName;
+			writer.Submit( fileName, plane.width, plane.height, std::move( image ) );
+			fetched += extractor.FetchedBlockCount();
+			total += sec;
+			maxSec = ( std::max )( maxSec, sec );
+		}
+		writer.Wait();
+		LOG_INFO << planes.size() << " slices, " << fetched << " blocks fetched, extraction time avg/max: " << total / planes.size() << "/" << maxSec << "(s)";
+		return 0;
+	};
+
+	auto FlythroughLoop = [ & ]( const auto &grid ) -> int {
+		std::string outputPattern;
+		std::unique_ptr<CameraPath> path;
+		try {
+			path = std::make_unique<CameraPath>( LoadCameraPath( app->CameraPathFileName, outputPattern ) );
+		} catch ( std::exception &e ) {
+			LOG_CRITICAL << e.what();
+			return -1;
+		}
+		std::unique_ptr<BlockPrefetcher> prefetcher;
+		if ( !app->volumeFiles.empty() && app->volumeFiles[ 0 ] != nullptr ) {
+			prefetcher = std::make_unique<BlockPrefetcher>( app->volumeFiles[ 0 ] );
+		}
+		cauto frameCount = path->FrameCount();
+		LOG_INFO << "Rendering " << frameCount << " frames of " << app->CameraPathFileName << "\n";
+		cauto &screenSize = app->screenSize;
+		AsyncImageWriter writer( app->EncoderCount, 2 * app->EncoderCount );
+		std::vector<Pixel_t> image;
+		double total = 0, minSec = 1e30, maxSec = 0;
+		cauto begin = app->Time.elapsed();
+		for ( size_t i = 0; i < frameCount; i++ ) {
+			if ( prefetcher && i + 1 < frameCount ) {
+				// Rays of the next frame are traced coarsely to find the blocks to read ahead
+				ApplyCamera( path->Frame( i + 1 ) );
+				prefetcher->Prefetch( CollectFrameBlocks( grid, 8 ) );
+			}
+			ApplyCamera( path->Frame( i ) );
+			image.resize( screenSize.Prod() );
+			auto start = app->Time.elapsed();
+			CPURenderLoop( image.data(), screenSize.x, screenSize.y, grid );
+			auto end = app->Time.elapsed();
+			const double sec = end.s() - start.s();
+			cauto fileName = FormatFrameFileName( outputPattern, i );
+			// encoding overlaps with the next frame
+			writer.Submit( fileName, screenSize.x, screenSize.y, std::move( image ) );
+			LOG_INFO << "Frame " << i << ": " << sec << "(s) -> " << fileName << "\n";
+			total += sec;
+			minSec = ( std::min )( minSec, sec );
+			maxSec = ( std::max )( maxSec, sec );
+		}
+		writer.Wait();
+		LOG_INFO << "Total time including encoding: " << app->Time.elapsed().s() - begin.s() << "(s)\n";
+		if ( prefetcher ) {
+			prefetcher->Wait();
+			LOG_INFO << "Prefetched blocks: " << prefetcher->PrefetchedBlockCount() << "\n";
+		}
+		if ( frameCount ) {
+			LOG_INFO << "Frame time avg/min/max: " << total / frameCount << "/" << minSec << "/" << maxSec << "(s)\n";
+		}
+		return 0;
+	};
+
+	/**
+	 * @brief Plays the time series at its target frame rate.
+	 *
+	 * While timestep t renders, the blocks of its view are read ahead from the file of the
+	 * next timestep. The sampling step follows a FrameRateController, so a slow frame costs
+	 * quality first and only frames too slow at the coarsest step skip timesteps. Offscreen
+	 * every rendered timestep is written to an image, with a window the series loops until closed.
+	 */
+	auto TimeSeriesLoop = [ & ]( const auto &grid ) -> int {
+		cauto container = app->timeSeriesContainer.get();
+		cauto stepCount = container ? container->TimestepCount() : app->timeSeriesFiles.size();
+		if ( stepCount == 0 ) {
+			LOG_CRITICAL << "No time series to play";
+			return -1;
+		}
+		cauto withWindow = !app->hasWindow && window.HasWindow();
+		if ( withWindow ) {
+			window.MouseEvent = MouseEventHandler;
+			window.KeyboardEvent = KeyboardEventHandler;
+		}
+		cauto baseStep = app->step;
+		FrameRateController controller( 1.0 / app->timeSeriesFPS, baseStep );
+		// a container is one file read by slot, its prefetch goes to the slots directly
+		std::unique_ptr<BlockPrefetcher> prefetcher;
+		if ( !container ) {
+			prefetcher = std::make_unique<BlockPrefetcher>( app->timeSeriesFiles[ app->timeStep ] );
+		}
+		AsyncImageWriter writer( app->EncoderCount, 2 * app->EncoderCount );
+		cauto &screenSize = app->screenSize;
+		std::vector<Pixel_t> image;
+		size_t t = 0, frames = 0, dropped = 0;
+		double total = 0, maxSec = 0;
+		int status = 0;
+		// the window shows timestep t no earlier than t / fps after the start
+		double deadline = app->Time.elapsed().s();
+		LOG_INFO << "Playing " << stepCount << " timesteps at " << app->timeSeriesFPS << " fps\n";
+		while ( withWindow ? window.Wait() : t < stepCount ) {
+			if ( t != app->timeStep ) {
+				if ( !container && !OpenTimestep( t ) ) {
+					status = -1;
+					break;
+				}
+				app->timeStep = t;
+				if ( !container ) {
+					OpenBatchLoader( app->timeSeriesFileNames[ t ] );
+				}
+			}
+			app->step = controller.Step();
+			cauto next = withWindow ? ( t + 1 ) % stepCount : t + 1;
+			// the view changes little between timesteps, the blocks of this frame are those of the next.
+			// O_DIRECT reads skip the page cache, warming it would only cost bandwidth
+			if ( next < stepCount && next != t && !app->directIO ) {
+				if ( container ) {
+					// slots shared with this timestep are resident already
+					std::vector<size_t> slots;
+					for ( cauto id : CollectFrameBlocks( grid, 8 ) ) {
+						cauto slot = container->Slot( next, id );
+						if ( slot != container->Slot( t, id ) ) {
+							slots.push_back( slot );
+						}
+					}
+					container->Prefetch( slots );
+				} else if ( auto nextFile = OpenTimestep( next ) ) {
+					prefetcher->Prefetch( nextFile, CollectFrameBlocks( grid, 8 ) );
+				}
+			}
+			double sec = 0;
+			if ( withWindow ) {
+				window.DispatchEvent();
+				if ( window.Quit ) {
+					break;
+				}
+				Pixel_t *pixels;
+				uint32_t w, h;
+				int pitch;
+				window.BeginCopyImageToScreen( (void **)&pixels, w, h, pitch );
+				auto start = app->Time.elapsed();
+				CPURenderLoop( pixels, w, h, grid );
+				sec = app->Time.elapsed().s() - start.s();
+				window.EndCopyImageToScreen();
+				cauto title = "VoxelMan: timestep " + std::to_string( t ) + ", " + std::to_string( 1.0 / sec ) + " fps";
+				window.SetWindowTitle( title.c_str() );
+				window.Present();
+			} else {
+				image.resize( screenSize.Prod() );
+				auto start = app->Time.elapsed();
+				CPURenderLoop( image.data(), screenSize.x, screenSize.y, grid );
+				sec = app->Time.elapsed().s() - start.s();
+				cauto fileName = FormatFrameFileName( app->timeSeriesOutput, t );
+				writer.Submit( fileName, screenSize.x, screenSize.y, std::move( image ) );
+				LOG_INFO << "Timestep " << t << ": " << sec << "(s), step " << app->step << " -> " << fileName << "\n";
+			}
+			cauto advance = controller.Update( sec );
+			dropped += advance - 1;
+			frames++;
+			total += sec;
+			maxSec = ( std::max )( maxSec, sec );
+			t = withWindow ? ( t + advance ) % stepCount : t + advance;
+			if ( withWindow ) {
+				deadline += advance / app->timeSeriesFPS;
+				cauto now = app->Time.elapsed().s();
+				if ( now < deadline ) {
+					std::this_thread::sleep_for( std::chrono::duration<double>( deadline - now ) );
+				} else {
+					deadline = now;	 // behind, the controller has dropped timesteps already
+				}
+			}
+		}
+		writer.Wait();
+		if ( prefetcher ) {
+			prefetcher->Wait();
+		}
+		app->step = baseStep;
+		if ( frames ) {
+			LOG_INFO << frames << " frames, " << dropped << " timesteps dropped, frame time avg/max: " << total / frames << "/" << maxSec
+					 << "(s), prefetched blocks: " << ( prefetcher ? prefetcher->PrefetchedBlockCount() : 0 ) << "\n";
+		}
+		return status;
+	};
+
+	auto ServiceLoop = [ & ]( const auto &grid ) -> int {
+		auto channel = OpenRenderJobChannel( app->ServiceEndpoint );
+		if ( !channel ) {
+			LOG_CRITICAL << "Can not open job channel: " << app->ServiceEndpoint;
+			return -1;
+		}
+		LOG_INFO << "Render service is waiting for jobs on " << app->ServiceEndpoint << "\n";
+		// replies of finished jobs come from the encoding threads, the channel serializes them
+		auto Reply = [ & ]( const std::string &msg ) {
+			channel->Reply( msg );
+		};
+		AsyncImageWriter writer( app->EncoderCount, 2 * app->EncoderCount );
+		std::vector<Pixel_t> image;
+		std::string line, error;
+		RenderJob job;
+		while ( channel->ReadLine( line ) ) {
+			if ( !ParseRenderJob( line, job, error ) ) {
+				Reply( "error " + error );
+				continue;
+			}
+			if ( job.Quit ) {
+				break;
+			}
+			if ( job.OutputFileName.empty() ) {
+				// blank and comment lines carry no keys at all
+				if ( !job.CameraFileName.empty() || !job.TFName.empty() || job.FilmSize.x > 0 || job.FilmSize.y > 0 ) {
+					Reply( "error missing out" );
+				}
+				continue;
+			}
+			if ( !job.CameraFileName.empty() && !ApplyCameraFromFile( job.CameraFileName ) ) {
+				Reply( "error can not open " + job.CameraFileName );
+				continue;
+			}
+			if ( !job.TFName.empty() ) {
+				UpdateTransferFunction( job.TFName );
+			}
+			if ( job.FilmSize.x > 0 ) app->screenSize.x = job.FilmSize.x;
+			if ( job.FilmSize.y > 0 ) app->screenSize.y = job.FilmSize.y;
+			app->aspect = 1.0 * app->screenSize.x / app->screenSize.y;
+			UpdateTransform();
+
+			// The volume, its block cache and the plugins stay alive between jobs
+			cauto &screenSize = app->screenSize;
+			image.resize( screenSize.Prod() );
+			auto start = app->Time.elapsed();
+			CPURenderLoop( image.data(), screenSize.x, screenSize.y, grid );
+			auto end = app->Time.elapsed();
+			auto sec = end.s() - start.s();
+			writer.Submit( job.OutputFileName, screenSize.x, screenSize.y, std::move( image ),
+						   [ &channel, client = channel->Client(), fileName = job.OutputFileName, sec ]( bool ok ) {
+							   channel->ReplyTo( client, ( ok ? "done " : "error can not write " ) + fileName + " " + std::to_string( sec ) );
+						   } );
+		}
+		writer.Wait();
+		return 0;
+	};
+
+	auto CreateGradientSidecar = [ & ]()->int {
+		if ( app->volumeFiles.empty() || !app->volumeFiles[ 0 ] ) {
+			LOG_CRITICAL << "No data file to compute gradients of";
+			return -1;
+		}
+		auto &volumeFile = app->volumeFiles[ 0 ];
+		cauto side = app->blockSize.x;
+		cauto padding = volumeFile->GetPadding();
+		cauto dataSize = volumeFile->GetDataSizeWithoutPadding();
+		cauto blockCount = size_t( app->gridCount.Prod() );
+
+		Block3DDataFileDesc desc;
+		desc.IsDataSize = true;
+		desc.BlockSideInLog = volumeFile->Get3DPageSizeInLog();
+		desc.Padding = padding;
+		desc.DataSize[ 0 ] = dataSize.x;
+		desc.DataSize[ 1 ] = dataSize.y;
+		// the three components are stacked along z
+		desc.DataSize[ 2 ] = 3 * app->gridCount.z * ( side - 2 * padding );
+		cauto sidecarName = GradientSidecarFileName( app->DataFileName );
+		desc.FileName = sidecarName.c_str();
+
+		Ref<I3DBlockFilePluginInterface> sidecar = PluginLoader::GetPluginLoader()->CreatePlugin<I3DBlockFilePluginInterface>( ".lvd" );
+		if ( !sidecar || !sidecar->Create( &desc ) ) {
+			LOG_CRITICAL << "Failed to create gradient sidecar " << sidecarName;
+			return -1;
+		}
+
+		LOG_INFO << "Writing gradients of " << blockCount << " blocks to " << sidecarName;
+		cauto planeBytes = GradientPageBytes( side ) / 3;
+		std::vector<int8_t> page( GradientPageBytes( side ) );
+		std::vector<unsigned char> plane( planeBytes );
+		auto start = app->Time.elapsed();
+		for ( size_t i = 0; i < blockCount; i++ ) {
+			ComputeGradientPage( (const unsigned char *)volumeFile->GetPage( i ), side, page.data() );
+			volumeFile->UnlockPage( i );
+			for ( int c = 0; c < 3; c++ ) {
+				ToggleGradientBias( page.data() + c * planeBytes, plane.data(), planeBytes );
+				sidecar->Write( plane.data(), i + c * blockCount, false );
+			}
+		}
+		sidecar->Flush();
+		sidecar->Close();
+		LOG_INFO << "Gradient sidecar written in " << app->Time.elapsed().s() - start.s() << "(s)";
+		return 0;
+	};
+
+	/**
+	 * @brief Writes the opened timesteps, or the opened volume, into one .lvts file that
+	 * stores every distinct block once.
+	 */
+	auto PackTimeSeries = [ & ]()->int {
+		cauto series = !app->timeSeriesFiles.empty();
+		cauto fileCount = series ? app->timeSeriesFiles.size() : app->volumeFiles.size();
+		auto File = [ & ]( size_t t ) { return series ? OpenTimestep( t ) : app->volumeFiles[ t ]; };
+		Ref<I3DBlockFilePluginInterface> first;
+		if ( fileCount ) {
+			first = File( 0 );
+		}
+		if ( !first ) {
+			LOG_CRITICAL << "No volume or time series of .lvd files to pack";
+			return -1;
+		}
+		cauto blockCount = size_t( app->gridCount.Prod() );
+		LVDTimeSeriesWriter packer( app->PackTimeSeriesFileName, first->Get3DPageSizeInLog(), first->GetPadding(),
+									Size3( app->gridCount ), Size3( first->GetDataSizeWithoutPadding() ) );
+		if ( !packer.Valid() ) {
+			LOG_CRITICAL << "Failed to create " << app->PackTimeSeriesFileName;
+			return -1;
+		}
+		auto start = app->Time.elapsed();
+		for ( size_t t = 0; t < fileCount; t++ ) {
+			auto file = File( t );
+			if ( !file ) {
+				return -1;
+			}
+			// the pages of a file are only needed until they are hashed and written
+			cauto stored = packer.AddTimestep( [ &file ]( size_t blockID ) { return file->GetPage( blockID ); } );
+			LOG_INFO << "Timestep " << t << ": " << stored << " of " << blockCount << " blocks stored";
+		}
+		if ( !packer.Close() ) {
+			LOG_CRITICAL << "Failed to write " << app->PackTimeSeriesFileName;
+			return -1;
+		}
+		LOG_INFO << "Packed " << fileCount << " timesteps into " << packer.SlotCount() << " blocks ("
+				 << 100.0 * packer.SlotCount() / ( blockCount * fileCount ) << "%) in "
+				 << app->Time.elapsed().s() - start.s() << "(s)";
+		return 0;
+	};
+
 	auto AppLoop = [ & ]()->int {
 		app->Time.start();
 		auto &dataBound = app->dataBound;
 		auto grid = dataBound.GenGrid( app->gridCount );
+		if ( !app->PackTimeSeriesFileName.empty() ) {
+			return PackTimeSeries();
+		}
+		if ( app->MakeGradientSidecar ) {
+			return CreateGradientSidecar();
+		}
+		if ( !app->ServiceEndpoint.empty() ) {
+			return ServiceLoop( grid );
+		}
+		if ( !app->CameraPathFileName.empty() ) {
+			return FlythroughLoop( grid );
+		}
+		if ( !app->SliceSpec.empty() ) {
+			return SliceLoop();
+		}
+		if ( !app->ViewSetName.empty() ) {
+			return MultiViewLoop( grid );
+		}
+		if ( !app->TimeSeriesFileName.empty() ) {
+			return TimeSeriesLoop( grid );
+		}
+		if ( app->OrderBenchmark ) {
+			return PixelOrderBenchmark( grid );
+		}
 		if ( !app->hasWindow && window.HasWindow() ) {
 			window.MouseEvent = MouseEventHandler;
 			window.KeyboardEvent = KeyboardEventHandler;
@@ -483,7 +1938,7 @@ int main( int argc, char **argv )
 			auto end = app->Time.elapsed();
 			auto sec = end.s() - start.s();
 			LOG_INFO << "Rendering finished, writing image ...";
-			stbi_write_png( "render_result.png", screenSize.x, screenSize.y, 4, image.data(), screenSize.x * 4 );
+			WriteImage( app->OutputFileName, screenSize.x, screenSize.y, image.data() );
 			LOG_INFO << "Time cost: "<<sec<<"(s)";
 		}
 		return 0;
@@ -493,6 +1948,9 @@ int main( int argc, char **argv )
 	std::invoke( InitCmd, argc, argv );
 	std::invoke( UpdateTransform );											 // Initial transform
 	std::invoke( UpdateTransferFunctionByName, app->TFFileName);
+	if ( !app->CameraFileName.empty() ) {
+		std::invoke( ApplyCameraFromFile, app->CameraFileName );
+	}
 	std::invoke( OpenVolumeDataFromFile, app->DataFileName );				 // Open data file if any
 
 	return std::invoke(AppLoop);
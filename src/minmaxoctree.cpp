@@ -0,0 +1,234 @@
+#include <minmaxoctree.h>
+#include <VMUtils/timer.hpp>
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <limits>
+#include <thread>
+
+namespace vm
+{
+MinMaxOctree::MinMaxOctree( const BlockLoader &loadBlock, const Vec3i &gridCount, int blockSide, int brickSide, int threadCount ) :
+  blockSide( blockSide ),
+  brickSide( brickSide )
+{
+	Timer timer;
+	timer.start();
+	// bricks tile the blocks, blocks are powers of two
+	if ( this->brickSide <= 0 || this->brickSide > blockSide || blockSide % this->brickSide != 0 ) {
+		this->brickSide = blockSide;
+	}
+	const int bricksPerBlock = blockSide / this->brickSide;
+	while ( ( 1 << blockLevel ) < bricksPerBlock ) {
+		blockLevel++;
+	}
+
+	Vec3i size( gridCount.x * bricksPerBlock, gridCount.y * bricksPerBlock, gridCount.z * bricksPerBlock );
+	size_t nodeCount = 0;
+	while ( true ) {
+		levels.push_back( Level{ size, nodeCount } );
+		nodeCount += size_t( size.x ) * size.y * size.z;
+		if ( size.x <= 1 && size.y <= 1 && size.z <= 1 ) {
+			break;
+		}
+		size = Vec3i( ( size.x + 1 ) / 2, ( size.y + 1 ) / 2, ( size.z + 1 ) / 2 );
+	}
+	range.resize( 2 * nodeCount );
+	empty.resize( nodeCount, 0 );
+
+	// every thread owns the bricks of the blocks it takes
+	const size_t blockCount = size_t( gridCount.x ) * gridCount.y * gridCount.z;
+	const size_t blockBytes = size_t( blockSide ) * blockSide * blockSide;
+	std::atomic<size_t> next{ 0 };
+	std::atomic<bool> failed{ false };
+	auto Work = [ & ]() {
+		std::vector<uint8_t> page( blockBytes );
+		for ( auto id = next++; id < blockCount; id = next++ ) {
+			const Point3i cell( id % gridCount.x, id / gridCount.x % gridCount.y, id / gridCount.x / gridCount.y );
+			if ( loadBlock( id, page.data() ) ) {
+				BuildBlock( page.data(), cell );
+				continue;
+			}
+			failed = true;
+			// unknown content is never skipped
+			for ( int z = 0; z < bricksPerBlock; z++ ) {
+				for ( int y = 0; y < bricksPerBlock; y++ ) {
+					for ( int x = 0; x < bricksPerBlock; x++ ) {
+						const auto i = Index( 0, Point3i( cell.x * bricksPerBlock + x, cell.y * bricksPerBlock + y, cell.z * bricksPerBlock + z ) );
+						range[ 2 * i ] = 0;
+						range[ 2 * i + 1 ] = 255;
+					}
+				}
+			}
+		}
+	};
+	std::vector<std::thread> threads;
+	for ( int i = 1; i < threadCount; i++ ) {
+		threads.emplace_back( Work );
+	}
+	Work();
+	for ( auto &t : threads ) {
+		t.join();
+	}
+	valid = !failed;
+
+	for ( size_t l = 1; l < levels.size(); l++ ) {
+		const auto &child = levels[ l - 1 ];
+		const auto &parent = levels[ l ];
+		for ( int z = 0; z < parent.size.z; z++ ) {
+			for ( int y = 0; y < parent.size.y; y++ ) {
+				for ( int x = 0; x < parent.size.x; x++ ) {
+					uint8_t lo = 255, hi = 0;
+					for ( int c = 0; c < 8; c++ ) {
+						const Point3i p( 2 * x + ( c & 1 ), 2 * y + ( c >> 1 & 1 ), 2 * z + ( c >> 2 ) );
+						if ( p.x < child.size.x && p.y < child.size.y && p.z < child.size.z ) {
+							const auto i = Index( int( l - 1 ), p );
+							lo = ( std::min )( lo, range[ 2 * i ] );
+							hi = ( std::max )( hi, range[ 2 * i + 1 ] );
+						}
+					}
+					const auto i = Index( int( l ), Point3i( x, y, z ) );
+					range[ 2 * i ] = lo;
+					range[ 2 * i + 1 ] = hi;
+				}
+			}
+		}
+	}
+	GroupRanges();
+	buildSeconds = timer.elapsed().s();
+}
+
+void MinMaxOctree::BuildBlock( const uint8_t *block, const Point3i &cell )
+{
+	const int bricksPerBlock = blockSide / brickSide;
+	const size_t side = blockSide;
+	for ( int bz = 0; bz < bricksPerBlock; bz++ ) {
+		for ( int by = 0; by < bricksPerBlock; by++ ) {
+			for ( int bx = 0; bx < bricksPerBlock; bx++ ) {
+				// samples in the brick interpolate up to the first voxel of the next brick
+				const int x0 = bx * brickSide, y0 = by * brickSide, z0 = bz * brickSide;
+				const int x1 = ( std::min )( x0 + brickSide + 1, blockSide );
+				const int y1 = ( std::min )( y0 + brickSide + 1, blockSide );
+				const int z1 = ( std::min )( z0 + brickSide + 1, blockSide );
+				// beyond the block the sampler reads 0
+				const bool outside = x0 + brickSide >= blockSide || y0 + brickSide >= blockSide || z0 + brickSide >= blockSide;
+				uint8_t lo = outside ? 0 : 255, hi = 0;
+				for ( int z = z0; z < z1; z++ ) {
+					for ( int y = y0; y < y1; y++ ) {
+						const auto row = block + ( z * side + y ) * side;
+						for ( int x = x0; x < x1; x++ ) {
+							lo = ( std::min )( lo, row[ x ] );
+							hi = ( std::max )( hi, row[ x ] );
+						}
+					}
+				}
+				const auto i = Index( 0, Point3i( cell.x * bricksPerBlock + bx, cell.y * bricksPerBlock + by, cell.z * bricksPerBlock + bz ) );
+				range[ 2 * i ] = lo;
+				range[ 2 * i + 1 ] = hi;
+			}
+		}
+	}
+}
+
+void MinMaxOctree::GroupRanges()
+{
+	// counting sort of the nodes by range
+	std::vector<uint32_t> first( 256 * 256 + 1, 0 );
+	for ( size_t i = 0; i < empty.size(); i++ ) {
+		first[ range[ 2 * i ] * 256 + range[ 2 * i + 1 ] + 1 ]++;
+	}
+	for ( size_t r = 0; r < 256 * 256; r++ ) {
+		if ( first[ r + 1 ] > 0 ) {
+			ranges.push_back( Range{ uint8_t( r / 256 ), uint8_t( r % 256 ), false, first[ r ] } );
+		}
+		first[ r + 1 ] += first[ r ];
+	}
+	rangeNodes.resize( empty.size() );
+	for ( size_t i = 0; i < empty.size(); i++ ) {
+		rangeNodes[ first[ range[ 2 * i ] * 256 + range[ 2 * i + 1 ] ]++ ] = uint32_t( i );
+	}
+}
+
+size_t MinMaxOctree::NodeCount() const
+{
+	return empty.size();
+}
+
+size_t MinMaxOctree::Classify( const float *transferFunction )
+{
+	// a summed table of the opacity's support, opaque[ v ] counts the values below v with
+	// nonzero opacity. Counts stay exact where a float sum would swallow a tiny opacity.
+	int opaque[ 257 ];
+	// changed[ v ] counts the values below v whose visibility differs from the last time
+	int changed[ 257 ];
+	opaque[ 0 ] = 0;
+	changed[ 0 ] = 0;
+	for ( int v = 0; v < 256; v++ ) {
+		const bool isVisible = transferFunction[ 4 * v + 3 ] > 0;
+		opaque[ v + 1 ] = opaque[ v ] + ( isVisible ? 1 : 0 );
+		changed[ v + 1 ] = changed[ v ] + ( !classified || visible[ v ] != isVisible ? 1 : 0 );
+		visible[ v ] = isVisible;
+	}
+	classified = true;
+	if ( changed[ 256 ] == 0 ) {
+		return 0;
+	}
+	size_t flipped = 0;
+	for ( size_t r = 0; r < ranges.size(); r++ ) {
+		auto &c = ranges[ r ];
+		if ( changed[ c.max + 1 ] == changed[ c.min ] ) {
+			continue;
+		}
+		// nodes start visible, only ranges that flip are written
+		const bool isEmpty = opaque[ c.max + 1 ] == opaque[ c.min ];
+		if ( isEmpty == c.empty ) {
+			continue;
+		}
+		c.empty = isEmpty;
+		const uint32_t end = r + 1 < ranges.size() ? ranges[ r + 1 ].firstNode : uint32_t( rangeNodes.size() );
+		for ( auto i = c.firstNode; i < end; i++ ) {
+			empty[ rangeNodes[ i ] ] = isEmpty;
+		}
+		flipped += end - c.firstNode;
+	}
+	return flipped;
+}
+
+float MinMaxOctree::ExitOf( int level, const Point3i &node, const Point3f &o, const Vec3f &d, float t ) const
+{
+	const float extent = float( brickSide << level );
+	float exit = ( std::numeric_limits<float>::max )();
+	const float lo[] = { node.x * extent, node.y * extent, node.z * extent };
+	const float origin[] = { o.x, o.y, o.z };
+	const float dir[] = { d.x, d.y, d.z };
+	for ( int a = 0; a < 3; a++ ) {
+		if ( dir[ a ] > 0 ) {
+			exit = ( std::min )( exit, ( lo[ a ] + extent - origin[ a ] ) / dir[ a ] );
+		} else if ( dir[ a ] < 0 ) {
+			exit = ( std::min )( exit, ( lo[ a ] - origin[ a ] ) / dir[ a ] );
+		}
+	}
+	return ( std::max )( exit, t );
+}
+
+bool MinMaxOctree::SkipEmpty( const Point3f &o, const Vec3f &d, float t, float &exit ) const
+{
+	exit = t;
+	const auto p = o + d * t;
+	const Point3i leaf( std::floor( p.x / brickSide ), std::floor( p.y / brickSide ), std::floor( p.z / brickSide ) );
+	const auto &size = levels[ 0 ].size;
+	if ( leaf.x < 0 || leaf.y < 0 || leaf.z < 0 || leaf.x >= size.x || leaf.y >= size.y || leaf.z >= size.z ) {
+		return false;
+	}
+	for ( int l = int( levels.size() ) - 1; l >= 0; l-- ) {
+		const Point3i node( leaf.x >> l, leaf.y >> l, leaf.z >> l );
+		// a point on the face the ray leaves through makes no progress
+		if ( Empty( l, node ) && ( exit = ExitOf( l, node, o, d, t ) ) > t ) {
+			return true;
+		}
+	}
+	exit = ExitOf( 0, leaf, o, d, t );
+	return false;
+}
+
+}  // namespace vm
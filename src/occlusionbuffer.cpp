@@ -0,0 +1,100 @@
+#include <occlusionbuffer.h>
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+namespace vm
+{
+OcclusionBuffer::OcclusionBuffer( int tileSize ) :
+  tileSize( ( std::max )( tileSize, 1 ) )
+{
+}
+
+void OcclusionBuffer::BeginFrame( int width, int height )
+{
+	if ( width != this->width || height != this->height ) {
+		// the published tiles belong to another film
+		valid = false;
+		published.clear();
+	}
+	this->width = width;
+	this->height = height;
+	tilesX = ( width + tileSize - 1 ) / tileSize;
+	tilesY = ( height + tileSize - 1 ) / tileSize;
+	recording.assign( size_t( tilesX ) * tilesY, 0.f );
+}
+
+void OcclusionBuffer::Record( int x, int y, float depth )
+{
+	auto &tile = recording[ size_t( y / tileSize ) * tilesX + x / tileSize ];
+	tile = ( std::max )( tile, depth );
+}
+
+void OcclusionBuffer::EndFrame( const Transform &worldToScreen, const Point3f &eye, const Vec3f &front )
+{
+	published.swap( recording );
+	this->worldToScreen = worldToScreen;
+	this->eye = eye;
+	this->front = front;
+	valid = true;
+}
+
+bool OcclusionBuffer::Occluded( float x0, float y0, float x1, float y1, float depth ) const
+{
+	if ( !valid || x1 < 0 || y1 < 0 || x0 >= width || y0 >= height ) {
+		return false;
+	}
+	const int tx0 = int( ( std::max )( x0, 0.f ) ) / tileSize;
+	const int ty0 = int( ( std::max )( y0, 0.f ) ) / tileSize;
+	const int tx1 = int( ( std::min )( x1, float( width - 1 ) ) ) / tileSize;
+	const int ty1 = int( ( std::min )( y1, float( height - 1 ) ) ) / tileSize;
+	for ( int ty = ty0; ty <= ty1; ty++ ) {
+		for ( int tx = tx0; tx <= tx1; tx++ ) {
+			if ( published[ size_t( ty ) * tilesX + tx ] >= depth ) {
+				return false;
+			}
+		}
+	}
+	return true;
+}
+
+bool OcclusionBuffer::Occluded( const Point3f &lo, const Point3f &hi ) const
+{
+	if ( !valid ) {
+		return false;
+	}
+	// the nearest point of the box bounds the distance of everything in it
+	const Point3f nearest( ( std::min )( ( std::max )( eye.x, lo.x ), hi.x ),
+						   ( std::min )( ( std::max )( eye.y, lo.y ), hi.y ),
+						   ( std::min )( ( std::max )( eye.z, lo.z ), hi.z ) );
+	const auto toNearest = nearest - eye;
+	const float depth = std::sqrt( toNearest.x * toNearest.x + toNearest.y * toNearest.y + toNearest.z * toNearest.z );
+	float x0 = ( std::numeric_limits<float>::max )(), y0 = x0;
+	float x1 = -x0, y1 = -x0;
+	for ( int i = 0; i < 8; i++ ) {
+		const Point3f corner( i & 1 ? hi.x : lo.x, i & 2 ? hi.y : lo.y, i & 4 ? hi.z : lo.z );
+		const auto v = corner - eye;
+		// a corner behind the eye does not project onto the film
+		if ( v.x * front.x + v.y * front.y + v.z * front.z <= 0 ) {
+			return false;
+		}
+		const auto p = worldToScreen * corner;
+		x0 = ( std::min )( x0, p.x );
+		y0 = ( std::min )( y0, p.y );
+		x1 = ( std::max )( x1, p.x );
+		y1 = ( std::max )( y1, p.y );
+	}
+	return Occluded( x0, y0, x1, y1, depth );
+}
+
+double OcclusionBuffer::OpaqueTileRatio() const
+{
+	if ( published.empty() ) {
+		return 0;
+	}
+	const auto opaque = std::count_if( published.begin(), published.end(),
+									   []( float d ) { return std::isfinite( d ); } );
+	return double( opaque ) / published.size();
+}
+
+}  // namespace vm
@@ -4,6 +4,7 @@ namespace vm
 {
 void MortonCodeCache::PageSwapIn_Implement( void *currentLevelPage, const void *nextLevelPage )
 {
+	swapInCount++;
 	memcpy( currentLevelPage, nextLevelPage, GetPageSize() );
 }
 void MortonCodeCache::PageSwapOut_Implement( void *nextLevelPage, const void *currentLevel )
@@ -0,0 +1,95 @@
+#include <pixelorder.h>
+#include <utility>
+
+namespace vm
+{
+namespace
+{
+uint32_t CompactBits( uint32_t v )
+{
+	v &= 0x55555555;
+	v = ( v ^ ( v >> 1 ) ) & 0x33333333;
+	v = ( v ^ ( v >> 2 ) ) & 0x0f0f0f0f;
+	v = ( v ^ ( v >> 4 ) ) & 0x00ff00ff;
+	v = ( v ^ ( v >> 8 ) ) & 0x0000ffff;
+	return v;
+}
+
+Vec2i MortonDecode( uint32_t d )
+{
+	return Vec2i( CompactBits( d ), CompactBits( d >> 1 ) );
+}
+
+/**
+ * @brief Maps the distance \a d along the Hilbert curve filling a \a n x \a n square to (x, y)
+ */
+Vec2i HilbertDecode( int n, uint32_t d )
+{
+	int x = 0, y = 0;
+	for ( int s = 1; s < n; s *= 2 ) {
+		const int rx = 1 & ( d / 2 );
+		const int ry = 1 & ( d ^ rx );
+		if ( ry == 0 ) {
+			if ( rx == 1 ) {
+				x = s - 1 - x;
+				y = s - 1 - y;
+			}
+			std::swap( x, y );
+		}
+		x += s * rx;
+		y += s * ry;
+		d /= 4;
+	}
+	return Vec2i( x, y );
+}
+}  // namespace
+
+PixelOrder PixelOrderFromName( const std::string &name )
+{
+	if ( name == "morton" ) return PixelOrder::Morton;
+	if ( name == "hilbert" ) return PixelOrder::Hilbert;
+	return PixelOrder::RowMajor;
+}
+
+const char *PixelOrderName( PixelOrder order )
+{
+	switch ( order ) {
+	case PixelOrder::Morton: return "morton";
+	case PixelOrder::Hilbert: return "hilbert";
+	default: return "rowmajor";
+	}
+}
+
+std::vector<Vec2i> GeneratePixelOrder( int width, int height, PixelOrder order, int tileSize )
+{
+	std::vector<Vec2i> pixels;
+	pixels.reserve( size_t( width ) * height );
+	if ( order == PixelOrder::RowMajor ) {
+		for ( int y = 0; y < height; y++ )
+			for ( int x = 0; x < width; x++ )
+				pixels.emplace_back( x, y );
+		return pixels;
+	}
+
+	int n = 1;
+	while ( n < tileSize ) n *= 2;
+
+	// the curve of one tile is shared by all tiles
+	std::vector<Vec2i> curve( n * n );
+	for ( int d = 0; d < n * n; d++ ) {
+		curve[ d ] = order == PixelOrder::Morton ? MortonDecode( d ) : HilbertDecode( n, d );
+	}
+
+	for ( int ty = 0; ty < height; ty += n ) {
+		for ( int tx = 0; tx < width; tx += n ) {
+			for ( const auto &p : curve ) {
+				const int x = tx + p.x, y = ty + p.y;
+				if ( x < width && y < height ) {
+					pixels.emplace_back( x, y );
+				}
+			}
+		}
+	}
+	return pixels;
+}
+}  // namespace vm
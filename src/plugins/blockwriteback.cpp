@@ -0,0 +1,136 @@
+#include "blockwriteback.h"
+#include <algorithm>
+#include <chrono>
+
+namespace vm
+{
+BlockWriteback::BlockWriteback( size_t blockCount, size_t blockBytes, const RangeFlusher &flushRange,
+								size_t thresholdBytes, int interval ) :
+  blockBytes( blockBytes ),
+  thresholdBytes( ( std::max )( thresholdBytes, blockBytes ) ),
+  interval( interval ),
+  flushRange( flushRange ),
+  blockCount( blockCount ),
+  dirty( new std::atomic<uint64_t>[ ( blockCount + 63 ) / 64 ] )
+{
+	for ( size_t i = 0; i < ( blockCount + 63 ) / 64; i++ ) {
+		dirty[ i ] = 0;
+	}
+	writer = std::thread( [ this ]() { Work(); } );
+}
+
+BlockWriteback::~BlockWriteback()
+{
+	{
+		std::lock_guard<std::mutex> lk( mtx );
+		stop = true;
+	}
+	cond.notify_all();
+	writer.join();
+	WriteBack( true );
+}
+
+void BlockWriteback::MarkDirty( size_t blockID )
+{
+	if ( blockID >= blockCount ) {
+		return;
+	}
+	const uint64_t bit = uint64_t( 1 ) << ( blockID % 64 );
+	if ( dirty[ blockID / 64 ].fetch_or( bit ) & bit ) {
+		return;
+	}
+	const auto count = ++dirtyCount;
+	// the count crosses the threshold once however the block size divides it
+	if ( count == 1 || ( ( count - 1 ) * blockBytes < thresholdBytes && count * blockBytes >= thresholdBytes ) ) {
+		// the writer checks the count under the lock, taking it here means the wakeup can not be lost
+		{
+			std::lock_guard<std::mutex> lk( mtx );
+		}
+		cond.notify_all();
+	}
+}
+
+bool BlockWriteback::Flush()
+{
+	return WriteBack( true );
+}
+
+size_t BlockWriteback::DirtyBlockCount() const
+{
+	return dirtyCount;
+}
+
+WritebackStatistics BlockWriteback::Statistics() const
+{
+	std::lock_guard<std::mutex> lk( mtx );
+	return stat;
+}
+
+void BlockWriteback::Work()
+{
+	std::unique_lock<std::mutex> lk( mtx );
+	while ( !stop ) {
+		cond.wait( lk, [ this ]() { return stop || dirtyCount != 0; } );
+		if ( stop ) {
+			break;
+		}
+		// give the writers time to fill a larger run unless enough has piled up already
+		cond.wait_for( lk, std::chrono::milliseconds( interval ),
+					   [ this ]() { return stop || dirtyCount * blockBytes >= thresholdBytes; } );
+		if ( stop ) {
+			break;
+		}
+		lk.unlock();
+		WriteBack( false );
+		lk.lock();
+	}
+}
+
+bool BlockWriteback::WriteBack( bool sync )
+{
+	std::lock_guard<std::mutex> writeLock( writeMtx );
+	bool ok = true;
+	size_t blocks = 0, runs = 0, failed = 0;
+	size_t first = 0, count = 0;
+	const auto flush = [ & ]() {
+		if ( count == 0 ) {
+			return;
+		}
+		runs++;
+		if ( !flushRange( first, count, sync ) ) {
+			failed++;
+			ok = false;
+		}
+		count = 0;
+	};
+	for ( size_t w = 0; w < ( blockCount + 63 ) / 64; w++ ) {
+		// cleared before writing, a block written during its writeback is dirtied again
+		const uint64_t bits = dirty[ w ].load( std::memory_order_relaxed ) ? dirty[ w ].exchange( 0 ) : 0;
+		if ( bits == 0 ) {
+			flush();
+			continue;
+		}
+		for ( size_t b = 0; b < 64; b++ ) {
+			const size_t id = w * 64 + b;
+			if ( ( bits >> b ) & 1 ) {
+				blocks++;
+				if ( count != 0 && id == first + count ) {
+					count++;
+				} else {
+					flush();
+					first = id;
+					count = 1;
+				}
+			}
+		}
+	}
+	flush();
+	dirtyCount -= blocks;
+	std::lock_guard<std::mutex> lk( mtx );
+	stat.blocks += blocks;
+	stat.runs += runs;
+	stat.failedRuns += failed;
+	return ok;
+}
+
+}  // namespace vm
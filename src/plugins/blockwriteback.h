@@ -0,0 +1,85 @@
+#pragma once
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace vm
+{
+struct WritebackStatistics
+{
+	size_t blocks = 0;
+	size_t runs = 0;
+	size_t failedRuns = 0;
+};
+
+/**
+ * @brief Tracks the dirty blocks of a file and writes them back in the background.
+ *
+ * MarkDirty only sets the bit of the block in an atomic bitmap, so any number of threads
+ * can mark blocks without taking a lock. A writer thread wakes when \a thresholdBytes of
+ * dirty blocks have piled up or \a interval milliseconds after the first unwritten block,
+ * takes the bitmap word by word and hands every run of consecutive blocks to \a flushRange
+ * at once, so a bulk write turns into a few large sequential writebacks instead of one per block.
+ *
+ * Flush hands everything still dirty to \a flushRange on the calling thread with \a sync set;
+ * making it durable (fdatasync) is left to the owner of the file. Blocks dirtied again while
+ * their run is written stay dirty.
+ */
+class BlockWriteback
+{
+public:
+	/**
+	 * @brief Writes back \a blockCount blocks from \a firstBlock, waiting for the disk if \a sync
+	 */
+	using RangeFlusher = std::function<bool( size_t firstBlock, size_t blockCount, bool sync )>;
+
+	BlockWriteback( size_t blockCount, size_t blockBytes, const RangeFlusher &flushRange,
+					size_t thresholdBytes = 64 * 1024 * 1024, int interval = 1000 );
+	/**
+	 * @brief Stops the writer thread and flushes the remaining blocks
+	 */
+	~BlockWriteback();
+	BlockWriteback( const BlockWriteback & ) = delete;
+	BlockWriteback &operator=( const BlockWriteback & ) = delete;
+
+	/**
+	 * @brief Thread safe and lock free
+	 */
+	void MarkDirty( size_t blockID );
+
+	/**
+	 * @brief Synchronously writes back all dirty blocks, returns false if a run failed
+	 */
+	bool Flush();
+
+	size_t DirtyBlockCount() const;
+	WritebackStatistics Statistics() const;
+
+private:
+	void Work();
+	bool WriteBack( bool sync );
+
+	const size_t blockBytes;
+	const size_t thresholdBytes;
+	const int interval;
+	RangeFlusher flushRange;
+
+	const size_t blockCount;
+	std::unique_ptr<std::atomic<uint64_t>[]> dirty;
+	std::atomic<size_t> dirtyCount{ 0 };
+
+	mutable std::mutex mtx;	 // only for waking the writer and the statistics
+	std::condition_variable cond;
+	bool stop = false;
+
+	std::mutex writeMtx;  // one writeback at a time, so runs of a block never overlap
+	WritebackStatistics stat;
+	std::thread writer;
+};
+
+}  // namespace vm
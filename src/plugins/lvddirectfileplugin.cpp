@@ -0,0 +1,190 @@
+#include "lvddirectfileplugin.h"
+#include <VMFoundation/logger.h>
+#include <cstdlib>
+#include <cstring>
+#include <stdexcept>
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+namespace vm
+{
+namespace
+{
+size_t RoundUp( size_t x, size_t a ) { return ( x + a - 1 ) / a * a; }
+}  // namespace
+
+void LVDDirectFilePlugin::AlignedDeleter::operator()( unsigned char *p ) const
+{
+#ifdef _WIN32
+	_aligned_free( p );
+#else
+	free( p );
+#endif
+}
+
+LVDDirectFilePlugin::AlignedBuffer LVDDirectFilePlugin::AllocateAligned( size_t bytes )
+{
+#ifdef _WIN32
+	return AlignedBuffer( (unsigned char *)_aligned_malloc( bytes, 4096 ) );
+#else
+	void *p = nullptr;
+	if ( posix_memalign( &p, 4096, bytes ) != 0 ) {
+		return nullptr;
+	}
+	return AlignedBuffer( (unsigned char *)p );
+#endif
+}
+
+LVDDirectFilePlugin::LVDDirectFilePlugin( ::vm::IRefCnt *cnt ) :
+  vm::EverythingBase<I3DBlockFilePluginInterface>( cnt )
+{
+}
+
+LVDDirectFilePlugin::~LVDDirectFilePlugin()
+{
+	Close();
+}
+
+void LVDDirectFilePlugin::Open( const std::string &fileName )
+{
+#ifdef _WIN32
+	throw std::runtime_error( "direct block reading is not supported on this platform" );
+#else
+	Close();
+	std::string error;
+	if ( !ReadLVDFileHeader( fileName, header, error ) ) {
+		throw std::runtime_error( error );
+	}
+	if ( header.voxelType != LVDFileHeader::UInt8 ) {
+		throw std::runtime_error( "only 8-bit voxels are supported" );
+	}
+	const size_t side = size_t( 1 ) << header.blockLengthInLog;
+	blockBytes = side * side * side;
+	blockCount = size_t( RoundUp( header.dataDim[ 0 ], side ) / side ) *
+				 ( RoundUp( header.dataDim[ 1 ], side ) / side ) *
+				 ( RoundUp( header.dataDim[ 2 ], side ) / side );
+	dataOffset = header.HeaderSize();
+	blockIndex = LVDBlockIndex();
+	if ( !ReadLVDBlockIndex( fileName, header, blockIndex, error ) && !error.empty() ) {
+		throw std::runtime_error( error );
+	}
+
+	directIO = false;
+#ifdef O_DIRECT
+	if ( requestDirectIO ) {
+		fd = open( fileName.c_str(), O_RDONLY | O_DIRECT );
+		directIO = fd >= 0;
+	}
+#endif
+	if ( fd < 0 ) {
+		// e.g. tmpfs refuses O_DIRECT
+		fd = open( fileName.c_str(), O_RDONLY );
+	}
+	if ( fd < 0 ) {
+		throw std::runtime_error( "failed to open lvd file" );
+	}
+	if ( requestDirectIO && !directIO ) {
+		LOG_INFO << "O_DIRECT is not available for " << fileName << ", reading through the page cache";
+	}
+
+	slotBytes = RoundUp( blockBytes + alignment, alignment );
+#endif
+}
+
+bool LVDDirectFilePlugin::Create( const Block3DDataFileDesc *desc )
+{
+	LOG_CRITICAL << "LVDDirectFilePlugin is read only";
+	return false;
+}
+
+void LVDDirectFilePlugin::Close()
+{
+#ifndef _WIN32
+	if ( fd >= 0 ) {
+		close( fd );
+	}
+#endif
+	fd = -1;
+	std::lock_guard<std::mutex> lk( slotMutex );
+	slots.clear();
+}
+
+unsigned char *LVDDirectFilePlugin::ThreadSlot()
+{
+	std::lock_guard<std::mutex> lk( slotMutex );
+	auto &slot = slots[ std::this_thread::get_id() ];
+	if ( !slot ) {
+		slot = AllocateAligned( slotBytes );
+	}
+	return slot.get();
+}
+
+const void *LVDDirectFilePlugin::GetPage( size_t pageID )
+{
+	if ( fd < 0 || pageID >= blockCount ) {
+		return nullptr;
+	}
+	const auto slot = ThreadSlot();
+	if ( slot == nullptr ) {
+		LOG_CRITICAL << "Failed to allocate the read buffer of block " << pageID;
+		return nullptr;
+	}
+	const size_t stored = blockIndex.slots.empty() ? pageID : blockIndex.Slot( 0, pageID );
+	const size_t offset = dataOffset + stored * blockBytes;
+	// O_DIRECT needs aligned offsets and lengths, the block is read with its surroundings
+	const size_t begin = directIO ? offset / alignment * alignment : offset;
+	const size_t needed = offset - begin + blockBytes;
+	const size_t length = directIO ? RoundUp( needed, alignment ) : needed;
+	size_t done = 0;
+#ifndef _WIN32
+	while ( done < needed ) {
+		const auto n = pread( fd, slot + done, length - done, begin + done );
+		if ( n <= 0 ) {
+			break;	// the aligned tail may run past the end of the file
+		}
+		done += n;
+	}
+#endif
+	if ( done < needed ) {
+		LOG_CRITICAL << "Failed to read block " << pageID;
+		return nullptr;
+	}
+	return slot + ( offset - begin );
+}
+
+bool LVDDirectFilePlugin::ReadPage( size_t pageID, void *dst )
+{
+	const auto page = GetPage( pageID );
+	if ( page == nullptr ) {
+		return false;
+	}
+	memcpy( dst, page, blockBytes );
+	return true;
+}
+
+Size3 LVDDirectFilePlugin::GetDataSizeWithoutPadding() const
+{
+	return Size3{ header.originalDataDim[ 0 ], header.originalDataDim[ 1 ], header.originalDataDim[ 2 ] };
+}
+
+Size3 LVDDirectFilePlugin::Get3DPageSize() const
+{
+	const size_t len = size_t( 1 ) << header.blockLengthInLog;
+	return Size3{ len, len, len };
+}
+
+Size3 LVDDirectFilePlugin::Get3DPageCount() const
+{
+	const size_t side = size_t( 1 ) << header.blockLengthInLog;
+	return Size3{ RoundUp( header.dataDim[ 0 ], side ) / side, RoundUp( header.dataDim[ 1 ], side ) / side, RoundUp( header.dataDim[ 2 ], side ) / side };
+}
+
+void LVDDirectFilePlugin::Write( const void *page, size_t pageID, bool flush )
+{
+	LOG_CRITICAL << "LVDDirectFilePlugin is read only";
+}
+
+}  // namespace vm
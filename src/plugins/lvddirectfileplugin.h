@@ -0,0 +1,86 @@
+#pragma once
+#include "lvdfileheader.h"
+#include <VMUtils/ieverything.hpp>
+#include <VMCoreExtension/i3dblockfileplugininterface.h>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+
+namespace vm
+{
+/**
+ * @brief Reads the blocks of a .lvd file with pread instead of a memory mapping.
+ *
+ * The file is opened with O_DIRECT when the file system supports it, so blocks go from the
+ * disk into the caller's cache pages without passing through the page cache and the cost
+ * of a miss no longer depends on page cache pressure or fault latency. Reads are aligned
+ * to the logical block size of the device through an aligned bounce buffer.
+ *
+ * GetPage is thread safe. Every calling thread reads into a slot of its own, so the returned
+ * page stays valid until the same thread calls GetPage again however many other threads read
+ * in between. ReadPage copies into the caller's memory instead. The backend is read only.
+ */
+class LVDDirectFilePlugin : public vm::EverythingBase<I3DBlockFilePluginInterface>
+{
+public:
+	LVDDirectFilePlugin( ::vm::IRefCnt *cnt );
+	~LVDDirectFilePlugin();
+
+	/**
+	 * @brief Chooses between O_DIRECT and buffered pread for the next Open
+	 */
+	void SetDirectIO( bool direct ) { requestDirectIO = direct; }
+	bool DirectIO() const { return directIO; }
+
+	/**
+	 * @brief Reads block \a pageID into \a dst, returns false if it can not be read
+	 */
+	bool ReadPage( size_t pageID, void *dst );
+
+	void Open( const std::string &fileName ) override;
+	bool Create( const Block3DDataFileDesc *desc ) override;
+	void Close() override;
+	const void *GetPage( size_t pageID ) override;
+	size_t GetPageSize() const override { return blockBytes; }
+	size_t GetPhysicalPageCount() const override { return blockCount; }
+	size_t GetVirtualPageCount() const override { return blockCount; }
+
+	int GetPadding() const override { return header.padding; }
+	Size3 GetDataSizeWithoutPadding() const override;
+	Size3 Get3DPageSize() const override;
+	int Get3DPageSizeInLog() const override { return header.blockLengthInLog; }
+	Size3 Get3DPageCount() const override;
+
+	void UnlockPage( size_t pageID ) override {}
+	void Flush() override {}
+	void Write( const void *page, size_t pageID, bool flush ) override;
+	void Flush( size_t pageID ) override {}
+
+private:
+	struct AlignedDeleter
+	{
+		void operator()( unsigned char *p ) const;
+	};
+	using AlignedBuffer = std::unique_ptr<unsigned char, AlignedDeleter>;
+	static AlignedBuffer AllocateAligned( size_t bytes );
+	/**
+	 * @brief Returns the read buffer of the calling thread, nullptr if it can not be allocated
+	 */
+	unsigned char *ThreadSlot();
+
+	LVDFileHeader header;
+	LVDBlockIndex blockIndex;  // empty if blocks are stored in order
+	int fd = -1;
+	bool requestDirectIO = true;
+	bool directIO = false;
+	size_t alignment = 4096;
+	size_t blockBytes = 0;
+	size_t blockCount = 0;
+	size_t dataOffset = 0;
+	size_t slotBytes = 0;
+	std::mutex slotMutex;
+	std::unordered_map<std::thread::id, AlignedBuffer> slots;
+};
+
+}  // namespace vm
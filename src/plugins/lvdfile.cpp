@@ -6,6 +6,12 @@
 #include <VMFoundation/logger.h>
 #include "lvdfile.h"
 
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
 namespace vm
 {
 void LVDFile::InitLVDIO()
@@ -48,33 +54,49 @@ void LVDFile::InitInfoByHeader(const LVDFileHeader & header){
 	oSize = vm::Size3( originalWidth, originalHeight, originalDepth );
 
 }
+void LVDFile::InitWriteback()
+{
+#ifndef _WIN32
+	syncFd = open( fileName.c_str(), O_RDWR );
+#endif
+	writeback = std::make_unique<BlockWriteback>( BlockCount(), BlockDataCount(),
+												  [ this ]( size_t firstBlock, size_t blockCount, bool sync ) { return FlushRange( firstBlock, blockCount, sync ); } );
+}
+
+bool LVDFile::FlushRange( size_t firstBlock, size_t blockCount, bool sync )
+{
+	const size_t blockBytes = BlockDataCount();
+	const size_t offset = header.HeaderSize() + firstBlock * blockBytes;
+	const size_t bytes = blockCount * blockBytes;
+#if defined( __linux__ )
+	if ( syncFd >= 0 ) {
+		// the dirty pages of the mapping are in the page cache, start writing the run out
+		const unsigned flags = sync ? SYNC_FILE_RANGE_WAIT_BEFORE | SYNC_FILE_RANGE_WRITE | SYNC_FILE_RANGE_WAIT_AFTER : SYNC_FILE_RANGE_WRITE;
+		return sync_file_range( syncFd, offset, bytes, flags ) == 0;
+	}
+#endif
+#ifndef _WIN32
+	// msync needs a page aligned address, the blocks behind the header are not
+	const size_t page = sysconf( _SC_PAGESIZE );
+	const size_t begin = offset / page * page;
+	return msync( lvdPtr + begin, offset + bytes - begin, sync ? MS_SYNC : MS_ASYNC ) == 0;
+#else
+	return lvdIO->Flush( lvdPtr + offset, bytes, 0 );
+#endif
+}
+
 LVDFile::LVDFile( const std::string &fileName ) :
   validFlag( true ), lvdIO( nullptr )
 {
-	std::ifstream fileHandle;
-
-	fileHandle.open( fileName, std::fstream::binary );
-	if ( !fileHandle.is_open() ) {
-		std::cout << "Can not open .lvd\n";
+	std::string error;
+	if ( !ReadLVDFileHeader( fileName, header, error ) ) {
+		std::cout << fileName << ": " << error << "\n";
 		validFlag = false;
-		fileHandle.close();
 		return;
 	}
-
-	unsigned char headerBuf[ LVD_HEADER_SIZE ];
-
-	fileHandle.read( (char *)headerBuf, LVD_HEADER_SIZE );
-	header.Decode( headerBuf );
-
-	fileHandle.close();
-
-	//uint32_t magicNumber;
-	//fileHandle.read((char*)&magicNumber, sizeof(int));
-
-	if ( header.magicNum != LVDFileMagicNumber ) {
-		std::cout << " This is not a lvd file\n";
+	if ( header.voxelType != LVDFileHeader::UInt8 ) {
+		std::cout << "Only 8-bit voxels are supported\n";
 		validFlag = false;
-		fileHandle.close();
 		return;
 	}
 
@@ -117,13 +139,23 @@ LVDFile::LVDFile( const std::string &fileName ) :
 	bSize = vm::Size3( bx, by, bz );
 	oSize = vm::Size3( originalWidth, originalHeight, originalDepth );
 
-	const std::size_t bytes = std::size_t( vx ) * vy * vz + LVD_HEADER_SIZE;
+	std::size_t bytes = std::size_t( vx ) * vy * vz + header.HeaderSize();
+	if ( ReadLVDBlockIndex( fileName, header, blockIndex, error ) ) {
+		// the slots are fewer than the blocks, the whole file is mapped so that nothing resizes it
+		bytes = std::ifstream( fileName, std::ios::binary | std::ios::ate ).tellg();
+	} else if ( !error.empty() ) {
+		std::cout << fileName << ": " << error << "\n";
+		validFlag = false;
+		return;
+	}
 
 	InitLVDIO();
 	lvdIO->Open( fileName, bytes, FileAccess::ReadWrite, MapAccess::ReadWrite );
 
 	lvdPtr = lvdIO->MemoryMap( 0, bytes );
 	if ( !lvdPtr ) throw std::runtime_error( "LVDReader: bad mapping" );
+	this->fileName = fileName;
+	mappedBytes = bytes;
 }
 
 LVDFile::LVDFile( const std::vector<std::string> &fileName, const std::vector<int> &lods )
@@ -136,7 +168,7 @@ LVDFile::LVDFile( const std::vector<std::string> &fileName, const std::vector<in
 }
 LVDFile::LVDFile( const std::string & fileName,int blockSideInLog, const Vec3i &dataSize, int padding )
 {
-	header.magicNum = LVDFileMagicNumber;
+	header.SetCurrentVersion();
 	header.blockLengthInLog = (uint32_t)blockSideInLog;
 	header.padding = padding;
 	if (blockSideInLog < 5 || blockSideInLog > 10) {
@@ -154,72 +186,95 @@ LVDFile::LVDFile( const std::string & fileName,int blockSideInLog, const Vec3i &
 	header.originalDataDim[ 1 ] = dataSize.y;
 	header.originalDataDim[ 2 ] = dataSize.z;
 
-	unsigned char headerBuf[ LVD_HEADER_SIZE ];
-	header.Encode();
-	memcpy( headerBuf, header.Encode(), LVD_HEADER_SIZE );
-
 	InitLVDIO();
 
-	const auto fileSize = dataX * dataY * dataZ + LVD_HEADER_SIZE;
+	const auto fileSize = dataX * dataY * dataZ + header.HeaderSize();
 
 	lvdIO->Open( fileName.c_str(), fileSize, FileAccess::ReadWrite, MapAccess::ReadWrite );
 	lvdPtr = lvdIO->MemoryMap( 0, fileSize );
 	if ( !lvdPtr ) 
 		throw std::runtime_error( "LVDReader: bad mapping" );
 
-	memcpy(lvdPtr,headerBuf,LVD_HEADER_SIZE);
-	lvdIO->Flush(lvdPtr,LVD_HEADER_SIZE,0);
+	memcpy( lvdPtr, header.Encode(), header.HeaderSize() );
+	lvdIO->Flush( lvdPtr, header.HeaderSize(), 0 );
 	InitInfoByHeader(header);
+	this->fileName = fileName;
+	mappedBytes = fileSize;
 }
 
 
 void LVDFile::ReadBlock( char *dest, int blockId, int lod )
 {
 	const size_t blockCount = BlockDataCount();
-	const auto d = lvdPtr + LVD_HEADER_SIZE;
+	const auto d = lvdPtr + header.HeaderSize();
 
 	//fileHandle.seekg(blockCount * blockId + 36, std::ios::beg);
-	memcpy( dest, d + blockCount * blockId, sizeof( char ) * blockCount );
+	memcpy( dest, d + blockCount * SlotOf( blockId ), sizeof( char ) * blockCount );
 	//fileHandle.read(dest, sizeof(char) * blockCount);
 }
 
 void LVDFile::WriteBlock( const char *src, int blockId, int lod )
 {
 	(void)lod;
+	if ( blockId < 0 || blockId >= BlockCount() ) {
+		LOG_CRITICAL << "LVDFile::WriteBlock -- block " << blockId << " out of range";
+		return;
+	}
+	if ( Deduplicated() ) {
+		LOG_CRITICAL << "LVDFile::WriteBlock -- " << fileName << " is deduplicated and read only";
+		return;
+	}
 	const size_t blockCount = BlockDataCount();
-	const auto d = lvdPtr + LVD_HEADER_SIZE;
+	const auto d = lvdPtr + header.HeaderSize();
 	memcpy(d + blockCount * blockId, src, sizeof( char ) * blockCount );
+	std::call_once( writebackOnce, [ this ]() { InitWriteback(); } );
+	writeback->MarkDirty( blockId );
 }
 
 bool LVDFile::Flush( int blockId, int lod )
 {
 	assert( lvdPtr );
 	(void)lod;
-	const auto d = lvdPtr + LVD_HEADER_SIZE;
-	const size_t blockCount = BlockDataCount();
-	return lvdIO->Flush( d + blockCount * blockId, sizeof( char ) * blockCount, 0 );
+	return FlushRange( blockId, 1, true );
 }
 
 bool LVDFile::Flush()
 {
-	LOG_CRITICAL << "LVDReader::Flush() -- Not implement yet";
-	return false;
+	if ( !writeback ) {
+		return true;  // nothing has been written
+	}
+	bool ok = writeback->Flush();
+#ifndef _WIN32
+	ok = ( syncFd >= 0 ? fdatasync( syncFd ) == 0 : msync( lvdPtr, mappedBytes, MS_SYNC ) == 0 ) && ok;
+#endif
+	if ( !ok ) {
+		LOG_CRITICAL << "Failed to flush " << fileName;
+	}
+	return ok;
 }
 
 void LVDFile::Close()
 {
+	// the writer thread touches the mapping, it goes first
+	writeback = nullptr;
+#ifndef _WIN32
+	if ( syncFd >= 0 ) {
+		close( syncFd );
+		syncFd = -1;
+	}
+#endif
 	lvdIO = nullptr;
 }
 
 unsigned char *LVDFile::ReadBlock( int blockId, int lod )
 {
 	const size_t blockCount = BlockDataCount();
-	const auto d = lvdPtr + LVD_HEADER_SIZE;
-	return d + blockCount * blockId;
+	const auto d = lvdPtr + header.HeaderSize();
+	return d + blockCount * SlotOf( blockId );
 }
 
 LVDFile::~LVDFile()
 {
-	//delete lvdIO;
+	Close();
 }
 }  // namespace ysl
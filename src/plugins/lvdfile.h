@@ -3,12 +3,14 @@
 
 
 #include <memory>
+#include <mutex>
 #include <VMFoundation/blockarray.h>
 #include <vector>
 #include <VMUtils/ref.hpp>
 #include <VMCoreExtension/ifilemappingplugininterface.h>
 
 #include "lvdfileheader.h"
+#include "blockwriteback.h"
 
 
 /**
@@ -31,10 +33,6 @@ class LVDFile
 	int padding;
 	bool validFlag;
 	enum
-	{
-		LVDFileMagicNumber = 277536
-	};
-	enum
 	{
 		LogBlockSize5 = 5,
 		LogBlockSize6 = 6,
@@ -47,6 +45,13 @@ class LVDFile
 
 	void InitLVDIO();
 	void InitInfoByHeader(const LVDFileHeader & header);
+	/**
+	 * @brief Starts the writeback on the first write, files that are only read never open a
+	 * writable descriptor or a writer thread
+	 */
+	void InitWriteback();
+	bool FlushRange( size_t firstBlock, size_t blockCount, bool sync );
+	size_t SlotOf( int blockId ) const { return blockIndex.slots.empty() ? blockId : blockIndex.Slot( 0, blockId ); }
 
 public:
 	explicit LVDFile( const std::string &fileName );
@@ -64,9 +69,29 @@ public:
 	template <typename T, int nLogBlockSize>
 	std::shared_ptr<Block3DArray<T, nLogBlockSize>> ReadAll( int lod = 0 );
 	void ReadBlock( char *dest, int blockId, int lod = 0 );
+	/**
+	 * @brief Returns true if identical blocks share their storage through a block index
+	 */
+	bool Deduplicated() const { return !blockIndex.slots.empty(); }
+	/**
+	 * @brief Copies a block into the mapping and marks it dirty for the background writeback
+	 *
+	 * Thread safe for distinct blocks: producers copy straight into their own blocks of the
+	 * shared mapping and only set a bit in the dirty bitmap, nothing locks the file. Writes
+	 * of the same block from several threads race. Other processes may open the same file
+	 * and write disjoint blocks too, each one flushes its own blocks. Deduplicated files are
+	 * read only, a block may be the storage of many others.
+	 */
 	void WriteBlock( const char *src, int blockId, int lod );
+	/**
+	 * @brief Writes a single block back and waits for it
+	 */
 	bool Flush( int blockId, int lod );
+	/**
+	 * @brief Writes back all dirty blocks in coalesced runs and returns once they are durable
+	 */
 	bool Flush();
+	size_t DirtyBlockCount() const { return writeback ? writeback->DirtyBlockCount() : 0; }
 	void Close();
 	unsigned char *ReadBlock( int blockId, int lod = 0 );
 	const LVDFileHeader &GetHeader() const { return header; }
@@ -74,6 +99,11 @@ public:
 
 private:
 	Ref<IMappingFile> lvdIO;
+	LVDBlockIndex blockIndex;
+	std::once_flag writebackOnce;
+	std::unique_ptr<BlockWriteback> writeback;
+	int syncFd = -1;
+	size_t mappedBytes = 0;
 };
 
 template <typename T, int nLogBlockSize>
@@ -1,17 +1,31 @@
-
 #include "lvdfileheader.h"
+#include <algorithm>
 #include <cstring>
+#include <fstream>
 
 namespace vm
 {
-vm::LVDFileHeader::LVDFileHeader() :
-  buf( new unsigned char[ BufSize ] )
+vm::LVDFileHeader::LVDFileHeader()
+{
+	magicNum = MagicNumber;
+	for ( int i = 0; i < 3; i++ ) {
+		dataDim[ i ] = 0;
+		originalDataDim[ i ] = 0;
+	}
+	blockLengthInLog = 0;
+	padding = 0;
+}
+
+void LVDFileHeader::SetCurrentVersion()
 {
+	magicNum = VersionedMagicNumber;
+	version = CurrentVersion;
+	headerSize = DefaultHeaderSize;
 }
 
 int LVDFileHeader::HeaderSize() const
 {
-	return LVD_HEADER_SIZE;
+	return headerSize;
 }
 
 void LVDFileHeader::Decode( unsigned char *p )
@@ -22,23 +36,188 @@ void LVDFileHeader::Decode( unsigned char *p )
 	memcpy( &dataDim[ 2 ], p + LVD_DATA_DEPTH_FIELD_OFFSET, LVD_DATA_DEPTH_FIELD_SIZE );
 	memcpy( &blockLengthInLog, p + LVD_BLOCK_LOG_FILED_OFFSET, LVD_DATA_BLOCK_LENGTH_IN_LOG_FILED_SIZE );
 	memcpy( &padding, p + LVD_BLOCK_PADDING_FIELD_OFFSET, LVD_DATA_PADDING_FIELD_SIZE );
-	memcpy( &originalDataDim[ 0 ], p + LVD_DATA_ORIGINAL_WIDTH_FIELD_OFFSET, LVD_DATA_ORIGINAL_WIDTH_FIELD_OFFSET );
-	memcpy( &originalDataDim[ 1 ], p + LVD_DATA_ORIGINAL_HEIGHT_FIELD_OFFSET, LVD_DATA_ORIGINAL_HEIGHT_FIELD_OFFSET );
-	memcpy( &originalDataDim[ 2 ], p + LVD_DATA_ORIGINAL_DEPTH_FIELD_OFFSET, LVD_DATA_ORIGINAL_DEPTH_FIELD_OFFSET );
+	memcpy( &originalDataDim[ 0 ], p + LVD_DATA_ORIGINAL_WIDTH_FIELD_OFFSET, LVD_DATA_ORIGINAL_WIDTH_FIELD_SIZE );
+	memcpy( &originalDataDim[ 1 ], p + LVD_DATA_ORIGINAL_HEIGHT_FIELD_OFFSET, LVD_DATA_ORIGINAL_HEIGHT_FIELD_SIZE );
+	memcpy( &originalDataDim[ 2 ], p + LVD_DATA_ORIGINAL_DEPTH_FIELD_OFFSET, LVD_DATA_ORIGINAL_DEPTH_FIELD_SIZE );
+
+	if ( magicNum != VersionedMagicNumber ) {
+		// files written before the header had a version, the blocks follow the fields above
+		version = 0;
+		headerSize = LVD_HEADER_SIZE;
+		voxelType = UInt8;
+		compression = None;
+		blockIndexOffset = 0;
+		statisticsOffset = 0;
+		errorBound = 0;
+		return;
+	}
+	memcpy( &version, p + LVD_VERSION_FIELD_OFFSET, LVD_VERSION_FIELD_SIZE );
+	memcpy( &headerSize, p + LVD_HEADER_SIZE_FIELD_OFFSET, LVD_HEADER_SIZE_FIELD_SIZE );
+	memcpy( &voxelType, p + LVD_VOXEL_TYPE_FIELD_OFFSET, LVD_VOXEL_TYPE_FIELD_SIZE );
+	memcpy( &compression, p + LVD_COMPRESSION_FIELD_OFFSET, LVD_COMPRESSION_FIELD_SIZE );
+	memcpy( &blockIndexOffset, p + LVD_BLOCK_INDEX_OFFSET_FIELD_OFFSET, LVD_BLOCK_INDEX_OFFSET_FIELD_SIZE );
+	memcpy( &statisticsOffset, p + LVD_STATISTICS_OFFSET_FIELD_OFFSET, LVD_STATISTICS_OFFSET_FIELD_SIZE );
+	errorBound = 0;
+	if ( headerSize >= LVD_HEADER_KNOWN_SIZE ) {
+		memcpy( &errorBound, p + LVD_ERROR_BOUND_FIELD_OFFSET, LVD_ERROR_BOUND_FIELD_SIZE );
+	}
 }
 
 unsigned char *LVDFileHeader::Encode()
 {
+	const size_t size = magicNum == VersionedMagicNumber ? ( std::max )( size_t( headerSize ), size_t( LVD_HEADER_KNOWN_SIZE ) ) : LVD_HEADER_SIZE;
+	if ( bufSize < size ) {
+		buf.reset( new unsigned char[ size ] );
+		bufSize = size;
+	}
 	const auto p = buf.get();
+	memset( p, 0, bufSize );
 	memcpy( p + ( LVD_HEADER_MAGIC_FILED_OFFSET ), ( &magicNum ), ( LVD_HEADER_MAGIC_FILED_SIZE ) );
 	memcpy( p + LVD_DATA_WIDTH_FIELD_OFFSET, &dataDim[ 0 ], LVD_DATA_WIDTH_FIELD_SIZE );
 	memcpy( p + LVD_DATA_HEIGHT_FIELD_OFFSET, &dataDim[ 1 ], LVD_DATA_HEIGHT_FIELD_SIZE );
 	memcpy( p + LVD_DATA_DEPTH_FIELD_OFFSET, &dataDim[ 2 ], LVD_DATA_DEPTH_FIELD_SIZE );
 	memcpy( p + LVD_BLOCK_LOG_FILED_OFFSET, &blockLengthInLog, LVD_DATA_BLOCK_LENGTH_IN_LOG_FILED_SIZE );
 	memcpy( p + LVD_BLOCK_PADDING_FIELD_OFFSET, &padding, LVD_DATA_PADDING_FIELD_SIZE );
-	memcpy( p + LVD_DATA_ORIGINAL_WIDTH_FIELD_OFFSET, &originalDataDim[ 0 ], LVD_DATA_ORIGINAL_WIDTH_FIELD_OFFSET );
-	memcpy( p + LVD_DATA_ORIGINAL_HEIGHT_FIELD_OFFSET, &originalDataDim[ 1 ], LVD_DATA_ORIGINAL_HEIGHT_FIELD_OFFSET );
-	memcpy( p + LVD_DATA_ORIGINAL_DEPTH_FIELD_OFFSET, &originalDataDim[ 2 ], LVD_DATA_ORIGINAL_DEPTH_FIELD_OFFSET );
+	memcpy( p + LVD_DATA_ORIGINAL_WIDTH_FIELD_OFFSET, &originalDataDim[ 0 ], LVD_DATA_ORIGINAL_WIDTH_FIELD_SIZE );
+	memcpy( p + LVD_DATA_ORIGINAL_HEIGHT_FIELD_OFFSET, &originalDataDim[ 1 ], LVD_DATA_ORIGINAL_HEIGHT_FIELD_SIZE );
+	memcpy( p + LVD_DATA_ORIGINAL_DEPTH_FIELD_OFFSET, &originalDataDim[ 2 ], LVD_DATA_ORIGINAL_DEPTH_FIELD_SIZE );
+	if ( magicNum == VersionedMagicNumber ) {
+		memcpy( p + LVD_VERSION_FIELD_OFFSET, &version, LVD_VERSION_FIELD_SIZE );
+		memcpy( p + LVD_HEADER_SIZE_FIELD_OFFSET, &headerSize, LVD_HEADER_SIZE_FIELD_SIZE );
+		memcpy( p + LVD_VOXEL_TYPE_FIELD_OFFSET, &voxelType, LVD_VOXEL_TYPE_FIELD_SIZE );
+		memcpy( p + LVD_COMPRESSION_FIELD_OFFSET, &compression, LVD_COMPRESSION_FIELD_SIZE );
+		memcpy( p + LVD_BLOCK_INDEX_OFFSET_FIELD_OFFSET, &blockIndexOffset, LVD_BLOCK_INDEX_OFFSET_FIELD_SIZE );
+		memcpy( p + LVD_STATISTICS_OFFSET_FIELD_OFFSET, &statisticsOffset, LVD_STATISTICS_OFFSET_FIELD_SIZE );
+		if ( headerSize >= LVD_HEADER_KNOWN_SIZE ) {
+			memcpy( p + LVD_ERROR_BOUND_FIELD_OFFSET, &errorBound, LVD_ERROR_BOUND_FIELD_SIZE );
+		}
+	}
 	return p;
 }
+
+bool LVDFileHeader::Validate( size_t fileBytes, std::string &error ) const
+{
+	if ( magicNum != MagicNumber && magicNum != VersionedMagicNumber ) {
+		error = "not a lvd file";
+		return false;
+	}
+	if ( version > CurrentVersion ) {
+		error = "lvd version " + std::to_string( version ) + " is newer than this reader";
+		return false;
+	}
+	if ( magicNum == VersionedMagicNumber && ( version == 0 || headerSize < LVD_HEADER_V1_SIZE ) ) {
+		error = "corrupted lvd header";
+		return false;
+	}
+	if ( blockLengthInLog < 1 || blockLengthInLog > 10 ) {
+		error = "unsupported block size";
+		return false;
+	}
+	const uint32_t side = 1u << blockLengthInLog;
+	if ( 2 * padding >= side ) {
+		error = "padding does not fit in a block";
+		return false;
+	}
+	size_t voxels = 1;
+	for ( int i = 0; i < 3; i++ ) {
+		if ( dataDim[ i ] == 0 || dataDim[ i ] % side != 0 ) {
+			error = "data size is not a multiple of the block size";
+			return false;
+		}
+		voxels *= dataDim[ i ];
+	}
+	const size_t voxelBytes[] = { 1, 2, 4 };
+	if ( voxelType > Float32 ) {
+		error = "unknown voxel type";
+		return false;
+	}
+	if ( compression > FixedAccuracy ) {
+		error = "unknown compression";
+		return false;
+	}
+	// lossy blocks have variable sizes, the block table at blockIndexOffset locates them
+	if ( compression == FixedAccuracy && ( voxelType != Float32 || !( errorBound > 0 ) || blockIndexOffset == 0 ) ) {
+		error = "corrupted lossy compression fields";
+		return false;
+	}
+	// with a block index the blocks are slots whose number only the index knows
+	const size_t dataBytes = blockIndexOffset != 0 ? 0 : voxels * voxelBytes[ voxelType ];
+	if ( fileBytes < headerSize + dataBytes ) {
+		error = "lvd file is truncated";
+		return false;
+	}
+	// optional tables are appended behind the blocks
+	for ( const auto offset : { blockIndexOffset, statisticsOffset } ) {
+		if ( offset != 0 && ( offset < headerSize + dataBytes || offset >= fileBytes ) ) {
+			error = "table offset out of range";
+			return false;
+		}
+	}
+	return true;
+}
+
+bool ReadLVDFileHeader( const std::string &fileName, LVDFileHeader &header, std::string &error )
+{
+	std::ifstream in( fileName, std::ios::binary | std::ios::ate );
+	if ( !in.is_open() ) {
+		error = "can not open " + fileName;
+		return false;
+	}
+	const size_t fileBytes = in.tellg();
+	in.seekg( 0 );
+	// short files still decode, Validate rejects them by size
+	unsigned char buf[ LVD_HEADER_KNOWN_SIZE ] = {};
+	in.read( (char *)buf, LVD_HEADER_KNOWN_SIZE );
+	header.Decode( buf );
+	return header.Validate( fileBytes, error );
+}
+
+bool ReadLVDBlockIndex( const std::string &fileName, const LVDFileHeader &header, LVDBlockIndex &index, std::string &error )
+{
+	error.clear();
+	if ( header.blockIndexOffset == 0 ) {
+		return false;
+	}
+	if ( header.compression != LVDFileHeader::None ) {
+		error = "compressed blocks are located by a block table, not a slot index";
+		return false;
+	}
+	const size_t side = size_t( 1 ) << header.blockLengthInLog;
+	const size_t voxelBytes[] = { 1, 2, 4 };
+	const size_t blockBytes = side * side * side * voxelBytes[ header.voxelType ];
+	const size_t blockCount = size_t( header.dataDim[ 0 ] / side ) * ( header.dataDim[ 1 ] / side ) * ( header.dataDim[ 2 ] / side );
+
+	std::ifstream in( fileName, std::ios::binary );
+	in.seekg( header.blockIndexOffset );
+	uint32_t magic = 0, count = 0;
+	uint64_t slotCount = 0;
+	in.read( (char *)&magic, sizeof( magic ) );
+	in.read( (char *)&count, sizeof( count ) );
+	in.read( (char *)&slotCount, sizeof( slotCount ) );
+	if ( !in || magic != LVDBlockIndex::MagicNumber ) {
+		error = "corrupted block index";
+		return false;
+	}
+	if ( count == 0 || header.HeaderSize() + slotCount * blockBytes > header.blockIndexOffset ) {
+		error = "block index does not match the data";
+		return false;
+	}
+	index.slots.resize( size_t( count ) * blockCount );
+	in.read( (char *)index.slots.data(), index.slots.size() * sizeof( uint32_t ) );
+	if ( !in ) {
+		error = "truncated block index";
+		return false;
+	}
+	for ( const auto s : index.slots ) {
+		if ( s >= slotCount ) {
+			error = "block index refers to a missing slot";
+			return false;
+		}
+	}
+	index.timestepCount = count;
+	index.blockCount = blockCount;
+	index.slotCount = slotCount;
+	return true;
+}
+
 }  // namespace ysl
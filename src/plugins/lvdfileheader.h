@@ -3,6 +3,8 @@
 
 #include <cstdint>
 #include <memory>
+#include <string>
+#include <vector>
 
 #define LVD_HEADER_BUF_ORIGIN_OFFSET 0
 
@@ -44,24 +46,158 @@
 
 #define LVD_HEADER_SIZE ( ( LVD_DATA_ORIGINAL_DEPTH_FIELD_OFFSET ) + ( LVD_DATA_ORIGINAL_DEPTH_FIELD_SIZE ) )
 
+// Fields of versioned headers, they follow the fields above
+
+#define LVD_VERSION_FIELD_SIZE 4
+
+#define LVD_HEADER_SIZE_FIELD_SIZE 4
+
+#define LVD_VOXEL_TYPE_FIELD_SIZE 4
+
+#define LVD_COMPRESSION_FIELD_SIZE 4
+
+#define LVD_BLOCK_INDEX_OFFSET_FIELD_SIZE 8
+
+#define LVD_STATISTICS_OFFSET_FIELD_SIZE 8
+
+#define LVD_VERSION_FIELD_OFFSET ( LVD_HEADER_SIZE )
+
+#define LVD_HEADER_SIZE_FIELD_OFFSET ( ( LVD_VERSION_FIELD_OFFSET ) + ( LVD_VERSION_FIELD_SIZE ) )
+
+#define LVD_VOXEL_TYPE_FIELD_OFFSET ( ( LVD_HEADER_SIZE_FIELD_OFFSET ) + ( LVD_HEADER_SIZE_FIELD_SIZE ) )
+
+#define LVD_COMPRESSION_FIELD_OFFSET ( ( LVD_VOXEL_TYPE_FIELD_OFFSET ) + ( LVD_VOXEL_TYPE_FIELD_SIZE ) )
+
+#define LVD_BLOCK_INDEX_OFFSET_FIELD_OFFSET ( ( LVD_COMPRESSION_FIELD_OFFSET ) + ( LVD_COMPRESSION_FIELD_SIZE ) )
+
+#define LVD_STATISTICS_OFFSET_FIELD_OFFSET ( ( LVD_BLOCK_INDEX_OFFSET_FIELD_OFFSET ) + ( LVD_BLOCK_INDEX_OFFSET_FIELD_SIZE ) )
+
+#define LVD_HEADER_V1_SIZE ( ( LVD_STATISTICS_OFFSET_FIELD_OFFSET ) + ( LVD_STATISTICS_OFFSET_FIELD_SIZE ) )
+
+// Appended to version 1, headers shorter than this leave the fields below zero
+
+#define LVD_ERROR_BOUND_FIELD_SIZE 4
+
+#define LVD_ERROR_BOUND_FIELD_OFFSET ( LVD_HEADER_V1_SIZE )
+
+#define LVD_HEADER_KNOWN_SIZE ( ( LVD_ERROR_BOUND_FIELD_OFFSET ) + ( LVD_ERROR_BOUND_FIELD_SIZE ) )
+
 namespace vm
 {
+/**
+ * @brief Header of a .lvd file.
+ *
+ * Files without a version (version 0) start with the LVD_HEADER_SIZE bytes of the first
+ * fields and the blocks follow right after. Versioned files use VersionedMagicNumber and
+ * append the version, the size of the whole header, the voxel type, the compression and
+ * the offsets of optional tables (0 if absent). The blocks start at headerSize, which is
+ * a page for new files so that blocks stay aligned for mapping and direct I/O. Readers skip
+ * header bytes they do not know, so fields can be appended without a new version as long
+ * as zero keeps the old meaning.
+ */
 class LVDFileHeader
 {
 	std::unique_ptr<unsigned char[]> buf;
-	static constexpr int BufSize = 64;
+	size_t bufSize = 0;
 
 public:
+	enum : uint32_t
+	{
+		MagicNumber = 277536,
+		VersionedMagicNumber = 277537,
+		CurrentVersion = 1,
+		DefaultHeaderSize = 4096
+	};
+	enum VoxelType : uint32_t
+	{
+		UInt8 = 0,
+		UInt16 = 1,
+		Float32 = 2
+	};
+	enum Compression : uint32_t
+	{
+		None = 0,
+		FixedAccuracy = 1  // lossy float blocks within errorBound, see lossyblockcodec.h
+	};
+
 	uint32_t magicNum;
 	uint32_t dataDim[ 3 ];
 	uint32_t blockLengthInLog;
 	uint32_t padding;
 	uint32_t originalDataDim[ 3 ];
 
+	uint32_t version = 0;
+	uint32_t headerSize = LVD_HEADER_SIZE;
+	uint32_t voxelType = UInt8;
+	uint32_t compression = None;
+	uint64_t blockIndexOffset = 0;
+	uint64_t statisticsOffset = 0;
+	float errorBound = 0;  // largest absolute error of a lossy compression, 0 if lossless
+
 public:
 	LVDFileHeader();
+
+	/**
+	 * @brief Makes this a header of the current version with default extension fields
+	 */
+	void SetCurrentVersion();
+
+	/**
+	 * @brief Returns the offset of the first block
+	 */
 	int HeaderSize() const;
+
+	/**
+	 * @brief Decodes a header from \a buf, which must hold LVD_HEADER_KNOWN_SIZE bytes,
+	 * zero filled if the file is shorter
+	 */
 	void Decode( unsigned char *buf );
+
+	/**
+	 * @brief Returns HeaderSize() bytes to be written at the beginning of the file
+	 */
 	unsigned char *Encode();
+
+	/**
+	 * @brief Checks the fields and a file of \a fileBytes bytes against each other
+	 */
+	bool Validate( size_t fileBytes, std::string &error ) const;
 };
+
+/**
+ * @brief Reads, decodes and validates the header of \a fileName
+ */
+bool ReadLVDFileHeader( const std::string &fileName, LVDFileHeader &header, std::string &error );
+
+/**
+ * @brief The optional block index table of a versioned file, at the header's blockIndexOffset:
+ *
+ *   uint32 magic, uint32 timestep count, uint64 slot count,
+ *   uint32 slot[ timestep count ][ block count ]
+ *
+ * With an index the blocks are not stored in block order. The data behind the header is a
+ * sequence of slots and the table maps every block of every timestep to the slot holding
+ * its data, so byte-identical blocks are stored once. Files without an index keep block i
+ * in slot i.
+ */
+struct LVDBlockIndex
+{
+	enum : uint32_t
+	{
+		MagicNumber = 0x5354564c  // "LVTS"
+	};
+	size_t timestepCount = 0;
+	size_t blockCount = 0;
+	size_t slotCount = 0;
+	std::vector<uint32_t> slots;
+
+	size_t Slot( size_t timestep, size_t blockID ) const { return slots[ timestep * blockCount + blockID ]; }
+};
+
+/**
+ * @brief Reads and checks the block index of \a fileName described by \a header.
+ * Returns false with an empty \a error if the file has no index.
+ */
+bool ReadLVDBlockIndex( const std::string &fileName, const LVDFileHeader &header, LVDBlockIndex &index, std::string &error );
+
 }  // namespace ysl
@@ -21,8 +21,9 @@ void LVDFilePlugin::Close()
 inline void LVDFilePlugin::Open( const std::string &fileName )
 {
 	lvdReader = std::make_unique<LVDFile>( fileName );
-	if ( lvdReader == nullptr ) {
-		throw std::runtime_error( "failed to open lvd file" );
+	if ( !lvdReader->Valid() ) {
+		lvdReader = nullptr;
+		throw std::runtime_error( "failed to open lvd file " + fileName );
 	}
 }
 inline Size3 LVDFilePlugin::Get3DPageSize() const
@@ -32,6 +33,9 @@ inline Size3 LVDFilePlugin::Get3DPageSize() const
 }
 void LVDFilePlugin::Flush()
 {
+	if ( lvdReader ) {
+		lvdReader->Flush();
+	}
 }
 void LVDFilePlugin::Write( const void *page, size_t pageID, bool flush )
 {
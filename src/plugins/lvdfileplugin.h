@@ -1,5 +1,6 @@
 #pragma once
 #include "lvdfile.h"
+#include "lvddirectfileplugin.h"
 #include <VMUtils/vmnew.hpp>
 #include <VMUtils/ieverything.hpp>
 #include <VMCoreExtension/plugin.h>
@@ -31,6 +32,10 @@ public:
 
 	void Flush() override;
 
+	/**
+	 * @brief Thread safe for distinct \a pageID, see LVDFile::WriteBlock. Block3DCache is
+	 * not, concurrent producers call this directly and finish with one Flush().
+	 */
 	void Write( const void *page, size_t pageID, bool flush ) override;
 
 	void Flush( size_t pageID ) override;
@@ -44,12 +49,16 @@ class LVDFilePluginFactory : public vm::IPluginFactory
 {
 public:
 	DECLARE_PLUGIN_FACTORY( "visualman.blockdata.io" )
-	std::vector<std::string> Keys() const override { return { ".lvd" }; }
+	std::vector<std::string> Keys() const override { return { ".lvd", ".lvd.direct", ".lvts" }; }
 	::vm::IEverything *Create( const std::string &key ) override
 	{
-		if ( key == ".lvd" ) {
+		// a .lvts time series opens as the volume of its first timestep
+		if ( key == ".lvd" || key == ".lvts" ) {
 			return VM_NEW<vm::LVDFilePlugin>();
 		}
+		if ( key == ".lvd.direct" ) {
+			return VM_NEW<vm::LVDDirectFilePlugin>();
+		}
 		return nullptr;
 	}
 };
@@ -0,0 +1,227 @@
+#include <renderservice.h>
+#include <VMFoundation/logger.h>
+#include <iostream>
+#include <mutex>
+#include <sstream>
+
+#ifndef _WIN32
+#include <cerrno>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+#ifndef MSG_NOSIGNAL
+#define MSG_NOSIGNAL 0
+#endif
+#endif
+
+namespace vm
+{
+namespace
+{
+class StdinJobChannel : public IRenderJobChannel
+{
+public:
+	bool ReadLine( std::string &line ) override
+	{
+		return static_cast<bool>( std::getline( std::cin, line ) );
+	}
+	void ReplyTo( size_t, const std::string &line ) override
+	{
+		std::lock_guard<std::mutex> lk( mutex );
+		std::cout << line << std::endl;
+	}
+
+private:
+	std::mutex mutex;
+};
+
+#ifndef _WIN32
+class LocalSocketJobChannel : public IRenderJobChannel
+{
+	std::string path;
+	int listenFd = -1;
+	// written by the reading thread under the mutex, replies of other threads write under it
+	int clientFd = -1;
+	size_t client = 0;
+	std::mutex mutex;
+	std::string pending;
+
+	bool Accept()
+	{
+		int fd;
+		// a client that hangs up before it is accepted must not end the service
+		do {
+			fd = accept( listenFd, nullptr, nullptr );
+		} while ( fd < 0 && ( errno == EINTR || errno == ECONNABORTED ) );
+#ifdef SO_NOSIGPIPE
+		if ( fd >= 0 ) {
+			const int on = 1;
+			setsockopt( fd, SOL_SOCKET, SO_NOSIGPIPE, &on, sizeof( on ) );
+		}
+#endif
+		std::lock_guard<std::mutex> lk( mutex );
+		clientFd = fd;
+		client++;
+		pending.clear();
+		return clientFd >= 0;
+	}
+
+	void Hangup()
+	{
+		std::lock_guard<std::mutex> lk( mutex );
+		close( clientFd );
+		clientFd = -1;
+	}
+
+public:
+	explicit LocalSocketJobChannel( const std::string &path ) :
+	  path( path )
+	{
+	}
+
+	bool Listen()
+	{
+		sockaddr_un addr = {};
+		if ( path.size() >= sizeof( addr.sun_path ) ) {
+			LOG_CRITICAL << "Socket path is too long: " << path;
+			return false;
+		}
+		listenFd = socket( AF_UNIX, SOCK_STREAM, 0 );
+		if ( listenFd < 0 ) {
+			return false;
+		}
+		addr.sun_family = AF_UNIX;
+		path.copy( addr.sun_path, path.size() );
+		unlink( path.c_str() );
+		if ( bind( listenFd, (sockaddr *)&addr, sizeof( addr ) ) != 0 || listen( listenFd, 1 ) != 0 ) {
+			LOG_CRITICAL << "Can not listen on " << path;
+			return false;
+		}
+		return true;
+	}
+
+	bool ReadLine( std::string &line ) override
+	{
+		while ( true ) {
+			if ( clientFd < 0 && !Accept() ) {
+				return false;
+			}
+			const auto pos = pending.find( '\n' );
+			if ( pos != std::string::npos ) {
+				line = pending.substr( 0, pos );
+				pending.erase( 0, pos + 1 );
+				return true;
+			}
+			char buf[ 4096 ];
+			const auto n = read( clientFd, buf, sizeof( buf ) );
+			if ( n <= 0 ) {
+				// client hung up, the last incomplete line is still a job
+				Hangup();
+				if ( !pending.empty() ) {
+					line.swap( pending );
+					pending.clear();
+					return true;
+				}
+				continue;
+			}
+			pending.append( buf, n );
+		}
+	}
+
+	size_t Client() const override { return client; }
+
+	void ReplyTo( size_t client, const std::string &line ) override
+	{
+		std::lock_guard<std::mutex> lk( mutex );
+		// the job's client hung up, its fd may belong to the next client already
+		if ( clientFd < 0 || client != this->client ) return;
+		const auto msg = line + "\n";
+		size_t written = 0;
+		while ( written < msg.size() ) {
+			// a reply to a departed client must not raise SIGPIPE
+			const auto n = send( clientFd, msg.data() + written, msg.size() - written, MSG_NOSIGNAL );
+			if ( n < 0 && errno == EINTR ) continue;
+			if ( n <= 0 ) {
+				// the client is gone, wake the reading thread so it hangs up and accepts the next one
+				shutdown( clientFd, SHUT_RDWR );
+				return;
+			}
+			written += n;
+		}
+	}
+
+	~LocalSocketJobChannel()
+	{
+		if ( clientFd >= 0 ) close( clientFd );
+		if ( listenFd >= 0 ) {
+			close( listenFd );
+			unlink( path.c_str() );
+		}
+	}
+};
+#endif
+
+}  // namespace
+
+bool ParseRenderJob( const std::string &line, RenderJob &job, std::string &error )
+{
+	job = RenderJob{};
+	std::istringstream ss( line );
+	std::string token;
+	while ( ss >> token ) {
+		if ( token[ 0 ] == '#' ) break;
+		if ( token == "quit" ) {
+			job.Quit = true;
+			continue;
+		}
+		const auto eq = token.find( '=' );
+		if ( eq == std::string::npos ) {
+			error = "expected key=value: " + token;
+			return false;
+		}
+		const auto key = token.substr( 0, eq );
+		const auto value = token.substr( eq + 1 );
+		try {
+			if ( key == "cam" ) {
+				job.CameraFileName = value;
+			} else if ( key == "tf" ) {
+				job.TFName = value;
+			} else if ( key == "out" ) {
+				job.OutputFileName = value;
+			} else if ( key == "width" ) {
+				job.FilmSize.x = std::stoi( value );
+			} else if ( key == "height" ) {
+				job.FilmSize.y = std::stoi( value );
+			} else {
+				error = "unknown key: " + key;
+				return false;
+			}
+		} catch ( std::exception & ) {
+			error = "bad value for " + key + ": " + value;
+			return false;
+		}
+	}
+	if ( job.FilmSize.x < 0 || job.FilmSize.y < 0 ) {
+		error = "negative film size";
+		return false;
+	}
+	return true;
+}
+
+std::unique_ptr<IRenderJobChannel> OpenRenderJobChannel( const std::string &endpoint )
+{
+	if ( endpoint == "-" ) {
+		return std::make_unique<StdinJobChannel>();
+	}
+#ifndef _WIN32
+	auto channel = std::make_unique<LocalSocketJobChannel>( endpoint );
+	if ( channel->Listen() ) {
+		return channel;
+	}
+#else
+	LOG_CRITICAL << "Local socket job channel is not supported on this platform";
+#endif
+	return nullptr;
+}
+
+}  // namespace vm
@@ -0,0 +1,65 @@
+#include <residentblocks.h>
+#include <VMFoundation/logger.h>
+#include <algorithm>
+#include <cstdint>
+
+#ifndef _WIN32
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+namespace vm
+{
+ResidentBlockTable::ResidentBlockTable( const PageGetter &getPage, size_t blockCount, size_t blockBytes, bool populate, bool lock )
+{
+	blocks.resize( blockCount );
+	const char *lo = nullptr, *hi = nullptr;
+	for ( size_t i = 0; i < blockCount; i++ ) {
+		const auto p = (const char *)getPage( i );
+		blocks[ i ] = p;
+		if ( p == nullptr ) {
+			valid = false;
+			return;
+		}
+		lo = lo ? ( std::min )( lo, p ) : p;
+		hi = hi ? ( std::max )( hi, p + blockBytes ) : p + blockBytes;
+	}
+	if ( blockCount == 0 ) {
+		return;
+	}
+#ifndef _WIN32
+	// the pages of a mapping are aligned, the blocks behind the file header are not
+	const auto pageSize = uintptr_t( sysconf( _SC_PAGESIZE ) );
+	rangeBegin = (const char *)( uintptr_t( lo ) / pageSize * pageSize );
+	rangeBytes = hi - rangeBegin;
+	if ( populate ) {
+		int ret = -1;
+#ifdef MADV_POPULATE_READ
+		ret = madvise( (void *)rangeBegin, rangeBytes, MADV_POPULATE_READ );
+#endif
+		if ( ret != 0 ) {
+			madvise( (void *)rangeBegin, rangeBytes, MADV_WILLNEED );
+		}
+	}
+	if ( lock ) {
+		locked = mlock( rangeBegin, rangeBytes ) == 0;
+		if ( !locked ) {
+			LOG_CRITICAL << "Failed to lock " << rangeBytes << " bytes of volume data, see ulimit -l";
+		}
+	}
+#else
+	(void)populate;
+	(void)lock;
+#endif
+}
+
+ResidentBlockTable::~ResidentBlockTable()
+{
+#ifndef _WIN32
+	if ( locked ) {
+		munlock( rangeBegin, rangeBytes );
+	}
+#endif
+}
+
+}  // namespace vm
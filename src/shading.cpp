@@ -0,0 +1,266 @@
+#include <shading.h>
+#include <VMUtils/timer.hpp>
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <random>
+
+#if defined( __SSE2__ ) || defined( _M_X64 )
+#include <emmintrin.h>
+#define VM_GRADIENT_SSE2
+#endif
+
+namespace vm
+{
+namespace
+{
+inline float Dot( const Vec3f &a, const Vec3f &b )
+{
+	return a.x * b.x + a.y * b.y + a.z * b.z;
+}
+
+inline bool Normalize( Vec3f &v )
+{
+	const auto len = std::sqrt( Dot( v, v ) );
+	if ( len < 1e-6f ) return false;
+	v = v / len;
+	return true;
+}
+
+inline int ClampIndex( int i, int side )
+{
+	return i < 0 ? 0 : ( i >= side ? side - 1 : i );
+}
+
+template <typename T>
+inline float Fetch( const T *data, int side, int x, int y, int z )
+{
+	return data[ ( size_t( ClampIndex( z, side ) ) * side + ClampIndex( y, side ) ) * side + ClampIndex( x, side ) ];
+}
+
+template <typename T>
+float Trilinear( const T *data, int side, float x, float y, float z )
+{
+	const int x0 = std::floor( x ), y0 = std::floor( y ), z0 = std::floor( z );
+	const float dx = x - x0, dy = y - y0, dz = z - z0;
+	const auto c00 = Lerp( dx, Fetch( data, side, x0, y0, z0 ), Fetch( data, side, x0 + 1, y0, z0 ) );
+	const auto c10 = Lerp( dx, Fetch( data, side, x0, y0 + 1, z0 ), Fetch( data, side, x0 + 1, y0 + 1, z0 ) );
+	const auto c01 = Lerp( dx, Fetch( data, side, x0, y0, z0 + 1 ), Fetch( data, side, x0 + 1, y0, z0 + 1 ) );
+	const auto c11 = Lerp( dx, Fetch( data, side, x0, y0 + 1, z0 + 1 ), Fetch( data, side, x0 + 1, y0 + 1, z0 + 1 ) );
+	return Lerp( dz, Lerp( dy, c00, c10 ), Lerp( dy, c01, c11 ) );
+}
+
+inline int8_t HalfDifference( unsigned char a, unsigned char b )
+{
+	return int8_t( ( int( a ) - int( b ) ) >> 1 );
+}
+
+#ifdef VM_GRADIENT_SSE2
+/**
+ * @brief (a - b) >> 1 of 16 unsigned bytes as signed bytes
+ */
+inline __m128i HalfDifference16( const unsigned char *a, const unsigned char *b )
+{
+	const __m128i zero = _mm_setzero_si128();
+	const __m128i va = _mm_loadu_si128( (const __m128i *)a );
+	const __m128i vb = _mm_loadu_si128( (const __m128i *)b );
+	const __m128i lo = _mm_srai_epi16( _mm_sub_epi16( _mm_unpacklo_epi8( va, zero ), _mm_unpacklo_epi8( vb, zero ) ), 1 );
+	const __m128i hi = _mm_srai_epi16( _mm_sub_epi16( _mm_unpackhi_epi8( va, zero ), _mm_unpackhi_epi8( vb, zero ) ), 1 );
+	return _mm_packs_epi16( lo, hi );
+}
+#endif
+}  // namespace
+
+ShadingModel ShadingModelFromName( const std::string &name )
+{
+	if ( name == "phong" ) return ShadingModel::Phong;
+	if ( name == "blinn" ) return ShadingModel::BlinnPhong;
+	return ShadingModel::None;
+}
+
+Vec3f Shade( ShadingModel model, const ShadingParams &params, const Vec3f &diffuse,
+			 const Vec3f &gradient, const Vec3f &L, const Vec3f &V )
+{
+	Vec3f N = -gradient, l = L, v = V;
+	if ( model == ShadingModel::None || !Normalize( N ) || !Normalize( l ) || !Normalize( v ) ) {
+		return diffuse;
+	}
+	// two-sided lighting, boundaries are lit from whichever side they are seen
+	if ( Dot( N, v ) < 0 ) N = -N;
+	const auto NdotL = ( std::max )( Dot( N, l ), 0.f );
+	float specular = 0;
+	if ( model == ShadingModel::Phong ) {
+		const auto R = N * ( 2 * Dot( N, l ) ) - l;
+		specular = std::pow( ( std::max )( Dot( R, v ), 0.f ), params.shininess );
+	} else {
+		auto H = l + v;
+		if ( Normalize( H ) ) specular = std::pow( ( std::max )( Dot( N, H ), 0.f ), params.shininess );
+	}
+	return diffuse * ( params.ka + params.kd * NdotL ) + Vec3f( params.ks * specular );
+}
+
+Vec3f EstimateGradient( const unsigned char *block, int side, const Point3f &sp )
+{
+	const float x = sp.x, y = sp.y, z = sp.z;
+	return Vec3f(
+	  ( Trilinear( block, side, x + 1, y, z ) - Trilinear( block, side, x - 1, y, z ) ) * 0.5f,
+	  ( Trilinear( block, side, x, y + 1, z ) - Trilinear( block, side, x, y - 1, z ) ) * 0.5f,
+	  ( Trilinear( block, side, x, y, z + 1 ) - Trilinear( block, side, x, y, z - 1 ) ) * 0.5f );
+}
+
+void ComputeGradientPage( const unsigned char *block, int side, int8_t *gradientPage )
+{
+	const size_t plane = size_t( side ) * side * side;
+	int8_t *gx = gradientPage, *gy = gradientPage + plane, *gz = gradientPage + 2 * plane;
+	auto Row = [ block, side ]( int y, int z ) {
+		return block + ( size_t( ClampIndex( z, side ) ) * side + ClampIndex( y, side ) ) * side;
+	};
+	for ( int z = 0; z < side; z++ ) {
+		for ( int y = 0; y < side; y++ ) {
+			const size_t offset = ( size_t( z ) * side + y ) * side;
+			const auto r = block + offset;
+			const auto ym = Row( y - 1, z ), yp = Row( y + 1, z );
+			const auto zm = Row( y, z - 1 ), zp = Row( y, z + 1 );
+			int x = 0;
+#ifdef VM_GRADIENT_SSE2
+			for ( ; x + 16 <= side; x += 16 ) {
+				_mm_storeu_si128( (__m128i *)( gy + offset + x ), HalfDifference16( yp + x, ym + x ) );
+				_mm_storeu_si128( (__m128i *)( gz + offset + x ), HalfDifference16( zp + x, zm + x ) );
+			}
+#endif
+			for ( ; x < side; x++ ) {
+				gy[ offset + x ] = HalfDifference( yp[ x ], ym[ x ] );
+				gz[ offset + x ] = HalfDifference( zp[ x ], zm[ x ] );
+			}
+
+			// x neighbors leave the row at both ends
+			x = 1;
+#ifdef VM_GRADIENT_SSE2
+			for ( ; x + 17 <= side; x += 16 ) {
+				_mm_storeu_si128( (__m128i *)( gx + offset + x ), HalfDifference16( r + x + 1, r + x - 1 ) );
+			}
+#endif
+			for ( ; x < side - 1; x++ ) {
+				gx[ offset + x ] = HalfDifference( r[ x + 1 ], r[ x - 1 ] );
+			}
+			gx[ offset ] = HalfDifference( r[ ClampIndex( 1, side ) ], r[ 0 ] );
+			gx[ offset + side - 1 ] = HalfDifference( r[ side - 1 ], r[ ClampIndex( side - 2, side ) ] );
+		}
+	}
+}
+
+Vec3f SampleGradientPage( const int8_t *gradientPage, int side, const Point3f &sp )
+{
+	const size_t plane = size_t( side ) * side * side;
+	return Vec3f( Trilinear( gradientPage, side, sp.x, sp.y, sp.z ),
+				  Trilinear( gradientPage + plane, side, sp.x, sp.y, sp.z ),
+				  Trilinear( gradientPage + 2 * plane, side, sp.x, sp.y, sp.z ) );
+}
+
+std::string GradientSidecarFileName( const std::string &fileName )
+{
+	const auto dot = fileName.find_last_of( '.' );
+	const auto slash = fileName.find_last_of( "/\\" );
+	if ( dot == std::string::npos || ( slash != std::string::npos && dot < slash ) ) {
+		return fileName + ".grad.lvd";
+	}
+	return fileName.substr( 0, dot ) + ".grad.lvd";
+}
+
+void ToggleGradientBias( const void *src, void *dst, size_t bytes )
+{
+	auto s = (const unsigned char *)src;
+	auto d = (unsigned char *)dst;
+	size_t i = 0;
+#ifdef VM_GRADIENT_SSE2
+	const __m128i bias = _mm_set1_epi8( char( 0x80 ) );
+	for ( ; i + 16 <= bytes; i += 16 ) {
+		_mm_storeu_si128( (__m128i *)( d + i ), _mm_xor_si128( _mm_loadu_si128( (const __m128i *)( s + i ) ), bias ) );
+	}
+#endif
+	for ( ; i < bytes; i++ ) {
+		d[ i ] = s[ i ] ^ 0x80;
+	}
+}
+
+GradientCache::GradientCache( int blockSide, size_t capacityInPages ) :
+  side( blockSide ),
+  capacity( ( std::max )( capacityInPages, size_t( 1 ) ) ),
+  pool( capacity * GradientPageBytes( blockSide ) )
+{
+}
+
+const int8_t *GradientCache::GetPage( size_t blockID, const unsigned char *block )
+{
+	const auto pageBytes = GradientPageBytes( side );
+	auto it = index.find( blockID );
+	if ( it != index.end() ) {
+		hits++;
+		lru.splice( lru.begin(), lru, it->second );
+		return pool.data() + it->second->second * pageBytes;
+	}
+	misses++;
+	size_t slot = lru.size();
+	if ( lru.size() == capacity ) {
+		slot = lru.back().second;
+		index.erase( lru.back().first );
+		lru.pop_back();
+	}
+	lru.emplace_front( blockID, slot );
+	index[ blockID ] = lru.begin();
+	const auto page = pool.data() + slot * pageBytes;
+	if ( !loader || !loader( blockID, page ) ) {
+		ComputeGradientPage( block, side, page );
+	}
+	return page;
+}
+
+void GradientCache::Clear()
+{
+	lru.clear();
+	index.clear();
+	hits = misses = 0;
+}
+
+double GradientCostModel::BreakEvenSamplesPerPage( int side ) const
+{
+	const auto saved = otfPerSample - cachedPerSample;
+	if ( saved <= 0 ) {
+		return std::numeric_limits<double>::infinity();
+	}
+	return precomputePerVoxel * side * side * side / saved;
+}
+
+GradientCostModel MeasureGradientCostModel( int side, int samples )
+{
+	const size_t voxels = size_t( side ) * side * side;
+	std::default_random_engine e;
+	std::uniform_int_distribution<int> value( 0, 255 );
+	std::uniform_real_distribution<float> pos( 0.f, float( side - 1 ) );
+	std::vector<unsigned char> block( voxels );
+	for ( auto &v : block ) v = value( e );
+	std::vector<Point3f> points( samples );
+	for ( auto &p : points ) p = Point3f( pos( e ), pos( e ), pos( e ) );
+	std::vector<int8_t> page( GradientPageBytes( side ) );
+
+	GradientCostModel model;
+	Timer timer;
+	timer.start();
+	volatile float sink = 0;
+
+	auto begin = timer.elapsed().s();
+	for ( const auto &p : points ) sink = sink + EstimateGradient( block.data(), side, p ).x;
+	model.otfPerSample = ( timer.elapsed().s() - begin ) / samples;
+
+	constexpr int repeat = 4;
+	begin = timer.elapsed().s();
+	for ( int i = 0; i < repeat; i++ ) ComputeGradientPage( block.data(), side, page.data() );
+	model.precomputePerVoxel = ( timer.elapsed().s() - begin ) / ( repeat * voxels );
+
+	begin = timer.elapsed().s();
+	for ( const auto &p : points ) sink = sink + SampleGradientPage( page.data(), side, p ).x;
+	model.cachedPerSample = ( timer.elapsed().s() - begin ) / samples;
+	return model;
+}
+
+}  // namespace vm
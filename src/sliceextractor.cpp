@@ -0,0 +1,238 @@
+#include <sliceextractor.h>
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstring>
+#include <mutex>
+#include <thread>
+
+#if defined( __SSE2__ ) || defined( _M_X64 )
+#include <emmintrin.h>
+#define VM_SLICE_SSE2
+#endif
+
+namespace vm
+{
+namespace
+{
+inline float Voxel( const uint8_t *page, int side, int x, int y, int z )
+{
+	// the neighbours past the upper faces are not in this page, repeating the edge keeps the block seams closed
+	x = ( std::min )( x, side - 1 );
+	y = ( std::min )( y, side - 1 );
+	z = ( std::min )( z, side - 1 );
+	return page[ ( size_t( z ) * side + y ) * side + x ];
+}
+
+inline float Mix( float t, float a, float b )
+{
+	return a + ( b - a ) * t;
+}
+
+/**
+ * @brief Interpolates the page at ( x, y, z ), all non-negative
+ */
+float Trilinear( const uint8_t *page, int side, float x, float y, float z )
+{
+	const int ix = int( x ), iy = int( y ), iz = int( z );
+	const float fx = x - ix, fy = y - iy, fz = z - iz;
+	const float c00 = Mix( fx, Voxel( page, side, ix, iy, iz ), Voxel( page, side, ix + 1, iy, iz ) );
+	const float c10 = Mix( fx, Voxel( page, side, ix, iy + 1, iz ), Voxel( page, side, ix + 1, iy + 1, iz ) );
+	const float c01 = Mix( fx, Voxel( page, side, ix, iy, iz + 1 ), Voxel( page, side, ix + 1, iy, iz + 1 ) );
+	const float c11 = Mix( fx, Voxel( page, side, ix, iy + 1, iz + 1 ), Voxel( page, side, ix + 1, iy + 1, iz + 1 ) );
+	return Mix( fz, Mix( fy, c00, c10 ), Mix( fy, c01, c11 ) );
+}
+
+#ifdef VM_SLICE_SSE2
+inline __m128 Mix4( __m128 t, __m128 a, __m128 b )
+{
+	return _mm_add_ps( a, _mm_mul_ps( _mm_sub_ps( b, a ), t ) );
+}
+#endif
+
+inline bool Integral( float v )
+{
+	return v == std::floor( v );
+}
+}  // namespace
+
+SlicePlane AxisAlignedSlice( int axis, float position, const Vec3i &size )
+{
+	SlicePlane plane;
+	plane.origin = Point3f( 0, 0, 0 );
+	plane.u = Vec3f( 0, 0, 0 );
+	plane.v = Vec3f( 0, 0, 0 );
+	const int across = axis == 0 ? 1 : 0;
+	const int down = axis == 2 ? 1 : 2;
+	plane.origin[ axis ] = position;
+	plane.u[ across ] = 1;
+	plane.v[ down ] = 1;
+	plane.width = size[ across ];
+	plane.height = size[ down ];
+	return plane;
+}
+
+SlicePlane ObliqueSlice( const Point3f &center, const Vec3f &right, const Vec3f &up, int width, int height, float spacing )
+{
+	SlicePlane plane;
+	plane.u = right.Normalized() * spacing;
+	plane.v = up.Normalized() * -spacing;
+	plane.origin = center - plane.u * ( width / 2.f ) - plane.v * ( height / 2.f );
+	plane.width = width;
+	plane.height = height;
+	return plane;
+}
+
+SliceExtractor::SliceExtractor( const BlockFetcher &fetchBlock, const Vec3i &gridCount, int blockSide, int threadCount ) :
+  fetchBlock( fetchBlock ),
+  gridCount( gridCount ),
+  blockSide( blockSide ),
+  threadCount( ( std::max )( threadCount, 1 ) )
+{
+}
+
+void SliceExtractor::CollectRuns( const SlicePlane &plane )
+{
+	runs.clear();
+	const float o[] = { plane.origin.x, plane.origin.y, plane.origin.z };
+	const float u[] = { plane.u.x, plane.u.y, plane.u.z };
+	const float v[] = { plane.v.x, plane.v.y, plane.v.z };
+	const int count[] = { gridCount.x, gridCount.y, gridCount.z };
+	constexpr size_t None = ~size_t( 0 );
+	for ( int y = 0; y < plane.height; y++ ) {
+		const float row[] = { o[ 0 ] + v[ 0 ] * y, o[ 1 ] + v[ 1 ] * y, o[ 2 ] + v[ 2 ] * y };
+		size_t current = None;
+		for ( int x = 0; x < plane.width; x++ ) {
+			size_t block = 0;
+			for ( int a = 2; a >= 0; a-- ) {
+				const float p = std::floor( row[ a ] + u[ a ] * x );
+				const int c = p < 0 ? -1 : int( p ) / blockSide;
+				if ( c < 0 || c >= count[ a ] ) {
+					block = None;
+					break;
+				}
+				block = block * count[ a ] + c;
+			}
+			if ( block != current ) {
+				if ( current != None ) {
+					runs.back().x1 = x;
+				}
+				if ( block != None ) {
+					runs.push_back( Run{ block, y, x, plane.width } );
+				}
+				current = block;
+			}
+		}
+	}
+	// a row enters a convex block once, the runs of a block are its pixels
+	std::stable_sort( runs.begin(), runs.end(), []( const Run &a, const Run &b ) { return a.block < b.block; } );
+}
+
+void SliceExtractor::Resample( const SlicePlane &plane, const uint8_t *page, const Run &run, bool onVoxels, uint8_t *slice ) const
+{
+	const size_t gx = gridCount.x, gy = gridCount.y;
+	const float base[] = { float( run.block % gx * blockSide ), float( run.block / gx % gy * blockSide ), float( run.block / ( gx * gy ) * blockSide ) };
+	const float u[] = { plane.u.x, plane.u.y, plane.u.z };
+	const float row[] = { plane.origin.x + plane.v.x * run.y, plane.origin.y + plane.v.y * run.y, plane.origin.z + plane.v.z * run.y };
+	const int side = blockSide;
+	auto out = slice + size_t( run.y ) * plane.width;
+	int x = run.x0;
+	if ( onVoxels ) {
+		auto Offset = [ & ]( int x ) {
+			const int ix = int( row[ 0 ] + u[ 0 ] * x - base[ 0 ] );
+			const int iy = int( row[ 1 ] + u[ 1 ] * x - base[ 1 ] );
+			const int iz = int( row[ 2 ] + u[ 2 ] * x - base[ 2 ] );
+			return ( size_t( iz ) * side + iy ) * side + ix;
+		};
+		if ( u[ 0 ] == 1 && u[ 1 ] == 0 && u[ 2 ] == 0 ) {
+			memcpy( out + x, page + Offset( x ), run.x1 - x );
+			return;
+		}
+		for ( ; x < run.x1; x++ ) {
+			out[ x ] = page[ Offset( x ) ];
+		}
+		return;
+	}
+#ifdef VM_SLICE_SSE2
+	for ( ; x + 4 <= run.x1; x += 4 ) {
+		const __m128 xs = _mm_cvtepi32_ps( _mm_setr_epi32( x, x + 1, x + 2, x + 3 ) );
+		alignas( 16 ) int32_t i[ 3 ][ 4 ];
+		__m128 f[ 3 ];
+		for ( int a = 0; a < 3; a++ ) {
+			// the sums of the scalar path, the blocks of the runs agree to the last bit
+			const __m128 p = _mm_sub_ps( _mm_add_ps( _mm_set1_ps( row[ a ] ), _mm_mul_ps( _mm_set1_ps( u[ a ] ), xs ) ), _mm_set1_ps( base[ a ] ) );
+			const __m128i ip = _mm_cvttps_epi32( p );
+			_mm_store_si128( (__m128i *)i[ a ], ip );
+			f[ a ] = _mm_sub_ps( p, _mm_cvtepi32_ps( ip ) );
+		}
+		alignas( 16 ) float c[ 8 ][ 4 ];
+		for ( int lane = 0; lane < 4; lane++ ) {
+			for ( int k = 0; k < 8; k++ ) {
+				c[ k ][ lane ] = Voxel( page, side, i[ 0 ][ lane ] + ( k & 1 ), i[ 1 ][ lane ] + ( k >> 1 & 1 ), i[ 2 ][ lane ] + ( k >> 2 ) );
+			}
+		}
+		const __m128 c00 = Mix4( f[ 0 ], _mm_load_ps( c[ 0 ] ), _mm_load_ps( c[ 1 ] ) );
+		const __m128 c10 = Mix4( f[ 0 ], _mm_load_ps( c[ 2 ] ), _mm_load_ps( c[ 3 ] ) );
+		const __m128 c01 = Mix4( f[ 0 ], _mm_load_ps( c[ 4 ] ), _mm_load_ps( c[ 5 ] ) );
+		const __m128 c11 = Mix4( f[ 0 ], _mm_load_ps( c[ 6 ] ), _mm_load_ps( c[ 7 ] ) );
+		const __m128 value = Mix4( f[ 2 ], Mix4( f[ 1 ], c00, c10 ), Mix4( f[ 1 ], c01, c11 ) );
+		const __m128i rounded = _mm_cvttps_epi32( _mm_add_ps( value, _mm_set1_ps( 0.5f ) ) );
+		const __m128i bytes = _mm_packus_epi16( _mm_packs_epi32( rounded, rounded ), _mm_setzero_si128() );
+		const int32_t packed = _mm_cvtsi128_si32( bytes );
+		memcpy( out + x, &packed, 4 );
+	}
+#endif
+	for ( ; x < run.x1; x++ ) {
+		const float value = Trilinear( page, side, row[ 0 ] + u[ 0 ] * x - base[ 0 ], row[ 1 ] + u[ 1 ] * x - base[ 1 ], row[ 2 ] + u[ 2 ] * x - base[ 2 ] );
+		out[ x ] = uint8_t( value + 0.5f );
+	}
+}
+
+void SliceExtractor::Extract( const SlicePlane &plane, uint8_t *slice )
+{
+	memset( slice, 0, size_t( plane.width ) * plane.height );
+	CollectRuns( plane );
+	std::vector<size_t> firstRun;
+	for ( size_t i = 0; i < runs.size(); i++ ) {
+		if ( i == 0 || runs[ i ].block != runs[ i - 1 ].block ) {
+			firstRun.push_back( i );
+		}
+	}
+	fetched = firstRun.size();
+	firstRun.push_back( runs.size() );
+
+	const bool onVoxels = Integral( plane.origin.x ) && Integral( plane.origin.y ) && Integral( plane.origin.z ) &&
+						  Integral( plane.u.x ) && Integral( plane.u.y ) && Integral( plane.u.z ) &&
+						  Integral( plane.v.x ) && Integral( plane.v.y ) && Integral( plane.v.z );
+	std::atomic<size_t> next{ 0 };
+	std::mutex fetchMutex;
+	// runs of different blocks cover different pixels
+	const size_t pageBytes = size_t( blockSide ) * blockSide * blockSide;
+	auto Work = [ & ]() {
+		// the fetched page may be evicted by the next fetch, the worker resamples its own copy
+		std::vector<uint8_t> page( pageBytes );
+		for ( size_t b = next++; b + 1 < firstRun.size(); b = next++ ) {
+			{
+				std::lock_guard<std::mutex> lk( fetchMutex );
+				const auto src = fetchBlock( runs[ firstRun[ b ] ].block );
+				if ( src == nullptr ) {
+					continue;
+				}
+				memcpy( page.data(), src, pageBytes );
+			}
+			for ( size_t r = firstRun[ b ]; r < firstRun[ b + 1 ]; r++ ) {
+				Resample( plane, page.data(), runs[ r ], onVoxels, slice );
+			}
+		}
+	};
+	std::vector<std::thread> threads;
+	for ( int i = 1; i < ( std::min )( threadCount, int( fetched ) ); i++ ) {
+		threads.emplace_back( Work );
+	}
+	Work();
+	for ( auto &t : threads ) {
+		t.join();
+	}
+}
+
+}  // namespace vm
@@ -0,0 +1,49 @@
+#include <timeseries.h>
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+#include <stdexcept>
+
+namespace vm
+{
+std::vector<std::string> LoadTimeSeries( const std::string &fileName, float &fps, std::string &outputPattern )
+{
+	std::ifstream in( fileName );
+	if ( !in.is_open() ) {
+		throw std::runtime_error( "can not open time series file: " + fileName );
+	}
+	TimeSeriesJSONStruct json;
+	in >> json;
+	if ( json.fileNames.empty() ) {
+		throw std::runtime_error( "time series has no timesteps: " + fileName );
+	}
+	fps = json.fps > 0 ? json.fps : 10;
+	outputPattern = json.output.empty() ? "timestep_{}.png" : json.output;
+	return json.fileNames;
+}
+
+FrameRateController::FrameRateController( double targetSeconds, float baseStep, float maxStepScale ) :
+  targetSeconds( targetSeconds ),
+  baseStep( baseStep ),
+  maxStep( baseStep * ( std::max )( maxStepScale, 1.f ) ),
+  step( baseStep )
+{
+}
+
+size_t FrameRateController::Update( double frameSeconds )
+{
+	const bool coarsest = step >= maxStep;
+	const float fitting = step * float( frameSeconds / ( 0.9 * targetSeconds ) );
+	if ( fitting > step ) {
+		step = fitting;
+	} else {
+		step = step + ( fitting - step ) * 0.5f;
+	}
+	step = ( std::min )( ( std::max )( step, baseStep ), maxStep );
+	if ( coarsest && frameSeconds > targetSeconds ) {
+		return size_t( std::floor( frameSeconds / targetSeconds ) );
+	}
+	return 1;
+}
+
+}  // namespace vm
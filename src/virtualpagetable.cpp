@@ -0,0 +1,165 @@
+#include <virtualpagetable.h>
+#include <algorithm>
+#include <cstring>
+
+namespace vm
+{
+namespace
+{
+enum : uint8_t
+{
+	NotReferenced = 0,
+	Referenced = 1,
+	Pinned = 2	// mapped by the running refine
+};
+}  // namespace
+
+VirtualPageTable::VirtualPageTable( size_t blockCount, size_t pageBytes, size_t physicalPageCount ) :
+  pageBytes( pageBytes ),
+  physicalPageCount( ( std::max )( ( std::min )( physicalPageCount, blockCount ), size_t( 1 ) ) ),
+  blockCount( blockCount )
+{
+	pool.reset( new unsigned char[ this->physicalPageCount * pageBytes ] );
+	entries.reset( new std::atomic<uint32_t>[ blockCount ] );
+	hash.reset( new std::atomic<uint8_t>[ blockCount ] );
+	missedBlockIDs.reset( new uint32_t[ blockCount ] );
+	referenced.reset( new std::atomic<uint8_t>[ this->physicalPageCount ] );
+	owners.resize( this->physicalPageCount );
+	listed.resize( this->physicalPageCount );
+	Clear();
+}
+
+const void *VirtualPageTable::Lookup( size_t blockID )
+{
+	const auto page = entries[ blockID ].load( std::memory_order_relaxed );
+	if ( page != Unmapped ) {
+		if ( referenced[ page ].load( std::memory_order_relaxed ) == NotReferenced ) {
+			referenced[ page ].store( Referenced, std::memory_order_relaxed );
+		}
+		return pool.get() + page * pageBytes;
+	}
+	uint8_t expected = 0;
+	if ( hash[ blockID ].compare_exchange_strong( expected, 1 ) ) {
+		missedBlockIDs[ missedCount.fetch_add( 1 ) ] = blockID;
+	}
+	return nullptr;
+}
+
+size_t VirtualPageTable::Refine( const BlockLoader &loader )
+{
+	return RefineBatch( [ this, &loader ]( std::vector<std::pair<size_t, void *>> requests ) {
+		for ( const auto &r : requests ) {
+			if ( !loader( r.first, r.second ) ) {
+				// an unreadable block is rendered as empty rather than missed forever
+				memset( r.second, 0, pageBytes );
+			}
+		}
+	} );
+}
+
+size_t VirtualPageTable::RefineBatch( const BatchLoader &loader )
+{
+	const size_t count = missedCount.load();
+	auto FindVictim = [ this ]() -> size_t {
+		// demoted pages nobody looked up since go first
+		while ( demoted.empty() == false ) {
+			const auto d = demoted.back();
+			demoted.pop_back();
+			listed[ d.first ] = false;
+			if ( owners[ d.first ] == d.second && referenced[ d.first ].load( std::memory_order_relaxed ) == NotReferenced ) {
+				return d.first;
+			}
+		}
+		// every page is passed at most twice, the second time with its reference bit cleared
+		for ( size_t i = 0; i <= 2 * physicalPageCount; i++ ) {
+			const auto page = clockHand;
+			clockHand = ( clockHand + 1 ) % physicalPageCount;
+			if ( owners[ page ] == Unmapped ) {
+				return page;
+			}
+			const auto r = referenced[ page ].load( std::memory_order_relaxed );
+			if ( r == Pinned ) {
+				continue;
+			}
+			if ( r == Referenced ) {
+				referenced[ page ].store( NotReferenced, std::memory_order_relaxed );
+				continue;
+			}
+			return page;
+		}
+		return Unmapped;
+	};
+
+	size_t loaded = 0;
+	std::vector<std::pair<size_t, void *>> requests;
+	for ( size_t i = 0; i < count; i++ ) {
+		const auto blockID = missedBlockIDs[ i ];
+		hash[ blockID ].store( 0, std::memory_order_relaxed );
+		if ( entries[ blockID ].load( std::memory_order_relaxed ) != Unmapped ) {
+			continue;
+		}
+		const auto page = loaded < physicalPageCount ? FindVictim() : size_t( Unmapped );
+		if ( page == Unmapped ) {
+			// the pool is full of this batch, the rest is missed again in the next pass
+			continue;
+		}
+		if ( owners[ page ] != Unmapped ) {
+			entries[ owners[ page ] ].store( Unmapped, std::memory_order_relaxed );
+		}
+		requests.emplace_back( blockID, pool.get() + page * pageBytes );
+		owners[ page ] = blockID;
+		referenced[ page ].store( Pinned, std::memory_order_relaxed );
+		entries[ blockID ].store( page, std::memory_order_relaxed );
+		loaded++;
+	}
+	if ( requests.empty() == false ) {
+		loader( std::move( requests ) );
+	}
+	for ( size_t i = 0; i < physicalPageCount; i++ ) {
+		if ( referenced[ i ].load( std::memory_order_relaxed ) == Pinned ) {
+			referenced[ i ].store( Referenced, std::memory_order_relaxed );
+		}
+	}
+	missedCount.store( 0 );
+	loadedBlocks += loaded;
+	return loaded;
+}
+
+bool VirtualPageTable::Demote( size_t blockID )
+{
+	const auto page = entries[ blockID ].load( std::memory_order_relaxed );
+	if ( page == Unmapped ) {
+		return false;
+	}
+	referenced[ page ].store( NotReferenced, std::memory_order_relaxed );
+	// a page hidden frame after frame is listed once, the list stays within the pool size
+	if ( !listed[ page ] ) {
+		listed[ page ] = true;
+		demoted.emplace_back( page, uint32_t( blockID ) );
+	}
+	return true;
+}
+
+size_t VirtualPageTable::MissedBlockCount() const
+{
+	return missedCount.load();
+}
+
+void VirtualPageTable::Clear()
+{
+	for ( size_t i = 0; i < blockCount; i++ ) {
+		entries[ i ].store( Unmapped, std::memory_order_relaxed );
+		hash[ i ].store( 0, std::memory_order_relaxed );
+	}
+	for ( size_t i = 0; i < physicalPageCount; i++ ) {
+		owners[ i ] = Unmapped;
+		listed[ i ] = false;
+		referenced[ i ].store( NotReferenced, std::memory_order_relaxed );
+	}
+	missedCount.store( 0 );
+	demoted.clear();
+	clockHand = 0;
+	loadedBlocks = 0;
+}
+
+}  // namespace vm
@@ -0,0 +1,174 @@
+#include <VMUtils/timer.hpp>
+#include <VMUtils/vmnew.hpp>
+#include <lvddirectfileplugin.h>
+#include <lvdfileheader.h>
+#include <batchblockloader.h>
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+/**
+ * Compares reading the blocks of a .lvd file in random order through the memory mapping,
+ * with buffered pread, with O_DIRECT pread and with the sorted batch loader, each from a
+ * cold and a warm page cache.
+ *
+ * usage: blockio_perf [file.lvd] [threads] [blocks]
+ * Without a file a 512 MB volume of 64^3 blocks is written to blockio_perf.lvd first.
+ */
+
+#ifndef _WIN32
+namespace
+{
+std::string CreateTestFile()
+{
+	const char *fileName = "blockio_perf.lvd";
+	vm::LVDFileHeader header;
+	header.SetCurrentVersion();
+	header.blockLengthInLog = 6;
+	header.padding = 0;
+	for ( int i = 0; i < 3; i++ ) {
+		header.dataDim[ i ] = 512;
+		header.originalDataDim[ i ] = 512;
+	}
+	std::ofstream out( fileName, std::ios::binary );
+	out.write( (const char *)header.Encode(), header.HeaderSize() );
+	std::vector<char> block( 64 * 64 * 64 );
+	for ( int i = 0; i < 8 * 8 * 8; i++ ) {
+		std::fill( block.begin(), block.end(), char( i ) );
+		out.write( block.data(), block.size() );
+	}
+	out.close();
+	return fileName;
+}
+
+/**
+ * @brief Writes back and drops the cached pages of the file, so the next read comes from the disk
+ */
+void DropPageCache( const std::string &fileName )
+{
+	const int fd = open( fileName.c_str(), O_RDONLY );
+	if ( fd >= 0 ) {
+		fdatasync( fd );
+		posix_fadvise( fd, 0, 0, POSIX_FADV_DONTNEED );
+		close( fd );
+	}
+}
+
+/**
+ * @brief Runs \a read for every block id of \a order split over \a threadCount threads
+ */
+double Run( const std::vector<size_t> &order, int threadCount, const std::function<void( size_t, unsigned char * )> &read, size_t blockBytes )
+{
+	vm::Timer timer;
+	timer.start();
+	std::vector<std::thread> threads;
+	for ( int t = 0; t < threadCount; t++ ) {
+		threads.emplace_back( [ &, t ]() {
+			std::vector<unsigned char> page( blockBytes );
+			for ( size_t i = t; i < order.size(); i += threadCount ) {
+				read( order[ i ], page.data() );
+			}
+		} );
+	}
+	for ( auto &t : threads ) {
+		t.join();
+	}
+	return timer.elapsed().s();
+}
+}  // namespace
+#endif
+
+int main( int argc, char **argv )
+{
+#ifdef _WIN32
+	std::cout << "blockio_perf needs a POSIX system\n";
+	return 0;
+#else
+	using namespace vm;
+	const std::string fileName = argc > 1 ? argv[ 1 ] : CreateTestFile();
+	const int threadCount = argc > 2 ? std::stoi( argv[ 2 ] ) : 4;
+
+	Ref<LVDDirectFilePlugin> direct = VM_NEW<LVDDirectFilePlugin>();
+	Ref<LVDDirectFilePlugin> buffered = VM_NEW<LVDDirectFilePlugin>();
+	buffered->SetDirectIO( false );
+	direct->Open( fileName );
+	buffered->Open( fileName );
+	const size_t blockBytes = direct->GetPageSize();
+	const size_t blockCount = direct->GetVirtualPageCount();
+	const size_t count = argc > 3 ? ( std::min )( size_t( std::stoul( argv[ 3 ] ) ), blockCount ) : blockCount;
+	std::cout << fileName << ": " << blockCount << " blocks of " << blockBytes << " bytes, reading " << count
+			  << " in random order with " << threadCount << " threads, O_DIRECT " << ( direct->DirectIO() ? "on" : "unavailable" ) << "\n";
+
+	std::vector<size_t> order( blockCount );
+	for ( size_t i = 0; i < blockCount; i++ ) order[ i ] = i;
+	std::shuffle( order.begin(), order.end(), std::default_random_engine() );
+	order.resize( count );
+
+	LVDFileHeader header;
+	std::string error;
+	if ( !ReadLVDFileHeader( fileName, header, error ) ) {
+		std::cout << fileName << ": " << error << "\n";
+		return 1;
+	}
+	const size_t dataOffset = header.HeaderSize();
+
+	const int fd = open( fileName.c_str(), O_RDONLY );
+	struct stat st;
+	fstat( fd, &st );
+	const auto mapped = (const unsigned char *)mmap( nullptr, st.st_size, PROT_READ, MAP_SHARED, fd, 0 );
+
+	BatchBlockLoader batch( fileName, dataOffset, blockCount, blockBytes, threadCount );
+	BatchBlockLoader batchDirect( fileName, dataOffset, blockCount, blockBytes, threadCount, 8 * 1024 * 1024, true );
+	std::vector<unsigned char> pool( count * blockBytes );
+
+	struct Mode
+	{
+		const char *name;
+		std::function<double()> run;
+	};
+	const Mode modes[] = {
+		{ "mmap", [ & ]() { return Run(
+							  order, threadCount, [ & ]( size_t id, unsigned char *page ) { memcpy( page, mapped + dataOffset + id * blockBytes, blockBytes ); }, blockBytes ); } },
+		{ "pread", [ & ]() { return Run(
+							   order, threadCount, [ & ]( size_t id, unsigned char *page ) { buffered->ReadPage( id, page ); }, blockBytes ); } },
+		{ "pread O_DIRECT", [ & ]() { return Run(
+										order, threadCount, [ & ]( size_t id, unsigned char *page ) { direct->ReadPage( id, page ); }, blockBytes ); } },
+		{ "batch", [ & ]() {
+			 std::vector<BatchBlockLoader::Request> requests;
+			 for ( size_t i = 0; i < count; i++ ) requests.emplace_back( order[ i ], pool.data() + i * blockBytes );
+			 return batch.Load( requests ).seconds;
+		 } },
+		{ "batch O_DIRECT", [ & ]() {
+			 std::vector<BatchBlockLoader::Request> requests;
+			 for ( size_t i = 0; i < count; i++ ) requests.emplace_back( order[ i ], pool.data() + i * blockBytes );
+			 return batchDirect.Load( requests ).seconds;
+		 } }
+	};
+
+	const double mb = count * blockBytes / 1024.0 / 1024;
+	for ( const auto &mode : modes ) {
+		DropPageCache( fileName );
+		madvise( (void *)mapped, st.st_size, MADV_DONTNEED );
+		const auto cold = mode.run();
+		const auto warm = mode.run();
+		std::cout << mode.name << ": cold " << cold << "(s) " << mb / cold << " MB/s, warm " << warm << "(s) " << mb / warm << " MB/s\n";
+	}
+
+	munmap( (void *)mapped, st.st_size );
+	close( fd );
+	return 0;
+#endif
+}
@@ -0,0 +1,198 @@
+#include <VMUtils/timer.hpp>
+#include <lossyblockcodec.h>
+#include <lvdfileheader.h>
+#include <batchblockloader.h>
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+/**
+ * Compares swapping in the float blocks of an uncompressed .lvd file with reading and
+ * decoding the blocks of lossy compressed files at several error bounds, from a cold and a
+ * warm page cache. Prints the compression ratio, the largest error, the disk bytes saved
+ * and the decode time summed over the worker threads against the wall time of the batch.
+ *
+ * usage: codec_perf [threads] [file.raw x y z]
+ * The raw file holds x * y * z float32 values, z slowest. Without one a smooth 256^3
+ * volume with a noisy band is generated.
+ */
+
+#ifndef _WIN32
+namespace
+{
+constexpr int BlockSideInLog = 6;
+constexpr size_t Side = size_t( 1 ) << BlockSideInLog;
+
+struct Volume
+{
+	size_t x, y, z;
+	std::vector<float> data;
+	float At( size_t i, size_t j, size_t k ) const { return i < x && j < y && k < z ? data[ ( k * y + j ) * x + i ] : 0.f; }
+};
+
+Volume Generate()
+{
+	Volume v{ 256, 256, 256 };
+	v.data.resize( v.x * v.y * v.z );
+	std::default_random_engine rng;
+	std::normal_distribution<float> noise( 0.f, 0.05f );
+	size_t n = 0;
+	for ( size_t k = 0; k < v.z; k++ ) {
+		for ( size_t j = 0; j < v.y; j++ ) {
+			for ( size_t i = 0; i < v.x; i++ ) {
+				// an ABC flow like field, simulations are smooth with noisy regions
+				const float a = std::sin( 0.05f * k ) + std::cos( 0.04f * j );
+				const float b = std::sin( 0.03f * i ) + std::cos( 0.05f * k );
+				v.data[ n++ ] = std::sqrt( a * a + b * b ) + ( k > 192 ? noise( rng ) : 0.f );
+			}
+		}
+	}
+	return v;
+}
+
+Volume LoadRaw( const std::string &fileName, size_t x, size_t y, size_t z )
+{
+	Volume v{ x, y, z };
+	v.data.resize( x * y * z );
+	std::ifstream in( fileName, std::ios::binary );
+	in.read( (char *)v.data.data(), v.data.size() * sizeof( float ) );
+	if ( !in ) {
+		std::cout << "Failed to read " << x * y * z << " floats from " << fileName << "\n";
+		v.data.clear();
+	}
+	return v;
+}
+
+void GetBlock( const Volume &v, size_t bx, size_t by, size_t bz, std::vector<float> &block )
+{
+	size_t n = 0;
+	for ( size_t k = 0; k < Side; k++ ) {
+		for ( size_t j = 0; j < Side; j++ ) {
+			for ( size_t i = 0; i < Side; i++ ) {
+				block[ n++ ] = v.At( bx * Side + i, by * Side + j, bz * Side + k );
+			}
+		}
+	}
+}
+
+void DropPageCache( const std::string &fileName )
+{
+	const int fd = open( fileName.c_str(), O_RDONLY );
+	if ( fd >= 0 ) {
+		fdatasync( fd );
+		posix_fadvise( fd, 0, 0, POSIX_FADV_DONTNEED );
+		close( fd );
+	}
+}
+}  // namespace
+#endif
+
+int main( int argc, char **argv )
+{
+#ifdef _WIN32
+	std::cout << "codec_perf needs a POSIX system\n";
+	return 0;
+#else
+	using namespace vm;
+	const int threadCount = argc > 1 ? std::stoi( argv[ 1 ] ) : 4;
+	const auto volume = argc > 5 ? LoadRaw( argv[ 2 ], std::stoul( argv[ 3 ] ), std::stoul( argv[ 4 ] ), std::stoul( argv[ 5 ] ) ) : Generate();
+	if ( volume.data.empty() ) {
+		return 1;
+	}
+	const auto minmax = std::minmax_element( volume.data.begin(), volume.data.end() );
+	const float range = *minmax.second - *minmax.first;
+	const Size3 blockDim( ( volume.x + Side - 1 ) / Side, ( volume.y + Side - 1 ) / Side, ( volume.z + Side - 1 ) / Side );
+	const size_t blockCount = blockDim.Prod();
+	const size_t blockBytes = Side * Side * Side * sizeof( float );
+	std::vector<std::vector<float>> blocks( blockCount, std::vector<float>( Side * Side * Side ) );
+	for ( size_t i = 0; i < blockCount; i++ ) {
+		GetBlock( volume, i % blockDim.x, i / blockDim.x % blockDim.y, i / blockDim.x / blockDim.y, blocks[ i ] );
+	}
+	std::cout << volume.x << "x" << volume.y << "x" << volume.z << " floats, value range " << range << ", "
+			  << blockCount << " blocks of " << Side << "^3, " << threadCount << " threads\n";
+
+	// the uncompressed file is read by the batch loader as the page table does for 8 bit volumes
+	const std::string rawName = "codec_perf_raw.lvd";
+	LVDFileHeader header;
+	{
+		header.SetCurrentVersion();
+		header.voxelType = LVDFileHeader::Float32;
+		header.blockLengthInLog = BlockSideInLog;
+		header.dataDim[ 0 ] = uint32_t( blockDim.x * Side );
+		header.dataDim[ 1 ] = uint32_t( blockDim.y * Side );
+		header.dataDim[ 2 ] = uint32_t( blockDim.z * Side );
+		header.originalDataDim[ 0 ] = uint32_t( volume.x );
+		header.originalDataDim[ 1 ] = uint32_t( volume.y );
+		header.originalDataDim[ 2 ] = uint32_t( volume.z );
+		std::ofstream out( rawName, std::ios::binary );
+		out.write( (const char *)header.Encode(), header.HeaderSize() );
+		for ( const auto &b : blocks ) {
+			out.write( (const char *)b.data(), blockBytes );
+		}
+	}
+	std::vector<float> pool( blockCount * Side * Side * Side );
+	std::vector<BatchBlockLoader::Request> requests;
+	for ( size_t i = 0; i < blockCount; i++ ) {
+		requests.emplace_back( i, pool.data() + i * Side * Side * Side );
+	}
+	const double mb = blockCount * blockBytes / 1024.0 / 1024;
+	{
+		BatchBlockLoader loader( rawName, header.HeaderSize(), blockCount, blockBytes, threadCount );
+		DropPageCache( rawName );
+		const auto cold = loader.Load( requests ).seconds;
+		const auto warm = loader.Load( requests ).seconds;
+		std::cout << "uncompressed: " << mb << " MB read, cold " << cold << "(s), warm " << warm << "(s)\n";
+	}
+
+	for ( const float relative : { 1e-2f, 1e-3f, 1e-4f } ) {
+		const float tolerance = relative * range;
+		const std::string fileName = "codec_perf_" + std::to_string( relative ) + ".lvd";
+		Timer timer;
+		timer.start();
+		{
+			CompressedLVDWriter writer( fileName, BlockSideInLog, 0, blockDim, Size3( volume.x, volume.y, volume.z ), tolerance );
+			for ( const auto &b : blocks ) {
+				writer.AddBlock( b.data() );
+			}
+			if ( !writer.Close() ) {
+				std::cout << "Failed to write " << fileName << "\n";
+				return 1;
+			}
+		}
+		const auto encodeSec = timer.elapsed().s();
+
+		CompressedLVDFile file( fileName, threadCount );
+		if ( !file.Valid() ) {
+			std::cout << fileName << ": " << file.Error() << "\n";
+			return 1;
+		}
+		DropPageCache( fileName );
+		const auto cold = file.Load( requests ).seconds;
+		const auto coldDecode = file.DecodeSeconds();
+		const auto warm = file.Load( requests ).seconds;
+		const auto warmDecode = file.DecodeSeconds() - coldDecode;
+
+		double maxError = 0;
+		for ( size_t i = 0; i < blockCount; i++ ) {
+			for ( size_t v = 0; v < blocks[ i ].size(); v++ ) {
+				maxError = ( std::max )( maxError, std::abs( double( blocks[ i ][ v ] ) - pool[ i * blocks[ i ].size() + v ] ) );
+			}
+		}
+		const double compressedMB = file.CompressedBytes() / 1024.0 / 1024;
+		std::cout << "error bound " << relative << " of the range: ratio " << mb / compressedMB << ", max error " << maxError / range
+				  << " of the range, " << mb - compressedMB << " MB of disk I/O saved, encode " << encodeSec << "(s)\n"
+				  << "  cold " << cold << "(s), decode " << coldDecode << "(s) thread time; warm " << warm << "(s), decode "
+				  << warmDecode << "(s) thread time\n";
+	}
+	return 0;
+#endif
+}
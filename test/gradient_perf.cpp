@@ -0,0 +1,28 @@
+#include <shading.h>
+#include <iostream>
+
+/**
+ * Prints the gradient cost model and when caching gradient pages beats estimating
+ * gradients on the fly.
+ */
+int main()
+{
+	using namespace vm;
+	for ( const int side : { 32, 64, 128 } ) {
+		const auto model = MeasureGradientCostModel( side, 1000000 );
+		const auto voxels = double( side ) * side * side;
+		std::cout << "Block " << side << "^3" << std::endl;
+		std::cout << "  on the fly: " << model.otfPerSample * 1e9 << " ns/sample" << std::endl;
+		std::cout << "  cached:     " << model.cachedPerSample * 1e9 << " ns/sample" << std::endl;
+		std::cout << "  precompute: " << model.precomputePerVoxel * 1e9 << " ns/voxel, " << model.precomputePerVoxel * voxels * 1e3 << " ms/page" << std::endl;
+		std::cout << "  break even: " << model.BreakEvenSamplesPerPage( side ) << " samples/page ("
+				  << model.BreakEvenSamplesPerPage( side ) / voxels << " samples/voxel)" << std::endl;
+		for ( const double samplesPerVoxel : { 0.01, 0.1, 1.0, 10.0 } ) {
+			const auto samples = samplesPerVoxel * voxels;
+			const auto otf = samples * model.otfPerSample;
+			const auto cached = model.precomputePerVoxel * voxels + samples * model.cachedPerSample;
+			std::cout << "  " << samplesPerVoxel << " samples/voxel: on the fly " << otf * 1e3 << " ms, cached " << cached * 1e3 << " ms" << std::endl;
+		}
+	}
+	return 0;
+}
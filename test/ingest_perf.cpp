@@ -0,0 +1,111 @@
+#include <VMUtils/timer.hpp>
+#include <VMUtils/vmnew.hpp>
+#include <VMFoundation/largevolumecache.h>
+#include <VMFoundation/pluginloader.h>
+#include <VMFoundation/logger.h>
+#include <algorithm>
+#include <cstdio>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+/**
+ * Writes a synthetic volume into a new .lvd file, first with the single threaded
+ * Block3DCache loop of test_lvdwr and then with producer threads calling the plugin's
+ * Write for disjoint blocks, and prints the throughput including the final durable Flush.
+ *
+ * usage: ingest_perf [side] [threads]
+ */
+
+namespace
+{
+constexpr int BlockSideInLog = 6;
+
+vm::Ref<vm::I3DBlockFilePluginInterface> CreateFile( const char *fileName, int side )
+{
+	using namespace vm;
+	Ref<I3DBlockFilePluginInterface> p = PluginLoader::GetPluginLoader()->CreatePlugin<I3DBlockFilePluginInterface>( ".lvd" );
+	if ( !p ) {
+		LOG_FATAL << "Failed to load plugin to write lvd file";
+	}
+	Block3DDataFileDesc desc;
+	desc.IsDataSize = true;
+	desc.BlockSideInLog = BlockSideInLog;
+	desc.DataSize[ 0 ] = side;
+	desc.DataSize[ 1 ] = side;
+	desc.DataSize[ 2 ] = side;
+	desc.Padding = 0;
+	desc.FileName = fileName;
+	p->Create( &desc );
+	return p;
+}
+
+/**
+ * @brief Stands in for the simulation, the content of a block depends on its id
+ */
+void Produce( std::vector<char> &block, size_t id )
+{
+	for ( size_t i = 0; i < block.size(); i += 64 ) {
+		block[ i ] = char( id + i / 64 );
+	}
+}
+}  // namespace
+
+int main( int argc, char **argv )
+{
+	using namespace vm;
+	const int side = argc > 1 ? std::stoi( argv[ 1 ] ) : 512;
+	const int threadCount = argc > 2 ? std::stoi( argv[ 2 ] ) : ( std::max )( 1u, std::thread::hardware_concurrency() );
+	PluginLoader::LoadPlugins( "plugins" );
+
+	const double mb = double( side ) * side * side / 1024 / 1024;
+	std::cout << side << "^3 volume, " << mb << " MB" << std::endl;
+	{
+		const char *fileName = "ingest_perf_cache.lvd";
+		auto p = CreateFile( fileName, side );
+		Timer timer;
+		timer.start();
+		Size3 physicalPageDim{ 8, 1, 1 };
+		Ref<Block3DCache> writer = VM_NEW<Block3DCache>( p, [ &physicalPageDim ]( I3DBlockDataInterface * ) { return physicalPageDim; } );
+		std::vector<char> block( writer->GetPageSize() );
+		const size_t count = writer->GetVirtualPageCount();
+		for ( size_t i = 0; i < count; i++ ) {
+			Produce( block, i );
+			writer->Write( block.data(), i, false );
+		}
+		writer->Flush();
+		writer = nullptr;
+		p->Flush();
+		const auto s = timer.elapsed().s();
+		std::cout << "Block3DCache, 1 thread: " << s << "(s) " << mb / s << " MB/s" << std::endl;
+		p->Close();
+		std::remove( fileName );
+	}
+	{
+		const char *fileName = "ingest_perf_parallel.lvd";
+		auto p = CreateFile( fileName, side );
+		Timer timer;
+		timer.start();
+		const size_t count = p->GetVirtualPageCount();
+		std::vector<std::thread> producers;
+		for ( int t = 0; t < threadCount; t++ ) {
+			producers.emplace_back( [ &, t ]() {
+				std::vector<char> block( p->GetPageSize() );
+				for ( size_t i = t; i < count; i += threadCount ) {
+					Produce( block, i );
+					p->Write( block.data(), i, false );
+				}
+			} );
+		}
+		for ( auto &t : producers ) {
+			t.join();
+		}
+		p->Flush();
+		const auto s = timer.elapsed().s();
+		std::cout << "plugin Write, " << threadCount << " threads: " << s << "(s) " << mb / s << " MB/s" << std::endl;
+		p->Close();
+		std::remove( fileName );
+	}
+	return 0;
+}
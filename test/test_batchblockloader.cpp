@@ -0,0 +1,66 @@
+#include <gtest/gtest.h>
+#include <batchblockloader.h>
+#include <algorithm>
+#include <fstream>
+#include <random>
+
+namespace
+{
+void SortedCoalescedReads( bool direct )
+{
+	using namespace vm;
+	constexpr size_t blockBytes = 4096, blockCount = 64, headerBytes = 36;
+	const char *fileName = "test_batchblockloader.bin";
+	{
+		std::ofstream out( fileName, std::ios::binary );
+		std::vector<char> header( headerBytes, 'h' );
+		out.write( header.data(), header.size() );
+		std::vector<char> block( blockBytes );
+		for ( size_t i = 0; i < blockCount; i++ ) {
+			std::fill( block.begin(), block.end(), char( i ) );
+			out.write( block.data(), block.size() );
+		}
+	}
+
+	BatchBlockLoader loader( fileName, headerBytes, blockCount, blockBytes, 3, 4 * blockBytes, direct );
+#ifdef _WIN32
+	ASSERT_FALSE( loader.Valid() );
+	return;
+#endif
+	ASSERT_TRUE( loader.Valid() );
+
+	// 0..9 in random order and 20, 21: runs of 4, 4, 2 and 2 blocks
+	std::vector<size_t> ids{ 0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 20, 21 };
+	std::shuffle( ids.begin(), ids.end(), std::default_random_engine() );
+	std::vector<std::vector<unsigned char>> pages( ids.size(), std::vector<unsigned char>( blockBytes ) );
+	std::vector<BatchBlockLoader::Request> requests;
+	for ( size_t i = 0; i < ids.size(); i++ ) {
+		requests.emplace_back( ids[ i ], pages[ i ].data() );
+	}
+	const auto stat = loader.Load( requests );
+	ASSERT_EQ( stat.blocks, ids.size() );
+	ASSERT_EQ( stat.runs, 4 );
+	ASSERT_EQ( stat.bytes, ids.size() * blockBytes );
+	for ( size_t i = 0; i < ids.size(); i++ ) {
+		ASSERT_EQ( pages[ i ].front(), ids[ i ] );
+		ASSERT_EQ( pages[ i ].back(), ids[ i ] );
+	}
+
+	// out of range blocks are zero filled
+	std::vector<unsigned char> page( blockBytes, 0xff );
+	loader.Load( { { blockCount, page.data() } } );
+	ASSERT_EQ( page[ 0 ], 0 );
+	ASSERT_EQ( loader.Statistics().blocks, ids.size() + 1 );
+}
+}  // namespace
+
+TEST( test_batchblockloader, sorted_coalesced_reads )
+{
+	SortedCoalescedReads( false );
+}
+
+TEST( test_batchblockloader, direct_io )
+{
+	// falls back to buffered reads where O_DIRECT is refused, the result must be the same
+	SortedCoalescedReads( true );
+}
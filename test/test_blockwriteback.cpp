@@ -0,0 +1,180 @@
+#include <gtest/gtest.h>
+#include <blockwriteback.h>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <random>
+#include <thread>
+
+namespace
+{
+struct Run
+{
+	size_t first, count;
+	bool sync;
+};
+
+struct Recorder
+{
+	std::mutex mtx;
+	std::vector<Run> runs;
+	vm::BlockWriteback::RangeFlusher Flusher()
+	{
+		return [ this ]( size_t first, size_t count, bool sync ) {
+			std::lock_guard<std::mutex> lk( mtx );
+			runs.push_back( Run{ first, count, sync } );
+			return true;
+		};
+	}
+	std::vector<Run> Take()
+	{
+		std::lock_guard<std::mutex> lk( mtx );
+		auto r = std::move( runs );
+		runs.clear();
+		std::sort( r.begin(), r.end(), []( const Run &a, const Run &b ) { return a.first < b.first; } );
+		return r;
+	}
+};
+}  // namespace
+
+TEST( test_blockwriteback, coalesced_flush )
+{
+	using namespace vm;
+	Recorder rec;
+	// the writer thread never wakes on its own here
+	BlockWriteback wb( 64, 4096, rec.Flusher(), 1024 * 4096, 60 * 1000 );
+
+	std::vector<size_t> ids{ 0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 20, 21, 40 };
+	std::shuffle( ids.begin(), ids.end(), std::default_random_engine() );
+	for ( const auto id : ids ) {
+		wb.MarkDirty( id );
+		wb.MarkDirty( id );	 // dirty twice, written once
+	}
+	wb.MarkDirty( 64 );	 // out of range, ignored
+	ASSERT_EQ( wb.DirtyBlockCount(), ids.size() );
+
+	ASSERT_TRUE( wb.Flush() );
+	const auto runs = rec.Take();
+	ASSERT_EQ( runs.size(), 3 );
+	ASSERT_EQ( runs[ 0 ].first, 0 );
+	ASSERT_EQ( runs[ 0 ].count, 10 );
+	ASSERT_EQ( runs[ 1 ].first, 20 );
+	ASSERT_EQ( runs[ 1 ].count, 2 );
+	ASSERT_EQ( runs[ 2 ].first, 40 );
+	ASSERT_EQ( runs[ 2 ].count, 1 );
+	ASSERT_TRUE( runs[ 0 ].sync );
+	ASSERT_EQ( wb.DirtyBlockCount(), 0 );
+	ASSERT_EQ( wb.Statistics().blocks, ids.size() );
+	ASSERT_EQ( wb.Statistics().runs, 3 );
+
+	// nothing dirty, nothing written
+	ASSERT_TRUE( wb.Flush() );
+	ASSERT_TRUE( rec.Take().empty() );
+}
+
+TEST( test_blockwriteback, background_writeback )
+{
+	using namespace vm;
+	Recorder rec;
+	constexpr size_t blockBytes = 4096;
+	{
+		BlockWriteback wb( 256, blockBytes, rec.Flusher(), 16 * blockBytes, 60 * 1000 );
+		for ( size_t i = 0; i < 16; i++ ) {
+			wb.MarkDirty( i );
+		}
+		// the threshold is reached, the writer thread takes the blocks without a Flush
+		for ( int i = 0; i < 500 && wb.Statistics().blocks < 16; i++ ) {
+			std::this_thread::sleep_for( std::chrono::milliseconds( 10 ) );
+		}
+		const auto runs = rec.Take();
+		ASSERT_EQ( runs.size(), 1 );
+		ASSERT_EQ( runs[ 0 ].count, 16 );
+		ASSERT_FALSE( runs[ 0 ].sync );
+
+		wb.MarkDirty( 100 );
+	}
+	// the destructor writes back what is left
+	const auto runs = rec.Take();
+	ASSERT_EQ( runs.size(), 1 );
+	ASSERT_EQ( runs[ 0 ].first, 100 );
+}
+
+TEST( test_blockwriteback, threshold_between_block_multiples )
+{
+	using namespace vm;
+	Recorder rec;
+	constexpr size_t blockBytes = 3000;
+	// 10000 bytes are crossed by the 4th block, no count hits the threshold exactly
+	BlockWriteback wb( 64, blockBytes, rec.Flusher(), 10000, 60 * 1000 );
+	wb.MarkDirty( 0 );
+	// the writer thread is waiting for the threshold now
+	std::this_thread::sleep_for( std::chrono::milliseconds( 50 ) );
+	for ( size_t i = 1; i < 4; i++ ) {
+		wb.MarkDirty( i );
+	}
+	for ( int i = 0; i < 500 && wb.Statistics().blocks < 4; i++ ) {
+		std::this_thread::sleep_for( std::chrono::milliseconds( 10 ) );
+	}
+	ASSERT_EQ( wb.Statistics().blocks, 4 );
+	ASSERT_EQ( rec.Take().size(), 1 );
+}
+
+TEST( test_blockwriteback, interval )
+{
+	using namespace vm;
+	Recorder rec;
+	BlockWriteback wb( 16, 4096, rec.Flusher(), 1024 * 4096, 20 );
+	wb.MarkDirty( 3 );
+	for ( int i = 0; i < 500 && wb.DirtyBlockCount() != 0; i++ ) {
+		std::this_thread::sleep_for( std::chrono::milliseconds( 10 ) );
+	}
+	ASSERT_EQ( wb.DirtyBlockCount(), 0 );
+	wb.Flush();	 // waits for a writeback in flight
+	ASSERT_EQ( rec.Take().size(), 1 );
+}
+
+TEST( test_blockwriteback, concurrent_writers )
+{
+	using namespace vm;
+	constexpr size_t blockCount = 4096, threadCount = 8;
+	std::vector<std::atomic<int>> written( blockCount );
+	for ( auto &w : written ) w = 0;
+	std::vector<std::atomic<int>> flushed( blockCount );
+	for ( auto &f : flushed ) f = 0;
+	{
+		// a low threshold keeps the writer thread busy while the producers mark blocks
+		BlockWriteback wb(
+		  blockCount, 4096, [ & ]( size_t first, size_t count, bool ) {
+			  for ( size_t i = first; i < first + count; i++ ) {
+				  flushed[ i ] = written[ i ].load();
+			  }
+			  return true;
+		  },
+		  32 * 4096, 1 );
+		std::vector<std::thread> producers;
+		for ( size_t t = 0; t < threadCount; t++ ) {
+			producers.emplace_back( [ &, t ]() {
+				std::default_random_engine e( t );
+				// each producer owns the blocks congruent to t and writes them several times
+				for ( int round = 0; round < 4; round++ ) {
+					for ( size_t i = t; i < blockCount; i += threadCount ) {
+						written[ i ]++;
+						wb.MarkDirty( i );
+						if ( e() % 64 == 0 ) std::this_thread::yield();
+					}
+				}
+			} );
+		}
+		for ( auto &p : producers ) {
+			p.join();
+		}
+		ASSERT_TRUE( wb.Flush() );
+		ASSERT_EQ( wb.DirtyBlockCount(), 0 );
+		ASSERT_GE( wb.Statistics().blocks, blockCount );
+	}
+	// the last write of every block was written back
+	for ( size_t i = 0; i < blockCount; i++ ) {
+		ASSERT_EQ( flushed[ i ], 4 );
+	}
+}
@@ -0,0 +1,93 @@
+#include <gtest/gtest.h>
+#include <gridtraversal.h>
+#include <cmath>
+#include <random>
+
+namespace
+{
+const vm::Point3f Lo( 0, 0, 0 ), Hi( 100, 60, 80 );
+const vm::Vec3i Count( 10, 6, 8 );
+
+/**
+ * @brief Checks that the intervals of \a dda are contiguous and each lies in its cell
+ */
+void ExpectCellsAlongRay( vm::GridDDA dda, const vm::Point3f &o, const vm::Vec3f &d )
+{
+	size_t steps = 0;
+	while ( dda.Valid() ) {
+		const auto cell = dda.CellIndex;
+		const float t0 = dda.Pos;
+		++dda;
+		const float t1 = dda.Pos;
+		ASSERT_GE( t1, t0 );
+		if ( t1 - t0 > 1e-3f ) {
+			const float t = 0.5f * ( t0 + t1 );
+			ASSERT_EQ( int( std::floor( ( o.x + d.x * t ) / 10 ) ), cell.x );
+			ASSERT_EQ( int( std::floor( ( o.y + d.y * t ) / 10 ) ), cell.y );
+			ASSERT_EQ( int( std::floor( ( o.z + d.z * t ) / 10 ) ), cell.z );
+		}
+		ASSERT_LT( ++steps, 100u );
+	}
+}
+}  // namespace
+
+TEST( test_gridtraversal, intervals_follow_the_ray )
+{
+	using namespace vm;
+	GridTraversal traversal( Lo, Hi, Count );
+	std::default_random_engine rng( 7 );
+	std::uniform_real_distribution<float> u( -1.f, 1.f );
+	size_t hits = 0;
+	for ( int i = 0; i < 2000; i++ ) {
+		// half the rays start inside the grid
+		const Point3f o = i % 2 ? Point3f( 50 + 40 * u( rng ), 30 + 25 * u( rng ), 40 + 35 * u( rng ) ) :
+								  Point3f( 50 + 150 * u( rng ), 30 + 150 * u( rng ), 40 + 150 * u( rng ) );
+		const Vec3f d( u( rng ), u( rng ), i % 7 ? u( rng ) : 0.f );
+		auto dda = traversal.IntersectWith( o, d );
+		hits += dda.Valid();
+		ExpectCellsAlongRay( dda, o, d );
+	}
+	ASSERT_GT( hits, 1000u );
+
+	// a ray along the x axis through the middle row visits every cell of it once
+	auto dda = traversal.IntersectWith( Point3f( -5, 35, 45 ), Vec3f( 2, 0, 0 ) );
+	ASSERT_FLOAT_EQ( dda.Pos, 2.5f );
+	for ( int x = 0; x < 10; x++ ) {
+		ASSERT_TRUE( dda.Valid() );
+		ASSERT_EQ( dda.CellIndex.x, x );
+		++dda;
+	}
+	ASSERT_FALSE( dda.Valid() );
+	ASSERT_FLOAT_EQ( dda.Pos, 52.5f );
+	ASSERT_FALSE( traversal.IntersectWith( Point3f( -5, 70, 45 ), Vec3f( 1, 0, 0 ) ).Valid() );
+}
+
+TEST( test_gridtraversal, tiles_share_entries )
+{
+	using namespace vm;
+	for ( const auto eye : { Point3f( -50, 30, 40 ), Point3f( 55, 33, 41 ) } ) {
+		GridTraversal traversal( Lo, Hi, Count );
+		auto Direction = []( int x, int y ) { return Vec3f( 1, ( y - 24 ) * 0.01f, ( x - 32 ) * 0.01f ); };
+		traversal.PrepareTiles( eye, 64, 48, 8, Direction );
+		ASSERT_EQ( traversal.TileCount(), 48u );
+		ASSERT_GT( traversal.SharedTileCount(), 0u );
+		for ( int y = 0; y < 48; y++ ) {
+			for ( int x = 0; x < 64; x++ ) {
+				const auto d = Direction( x, y );
+				auto shared = traversal.Start( x, y, d );
+				auto own = traversal.IntersectWith( eye, d );
+				ASSERT_EQ( shared.Valid(), own.Valid() );
+				while ( own.Valid() ) {
+					ASSERT_TRUE( shared.Valid() );
+					ASSERT_EQ( shared.CellIndex.x, own.CellIndex.x );
+					ASSERT_EQ( shared.CellIndex.y, own.CellIndex.y );
+					ASSERT_EQ( shared.CellIndex.z, own.CellIndex.z );
+					ASSERT_NEAR( shared.Pos, own.Pos, 1e-3f );
+					++shared;
+					++own;
+				}
+				ASSERT_FALSE( shared.Valid() );
+			}
+		}
+	}
+}
@@ -0,0 +1,103 @@
+#include <gtest/gtest.h>
+#include <intensityprojection.h>
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+namespace
+{
+constexpr int Side = 8;
+
+float Reference( const std::vector<unsigned char> &block, float x, float y, float z )
+{
+	auto V = [ &block ]( int x, int y, int z ) -> float {
+		x = std::min( x, Side - 1 );
+		y = std::min( y, Side - 1 );
+		z = std::min( z, Side - 1 );
+		return block[ ( z * Side + y ) * Side + x ];
+	};
+	const int ix = int( std::floor( x ) ), iy = int( std::floor( y ) ), iz = int( std::floor( z ) );
+	const float fx = x - ix, fy = y - iy, fz = z - iz;
+	float value = 0;
+	for ( int n = 0; n < 8; n++ ) {
+		const int dx = n & 1, dy = n >> 1 & 1, dz = n >> 2;
+		value += V( ix + dx, iy + dy, iz + dz ) * ( dx ? fx : 1 - fx ) * ( dy ? fy : 1 - fy ) * ( dz ? fz : 1 - fz );
+	}
+	return value;
+}
+}  // namespace
+
+TEST( test_intensityprojection, samples_match_trilinear_interpolation )
+{
+	using namespace vm;
+	std::vector<unsigned char> block( Side * Side * Side );
+	for ( size_t i = 0; i < block.size(); i++ ) {
+		block[ i ] = ( i * 37 + i / 5 ) % 251;
+	}
+	const Point3f p( 0.3f, 1.7f, 0.25f );
+	const Vec3f delta( 0.41f, 0.23f, 0.37f );
+	for ( int count = 0; count <= 17; count++ ) {
+		IntensityAccumulator acc;
+		AccumulateSamples( block.data(), Side, p, delta, count, acc );
+		float max = 0, min = 255, sum = 0;
+		for ( int k = 0; k < count; k++ ) {
+			const float v = Reference( block, p.x + delta.x * k, p.y + delta.y * k, p.z + delta.z * k );
+			max = std::max( max, v );
+			min = std::min( min, v );
+			sum += v;
+		}
+		ASSERT_EQ( acc.count, size_t( count ) );
+		ASSERT_NEAR( acc.max, max, 1e-3f );
+		ASSERT_NEAR( acc.min, min, 1e-3f );
+		ASSERT_NEAR( acc.sum, sum, 1e-2f );
+	}
+	// samples reaching past the block repeat its edge voxels
+	IntensityAccumulator acc;
+	AccumulateSamples( block.data(), Side, Point3f( 7.5f, 3, 3 ), Vec3f( 0, 0, 0 ), 4, acc );
+	ASSERT_NEAR( acc.max, block[ ( 3 * Side + 3 ) * Side + 7 ], 1e-3f );
+}
+
+TEST( test_intensityprojection, uniform_volume_projects_its_value )
+{
+	using namespace vm;
+	// a ray along x through a row of three uniform blocks, sampled block by block as the
+	// renderer does, the last samples of a block lie past its upper face
+	const std::vector<unsigned char> block( Side * Side * Side, 100 );
+	const float step = 0.3f;
+	for ( const auto mode : { IntensityProjection::Minimum, IntensityProjection::Maximum, IntensityProjection::Average } ) {
+		IntensityAccumulator acc;
+		float t = 0.1f;
+		for ( int b = 0; b < 3 && !acc.Saturated( mode ); b++ ) {
+			const float end = float( ( b + 1 ) * Side );
+			const int count = int( std::ceil( ( end - t ) / step ) );
+			AccumulateSamples( block.data(), Side, Point3f( t - b * Side, 2.5f, 6.9f ), Vec3f( step, 0, 0.01f ), count, acc );
+			t += count * step;
+		}
+		ASSERT_GT( acc.count, size_t( 3 * Side ) );
+		ASSERT_NEAR( acc.Value( mode ), 100, 1e-3f );
+	}
+}
+
+TEST( test_intensityprojection, early_outs_by_mode )
+{
+	using namespace vm;
+	ASSERT_EQ( IntensityProjectionFromName( "mip" ), IntensityProjection::Maximum );
+	ASSERT_EQ( IntensityProjectionFromName( "composite" ), IntensityProjection::None );
+	IntensityAccumulator acc;
+	ASSERT_EQ( acc.Value( IntensityProjection::Minimum ), 0 );
+	// the first block sets the minimum even if it is all 255
+	ASSERT_TRUE( acc.MayChange( IntensityProjection::Minimum, 255, 255 ) );
+	std::vector<unsigned char> block( Side * Side * Side, 100 );
+	AccumulateSamples( block.data(), Side, Point3f( 1, 1, 1 ), Vec3f( 1, 1, 1 ), 5, acc );
+	ASSERT_FALSE( acc.MayChange( IntensityProjection::Maximum, 20, 100 ) );
+	ASSERT_TRUE( acc.MayChange( IntensityProjection::Maximum, 20, 101 ) );
+	ASSERT_FALSE( acc.MayChange( IntensityProjection::Minimum, 100, 200 ) );
+	ASSERT_TRUE( acc.MayChange( IntensityProjection::Average, 100, 100 ) );
+	ASSERT_FALSE( acc.Saturated( IntensityProjection::Maximum ) );
+	ASSERT_FLOAT_EQ( acc.Value( IntensityProjection::Average ), 100 );
+	block.assign( block.size(), 255 );
+	AccumulateSamples( block.data(), Side, Point3f( 1, 1, 1 ), Vec3f( 1, 1, 1 ), 5, acc );
+	ASSERT_TRUE( acc.Saturated( IntensityProjection::Maximum ) );
+	ASSERT_FLOAT_EQ( acc.Value( IntensityProjection::Minimum ), 100 );
+	ASSERT_FLOAT_EQ( acc.Value( IntensityProjection::Average ), 177.5f );
+}
@@ -0,0 +1,130 @@
+#include <gtest/gtest.h>
+#include <lossyblockcodec.h>
+#include <cmath>
+#include <limits>
+#include <random>
+#include <vector>
+
+namespace
+{
+constexpr size_t Side = 16;
+constexpr size_t Voxels = Side * Side * Side;
+
+std::vector<float> SmoothBlock( float offset )
+{
+	std::vector<float> block( Voxels );
+	size_t i = 0;
+	for ( size_t z = 0; z < Side; z++ ) {
+		for ( size_t y = 0; y < Side; y++ ) {
+			for ( size_t x = 0; x < Side; x++ ) {
+				block[ i++ ] = offset + std::sin( 0.3f * x ) * std::cos( 0.2f * y ) + 0.05f * z;
+			}
+		}
+	}
+	return block;
+}
+
+void ExpectWithin( const std::vector<float> &original, const std::vector<float> &decoded, float tolerance )
+{
+	for ( size_t i = 0; i < original.size(); i++ ) {
+		if ( std::isnan( original[ i ] ) ) {
+			ASSERT_TRUE( std::isnan( decoded[ i ] ) ) << i;
+		} else if ( std::isinf( original[ i ] ) ) {
+			ASSERT_EQ( original[ i ], decoded[ i ] ) << i;
+		} else {
+			ASSERT_LE( std::abs( double( original[ i ] ) - decoded[ i ] ), tolerance ) << i;
+		}
+	}
+}
+}  // namespace
+
+TEST( test_lossyblockcodec, error_bound )
+{
+	using namespace vm;
+	std::default_random_engine rng;
+	std::uniform_real_distribution<float> noise( -1000.f, 1000.f );
+	auto noisy = SmoothBlock( 0 );
+	for ( auto &v : noisy ) {
+		v += noise( rng );
+	}
+	auto special = SmoothBlock( 1e6f );
+	special[ 7 ] = std::numeric_limits<float>::quiet_NaN();
+	special[ 100 ] = std::numeric_limits<float>::infinity();
+	special[ 101 ] = -3e38f;
+	special[ 2000 ] = 1e-30f;
+
+	for ( const float tolerance : { 1e-4f, 0.01f, 0.3f } ) {
+		for ( const auto &block : { SmoothBlock( 0 ), noisy, special } ) {
+			std::vector<unsigned char> encoded;
+			const auto bytes = EncodeFloatBlock( block.data(), Side, tolerance, encoded );
+			ASSERT_EQ( bytes, encoded.size() );
+			std::vector<float> decoded( Voxels );
+			ASSERT_TRUE( DecodeFloatBlock( encoded.data(), bytes, Side, tolerance, decoded.data() ) );
+			ExpectWithin( block, decoded, tolerance );
+			// a cut stream is detected instead of read past its end
+			ASSERT_FALSE( DecodeFloatBlock( encoded.data(), bytes / 2, Side, tolerance, decoded.data() ) );
+		}
+	}
+
+	// smooth data shrinks with the accuracy asked for, a constant block to one byte
+	std::vector<unsigned char> coarse, fine, constant;
+	const auto smooth = SmoothBlock( 0 );
+	EncodeFloatBlock( smooth.data(), Side, 0.01f, coarse );
+	EncodeFloatBlock( smooth.data(), Side, 1e-5f, fine );
+	ASSERT_LT( coarse.size(), Voxels * sizeof( float ) / 4 );
+	ASSERT_LT( coarse.size(), fine.size() );
+	const std::vector<float> zero( Voxels, 0.f );
+	ASSERT_EQ( EncodeFloatBlock( zero.data(), Side, 0.01f, constant ), 1 );
+}
+
+TEST( test_lossyblockcodec, compressed_file )
+{
+	using namespace vm;
+	const char *fileName = "test_lossyblockcodec.lvd";
+	constexpr float Tolerance = 0.001f;
+	constexpr size_t BlockCount = 2 * 2 * 3;
+	std::vector<std::vector<float>> blocks;
+	{
+		CompressedLVDWriter writer( fileName, 4, 1, Size3( 2, 2, 3 ), Size3( 28, 28, 42 ), Tolerance );
+		ASSERT_TRUE( writer.Valid() );
+		for ( size_t i = 0; i < BlockCount; i++ ) {
+			blocks.push_back( SmoothBlock( float( i ) ) );
+			ASSERT_GT( writer.AddBlock( blocks.back().data() ), 0 );
+		}
+		ASSERT_TRUE( writer.Close() );
+	}
+
+	CompressedLVDFile file( fileName, 3 );
+#ifdef _WIN32
+	ASSERT_FALSE( file.Valid() );
+	return;
+#endif
+	ASSERT_TRUE( file.Valid() ) << file.Error();
+	ASSERT_EQ( file.BlockCount(), BlockCount );
+	ASSERT_EQ( file.BlockSide(), Side );
+	ASSERT_EQ( file.ErrorBound(), Tolerance );
+	ASSERT_LT( file.CompressedBytes(), BlockCount * file.BlockBytes() );
+
+	std::vector<std::vector<float>> decoded( BlockCount, std::vector<float>( Voxels ) );
+	std::vector<CompressedLVDFile::Request> requests;
+	for ( size_t i = BlockCount; i-- > 0; ) {
+		requests.emplace_back( i, decoded[ i ].data() );
+	}
+	const auto stat = file.Load( requests );
+	ASSERT_EQ( stat.blocks, BlockCount );
+	ASSERT_EQ( stat.bytes, file.CompressedBytes() );
+	for ( size_t i = 0; i < BlockCount; i++ ) {
+		ExpectWithin( blocks[ i ], decoded[ i ], Tolerance );
+	}
+	ASSERT_GT( file.DecodeSeconds(), 0 );
+
+	std::vector<float> block( Voxels );
+	ASSERT_TRUE( file.ReadBlock( 5, block.data() ) );
+	ASSERT_EQ( block, decoded[ 5 ] );
+	ASSERT_FALSE( file.ReadBlock( BlockCount, block.data() ) );
+
+	// an incomplete volume is not a valid file
+	CompressedLVDWriter partial( "test_lossyblockcodec_partial.lvd", 4, 1, Size3( 2, 2, 3 ), Size3( 28, 28, 42 ), Tolerance );
+	partial.AddBlock( blocks[ 0 ].data() );
+	ASSERT_FALSE( partial.Close() );
+}
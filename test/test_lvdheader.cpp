@@ -0,0 +1,169 @@
+#include <gtest/gtest.h>
+#include <lvdfileheader.h>
+#include <cstring>
+#include <fstream>
+#include <functional>
+#include <vector>
+
+namespace
+{
+void SetVolume( vm::LVDFileHeader &header )
+{
+	header.blockLengthInLog = 6;
+	header.padding = 2;
+	for ( int i = 0; i < 3; i++ ) {
+		header.dataDim[ i ] = 128;
+		header.originalDataDim[ i ] = 120;
+	}
+}
+
+constexpr size_t DataBytes = 128 * 128 * 128;
+}  // namespace
+
+TEST( test_lvdheader, versioned_round_trip )
+{
+	using namespace vm;
+	LVDFileHeader header;
+	SetVolume( header );
+	header.SetCurrentVersion();
+	header.voxelType = LVDFileHeader::UInt8;
+	header.blockIndexOffset = LVDFileHeader::DefaultHeaderSize + DataBytes;
+	header.statisticsOffset = LVDFileHeader::DefaultHeaderSize + DataBytes + 1024;
+	ASSERT_EQ( header.HeaderSize(), LVDFileHeader::DefaultHeaderSize );
+
+	const std::vector<unsigned char> bytes( header.Encode(), header.Encode() + header.HeaderSize() );
+	LVDFileHeader decoded;
+	decoded.Decode( const_cast<unsigned char *>( bytes.data() ) );
+	ASSERT_EQ( decoded.magicNum, LVDFileHeader::VersionedMagicNumber );
+	ASSERT_EQ( decoded.version, LVDFileHeader::CurrentVersion );
+	ASSERT_EQ( decoded.HeaderSize(), header.HeaderSize() );
+	ASSERT_EQ( decoded.blockLengthInLog, 6 );
+	ASSERT_EQ( decoded.padding, 2 );
+	for ( int i = 0; i < 3; i++ ) {
+		ASSERT_EQ( decoded.dataDim[ i ], 128 );
+		ASSERT_EQ( decoded.originalDataDim[ i ], 120 );
+	}
+	ASSERT_EQ( decoded.voxelType, LVDFileHeader::UInt8 );
+	ASSERT_EQ( decoded.compression, LVDFileHeader::None );
+	ASSERT_EQ( decoded.blockIndexOffset, header.blockIndexOffset );
+	ASSERT_EQ( decoded.statisticsOffset, header.statisticsOffset );
+	ASSERT_EQ( decoded.errorBound, 0 );
+
+	std::string error;
+	ASSERT_TRUE( decoded.Validate( header.statisticsOffset + 1024, error ) ) << error;
+}
+
+TEST( test_lvdheader, lossy_fields )
+{
+	using namespace vm;
+	LVDFileHeader header;
+	SetVolume( header );
+	header.SetCurrentVersion();
+	header.voxelType = LVDFileHeader::Float32;
+	header.compression = LVDFileHeader::FixedAccuracy;
+	header.errorBound = 0.25f;
+	header.blockIndexOffset = LVDFileHeader::DefaultHeaderSize + 1024;
+	const size_t fileBytes = header.blockIndexOffset + 1024;
+
+	LVDFileHeader decoded;
+	decoded.Decode( header.Encode() );
+	ASSERT_EQ( decoded.compression, LVDFileHeader::FixedAccuracy );
+	ASSERT_EQ( decoded.errorBound, 0.25f );
+	std::string error;
+	ASSERT_TRUE( decoded.Validate( fileBytes, error ) ) << error;
+
+	// the bound and the block table are required, only float blocks are coded lossy
+	decoded.errorBound = 0;
+	ASSERT_FALSE( decoded.Validate( fileBytes, error ) );
+	decoded.errorBound = 0.25f;
+	decoded.voxelType = LVDFileHeader::UInt8;
+	ASSERT_FALSE( decoded.Validate( fileBytes, error ) );
+	decoded.voxelType = LVDFileHeader::Float32;
+	decoded.blockIndexOffset = 0;
+	ASSERT_FALSE( decoded.Validate( fileBytes, error ) );
+
+	// a minimal version 1 header has no room for the bound
+	header.headerSize = LVD_HEADER_V1_SIZE;
+	decoded.Decode( header.Encode() );
+	ASSERT_EQ( decoded.errorBound, 0 );
+}
+
+TEST( test_lvdheader, legacy_file )
+{
+	using namespace vm;
+	LVDFileHeader header;
+	SetVolume( header );
+	ASSERT_EQ( header.magicNum, LVDFileHeader::MagicNumber );
+	ASSERT_EQ( header.HeaderSize(), LVD_HEADER_SIZE );
+
+	// the bytes behind an old header are block data and must not be read as fields
+	std::vector<unsigned char> bytes( LVD_HEADER_KNOWN_SIZE, 0xff );
+	memcpy( bytes.data(), header.Encode(), header.HeaderSize() );
+	LVDFileHeader decoded;
+	decoded.Decode( bytes.data() );
+	ASSERT_EQ( decoded.version, 0 );
+	ASSERT_EQ( decoded.HeaderSize(), LVD_HEADER_SIZE );
+	ASSERT_EQ( decoded.voxelType, LVDFileHeader::UInt8 );
+	ASSERT_EQ( decoded.blockIndexOffset, 0 );
+	ASSERT_EQ( decoded.originalDataDim[ 2 ], 120 );
+
+	const char *fileName = "test_lvdheader_legacy.lvd";
+	{
+		std::ofstream out( fileName, std::ios::binary );
+		out.write( (const char *)header.Encode(), header.HeaderSize() );
+		std::vector<char> data( DataBytes );
+		out.write( data.data(), data.size() );
+	}
+	LVDFileHeader read;
+	std::string error;
+	ASSERT_TRUE( ReadLVDFileHeader( fileName, read, error ) ) << error;
+	ASSERT_EQ( read.dataDim[ 0 ], 128 );
+}
+
+TEST( test_lvdheader, validate )
+{
+	using namespace vm;
+	std::string error;
+	LVDFileHeader header;
+	SetVolume( header );
+	header.SetCurrentVersion();
+	const size_t fileBytes = header.HeaderSize() + DataBytes;
+	ASSERT_TRUE( header.Validate( fileBytes, error ) ) << error;
+	ASSERT_FALSE( header.Validate( fileBytes - 1, error ) );
+
+	auto reject = [ & ]( const std::function<void( LVDFileHeader & )> &change ) {
+		LVDFileHeader bad;
+		SetVolume( bad );
+		bad.SetCurrentVersion();
+		change( bad );
+		std::string error;
+		return !bad.Validate( fileBytes, error ) && !error.empty();
+	};
+	ASSERT_TRUE( reject( []( LVDFileHeader &h ) { h.magicNum = 42; } ) );
+	ASSERT_TRUE( reject( []( LVDFileHeader &h ) { h.version = LVDFileHeader::CurrentVersion + 1; } ) );
+	ASSERT_TRUE( reject( []( LVDFileHeader &h ) { h.headerSize = LVD_HEADER_SIZE; } ) );
+	ASSERT_TRUE( reject( []( LVDFileHeader &h ) { h.blockLengthInLog = 31; } ) );
+	ASSERT_TRUE( reject( []( LVDFileHeader &h ) { h.padding = 32; } ) );
+	ASSERT_TRUE( reject( []( LVDFileHeader &h ) { h.dataDim[ 1 ] = 100; } ) );
+	ASSERT_TRUE( reject( []( LVDFileHeader &h ) { h.voxelType = 7; } ) );
+	ASSERT_TRUE( reject( []( LVDFileHeader &h ) { h.voxelType = LVDFileHeader::UInt16; } ) );	// twice the data
+	ASSERT_TRUE( reject( []( LVDFileHeader &h ) { h.compression = 3; } ) );
+	ASSERT_TRUE( reject( []( LVDFileHeader &h ) { h.blockIndexOffset = 64; } ) );	 // inside the header
+
+	// with a block index duplicates are stored once, the file may be smaller than the volume
+	LVDFileHeader indexed;
+	SetVolume( indexed );
+	indexed.SetCurrentVersion();
+	indexed.blockIndexOffset = indexed.HeaderSize() + DataBytes / 4;
+	ASSERT_TRUE( indexed.Validate( indexed.blockIndexOffset + 64, error ) ) << error;
+	ASSERT_FALSE( indexed.Validate( indexed.blockIndexOffset, error ) );
+
+	// a truncated file still decodes and is rejected by size
+	const char *fileName = "test_lvdheader_short.lvd";
+	{
+		std::ofstream out( fileName, std::ios::binary );
+		out.write( "\x21\x3c\x04", 3 );
+	}
+	LVDFileHeader read;
+	ASSERT_FALSE( ReadLVDFileHeader( fileName, read, error ) );
+}
@@ -0,0 +1,117 @@
+#include <gtest/gtest.h>
+#include <lvdtimeseries.h>
+#include <fstream>
+#include <vector>
+
+namespace
+{
+constexpr int SideInLog = 3;
+constexpr size_t BlockBytes = 8 * 8 * 8;
+constexpr size_t BlockCount = 4 * 4 * 2;
+
+std::vector<std::vector<unsigned char>> Timestep( int t )
+{
+	std::vector<std::vector<unsigned char>> blocks( BlockCount, std::vector<unsigned char>( BlockBytes ) );
+	for ( size_t i = 0; i < BlockCount; i++ ) {
+		// timestep 0 stores every block, later timesteps change every 4th block, those with i % 4 == t % 4
+		const int version = t == 0 ? 0 : ( i % 4 == size_t( t ) % 4 ? t : 0 );
+		for ( size_t v = 0; v < BlockBytes; v++ ) {
+			blocks[ i ][ v ] = (unsigned char)( i * 3 + v + version * 101 );
+		}
+		// the pattern repeats every 256 bytes, the tag keeps the blocks distinct
+		blocks[ i ][ 0 ] = (unsigned char)i;
+		blocks[ i ][ 1 ] = (unsigned char)version;
+	}
+	return blocks;
+}
+}  // namespace
+
+TEST( test_lvdtimeseries, unchanged_blocks_share_slots )
+{
+	using namespace vm;
+	const char *fileName = "test_timeseries.lvts";
+	std::vector<std::vector<std::vector<unsigned char>>> steps;
+	{
+		LVDTimeSeriesWriter writer( fileName, SideInLog, 0, Size3( 4, 4, 2 ), Size3( 32, 32, 16 ) );
+		ASSERT_TRUE( writer.Valid() );
+		for ( int t = 0; t < 4; t++ ) {
+			steps.push_back( Timestep( t ) );
+			const auto added = writer.AddTimestep( [ & ]( size_t id ) { return steps.back()[ id ].data(); } );
+			// the blocks of version t are new, those of version t - 1 return to the stored version 0
+			ASSERT_EQ( added, t == 0 ? BlockCount : BlockCount / 4 );
+		}
+		ASSERT_TRUE( writer.Close() );
+	}
+
+	LVDTimeSeriesFile file( fileName );
+	ASSERT_TRUE( file.Valid() ) << file.Error();
+	ASSERT_EQ( file.TimestepCount(), 4 );
+	ASSERT_EQ( file.BlockCount(), BlockCount );
+	ASSERT_EQ( file.BlockBytes(), BlockBytes );
+	ASSERT_LT( file.SlotCount(), 4 * BlockCount );
+	ASSERT_EQ( file.SlotCount(), BlockCount + 3 * BlockCount / 4 );
+	ASSERT_EQ( file.StoredBlockCount( 0 ), BlockCount );
+	ASSERT_EQ( file.StoredBlockCount( 3 ), BlockCount / 4 );
+	std::vector<unsigned char> block( BlockBytes );
+	for ( size_t t = 0; t < 4; t++ ) {
+		for ( size_t i = 0; i < BlockCount; i++ ) {
+			ASSERT_TRUE( file.ReadSlot( file.Slot( t, i ), block.data() ) );
+			ASSERT_EQ( block, steps[ t ][ i ] ) << "timestep " << t << " block " << i;
+			if ( t > 0 && steps[ t ][ i ] == steps[ t - 1 ][ i ] ) {
+				ASSERT_EQ( file.Slot( t, i ), file.Slot( t - 1, i ) );
+			}
+		}
+	}
+	ASSERT_FALSE( file.ReadSlot( file.SlotCount(), block.data() ) );
+}
+
+TEST( test_lvdtimeseries, identical_blocks_are_stored_once )
+{
+	using namespace vm;
+	const char *fileName = "test_labels.lvts";
+	// a label volume: every block is filled with one of three labels
+	std::vector<std::vector<unsigned char>> blocks;
+	for ( size_t i = 0; i < BlockCount; i++ ) {
+		blocks.emplace_back( BlockBytes, (unsigned char)( i % 3 ) );
+	}
+	{
+		LVDTimeSeriesWriter writer( fileName, SideInLog, 0, Size3( 4, 4, 2 ), Size3( 32, 32, 16 ) );
+		ASSERT_EQ( writer.AddTimestep( [ & ]( size_t id ) { return blocks[ id ].data(); } ), 3 );
+		ASSERT_TRUE( writer.Close() );
+	}
+	LVDTimeSeriesFile file( fileName );
+	ASSERT_TRUE( file.Valid() ) << file.Error();
+	ASSERT_EQ( file.TimestepCount(), 1 );
+	ASSERT_EQ( file.SlotCount(), 3 );
+	std::vector<unsigned char> block( BlockBytes );
+	for ( size_t i = 0; i < BlockCount; i++ ) {
+		ASSERT_EQ( file.Slot( 0, i ), file.Slot( 0, i % 3 ) );
+		ASSERT_TRUE( file.ReadSlot( file.Slot( 0, i ), block.data() ) );
+		ASSERT_EQ( block, blocks[ i ] );
+	}
+}
+
+TEST( test_lvdtimeseries, rejects_truncated_index )
+{
+	using namespace vm;
+	const char *fileName = "test_timeseries_truncated.lvts";
+	{
+		LVDTimeSeriesWriter writer( fileName, SideInLog, 0, Size3( 4, 4, 2 ), Size3( 32, 32, 16 ) );
+		const auto step = Timestep( 0 );
+		writer.AddTimestep( [ & ]( size_t id ) { return step[ id ].data(); } );
+		ASSERT_TRUE( writer.Close() );
+	}
+	// cut into the index table
+	std::vector<char> bytes;
+	{
+		std::ifstream in( fileName, std::ios::binary );
+		bytes.assign( std::istreambuf_iterator<char>( in ), std::istreambuf_iterator<char>() );
+	}
+	{
+		std::ofstream out( fileName, std::ios::binary | std::ios::trunc );
+		out.write( bytes.data(), bytes.size() - 8 );
+	}
+	LVDTimeSeriesFile file( fileName );
+	ASSERT_FALSE( file.Valid() );
+	ASSERT_FALSE( file.Error().empty() );
+}
@@ -2,6 +2,7 @@
 #include <random>
 #include <fstream>
 #include <sstream>
+#include <thread>
 
 #include <lvdfile.h>
 #include <voxelman.h>
@@ -274,3 +275,57 @@ TEST( test, test_cachewrite_abcflow )
 TEST( test_lvdwr, basic )
 {
 }
+
+TEST( test_lvdwr, concurrent_write )
+{
+	using namespace vm;
+	constexpr int blockSideInLog = 5, threadCount = 8;
+	const char *fileName = "test_concurrent_write.lvd";
+
+	PluginLoader::LoadPlugins( "plugins" );
+	Ref<I3DBlockFilePluginInterface> p = PluginLoader::GetPluginLoader()->CreatePlugin<I3DBlockFilePluginInterface>( ".lvd" );
+	ASSERT_TRUE( p != nullptr );
+
+	Block3DDataFileDesc Desc;
+	Desc.IsDataSize = true;
+	Desc.BlockSideInLog = blockSideInLog;
+	Desc.DataSize[ 0 ] = 256;
+	Desc.DataSize[ 1 ] = 256;
+	Desc.DataSize[ 2 ] = 128;
+	Desc.Padding = 0;
+	Desc.FileName = fileName;
+	ASSERT_TRUE( p->Create( &Desc ) );
+
+	const size_t count = p->GetVirtualPageCount();
+	const size_t pageSize = p->GetPageSize();
+	ASSERT_EQ( count, 8 * 8 * 4 );
+
+	// every producer writes the blocks congruent to its index, twice, the second write wins
+	std::vector<std::thread> producers;
+	for ( int t = 0; t < threadCount; t++ ) {
+		producers.emplace_back( [ &, t ]() {
+			std::vector<char> block( pageSize );
+			for ( int round = 0; round < 2; round++ ) {
+				for ( size_t i = t; i < count; i += threadCount ) {
+					std::fill( block.begin(), block.end(), char( i * 7 + round ) );
+					block[ 0 ] = char( t );
+					p->Write( block.data(), i, false );
+				}
+			}
+		} );
+	}
+	for ( auto &t : producers ) {
+		t.join();
+	}
+	p->Flush();
+	p->Close();
+
+	p->Open( fileName );
+	for ( size_t i = 0; i < count; i++ ) {
+		auto data = (const char *)p->GetPage( i );
+		ASSERT_EQ( data[ 0 ], char( i % threadCount ) );
+		ASSERT_EQ( data[ 1 ], char( i * 7 + 1 ) );
+		ASSERT_EQ( data[ pageSize - 1 ], char( i * 7 + 1 ) );
+	}
+	p->Close();
+}
@@ -0,0 +1,147 @@
+#include <gtest/gtest.h>
+#include <minmaxoctree.h>
+#include <cstring>
+#include <vector>
+
+namespace
+{
+constexpr int Side = 16, Brick = 4;
+
+/**
+ * @brief 2x2x2 blocks of zeros, block 1 holds 200 at (4, 5, 5)
+ */
+std::vector<std::vector<uint8_t>> MakeBlocks()
+{
+	std::vector<std::vector<uint8_t>> blocks( 8, std::vector<uint8_t>( Side * Side * Side, 0 ) );
+	blocks[ 1 ][ ( 5 * Side + 5 ) * Side + 4 ] = 200;
+	return blocks;
+}
+
+std::vector<float> OpaqueAbove( int threshold )
+{
+	std::vector<float> tf( 256 * 4, 0.f );
+	for ( int v = threshold; v < 256; v++ ) {
+		tf[ 4 * v + 3 ] = 1.f;
+	}
+	return tf;
+}
+
+vm::MinMaxOctree::BlockLoader Loader( const std::vector<std::vector<uint8_t>> &blocks )
+{
+	return [ &blocks ]( size_t id, void *page ) {
+		memcpy( page, blocks[ id ].data(), blocks[ id ].size() );
+		return true;
+	};
+}
+}  // namespace
+
+TEST( test_minmaxoctree, ranges_and_classification )
+{
+	using namespace vm;
+	const auto blocks = MakeBlocks();
+	MinMaxOctree octree( Loader( blocks ), Vec3i( 2, 2, 2 ), Side, Brick, 3 );
+	ASSERT_TRUE( octree.Valid() );
+	ASSERT_EQ( octree.LevelCount(), 4 );  // 8^3, 4^3, 2^3 blocks, root
+	ASSERT_EQ( octree.LevelSize( 2 ).x, 2 );
+	// the sampler interpolates the voxel at 4 in the bricks on both sides of it
+	ASSERT_EQ( octree.Max( 0, Point3i( 4, 1, 1 ) ), 200 );
+	ASSERT_EQ( octree.Max( 0, Point3i( 5, 1, 1 ) ), 200 );
+	ASSERT_EQ( octree.Max( 0, Point3i( 6, 1, 1 ) ), 0 );
+	ASSERT_EQ( octree.Max( 3, Point3i( 0, 0, 0 ) ), 200 );
+
+	auto tf = OpaqueAbove( 100 );
+	octree.Classify( tf.data() );
+	ASSERT_TRUE( octree.BlockEmpty( Point3i( 0, 0, 0 ) ) );
+	ASSERT_FALSE( octree.BlockEmpty( Point3i( 1, 0, 0 ) ) );
+	ASSERT_FALSE( octree.Empty( 3, Point3i( 0, 0, 0 ) ) );
+
+	// reclassified without touching voxels
+	tf = OpaqueAbove( 201 );
+	octree.Classify( tf.data() );
+	ASSERT_TRUE( octree.Empty( 3, Point3i( 0, 0, 0 ) ) );
+	tf = OpaqueAbove( 0 );
+	octree.Classify( tf.data() );
+	ASSERT_FALSE( octree.BlockEmpty( Point3i( 0, 0, 0 ) ) );
+}
+
+TEST( test_minmaxoctree, incremental_classification )
+{
+	using namespace vm;
+	const auto blocks = MakeBlocks();
+	MinMaxOctree octree( Loader( blocks ), Vec3i( 2, 2, 2 ), Side, Brick, 1 );
+	// [0, 0] and [0, 200]
+	ASSERT_EQ( octree.RangeCount(), 2 );
+	auto tf = OpaqueAbove( 100 );
+	ASSERT_EQ( octree.Classify( tf.data() ), octree.NodeCount() - 5 );	// 2 bricks and one node above them per level
+	// more opacity where there already was some changes nothing
+	tf[ 4 * 150 + 3 ] = 0.5f;
+	ASSERT_EQ( octree.Classify( tf.data() ), 0 );
+	// values no node holds
+	tf[ 4 * 50 + 3 ] = 1.f;
+	ASSERT_EQ( octree.Classify( tf.data() ), 0 );
+	// only the nodes that hold 200 flip
+	for ( int v = 50; v < 256; v++ ) {
+		tf[ 4 * v + 3 ] = 0.f;
+	}
+	ASSERT_EQ( octree.Classify( tf.data() ), 5 );
+	ASSERT_TRUE( octree.BlockEmpty( Point3i( 1, 0, 0 ) ) );
+	// making 0 visible flips the rest back
+	tf[ 3 ] = 1.f;
+	ASSERT_EQ( octree.Classify( tf.data() ), octree.NodeCount() );
+	ASSERT_FALSE( octree.Empty( 0, Point3i( 0, 0, 0 ) ) );
+}
+
+TEST( test_minmaxoctree, zero_beyond_the_block )
+{
+	using namespace vm;
+	std::vector<std::vector<uint8_t>> blocks( 1, std::vector<uint8_t>( Side * Side * Side, 150 ) );
+	MinMaxOctree octree( Loader( blocks ), Vec3i( 1, 1, 1 ), Side, Brick, 1 );
+	ASSERT_EQ( octree.Min( 0, Point3i( 0, 0, 0 ) ), 150 );
+	ASSERT_EQ( octree.Min( 0, Point3i( 3, 0, 0 ) ), 0 );
+	auto tf = std::vector<float>( 256 * 4, 0.f );
+	tf[ 3 ] = 1.f;
+	octree.Classify( tf.data() );
+	ASSERT_TRUE( octree.Empty( 0, Point3i( 2, 2, 2 ) ) );
+	ASSERT_FALSE( octree.Empty( 0, Point3i( 2, 3, 2 ) ) );
+}
+
+TEST( test_minmaxoctree, leap_to_the_exit_of_the_largest_empty_node )
+{
+	using namespace vm;
+	const auto blocks = MakeBlocks();
+	MinMaxOctree octree( Loader( blocks ), Vec3i( 2, 2, 2 ), Side, Brick, 2 );
+	auto tf = OpaqueAbove( 100 );
+	octree.Classify( tf.data() );
+	float exit = 0;
+	// block 0 is the largest empty node on the way
+	ASSERT_TRUE( octree.SkipEmpty( Point3f( 0, 2.5, 2.5 ), Vec3f( 1, 0, 0 ), 1.f, exit ) );
+	ASSERT_FLOAT_EQ( exit, 16.f );
+	// the bricks of block 1 around the voxel are visible
+	ASSERT_FALSE( octree.SkipEmpty( Point3f( 0, 5.5, 5.5 ), Vec3f( 1, 0, 0 ), 17.f, exit ) );
+	ASSERT_FLOAT_EQ( exit, 20.f );
+	ASSERT_TRUE( octree.SkipEmpty( Point3f( 0, 5.5, 5.5 ), Vec3f( 1, 0, 0 ), 25.f, exit ) );
+	ASSERT_FLOAT_EQ( exit, 32.f );
+	// leaving through the lower face
+	ASSERT_TRUE( octree.SkipEmpty( Point3f( 32, 2.5, 2.5 ), Vec3f( -2, 0, 0 ), 7.f, exit ) );
+	ASSERT_FLOAT_EQ( exit, 8.f );
+	// the whole volume becomes one empty node
+	tf = OpaqueAbove( 201 );
+	octree.Classify( tf.data() );
+	ASSERT_TRUE( octree.SkipEmpty( Point3f( 0, 5.5, 5.5 ), Vec3f( 1, 0, 0 ), 17.f, exit ) );
+	ASSERT_FLOAT_EQ( exit, 32.f );
+}
+
+TEST( test_minmaxoctree, unreadable_blocks_are_visible )
+{
+	using namespace vm;
+	auto loader = []( size_t id, void *page ) {
+		memset( page, 0, Side * Side * Side );
+		return id != 0;
+	};
+	MinMaxOctree octree( loader, Vec3i( 2, 1, 1 ), Side, Brick, 2 );
+	ASSERT_FALSE( octree.Valid() );
+	auto tf = OpaqueAbove( 1 );
+	octree.Classify( tf.data() );
+	ASSERT_FALSE( octree.BlockEmpty( Point3i( 0, 0, 0 ) ) );
+	ASSERT_TRUE( octree.BlockEmpty( Point3i( 1, 0, 0 ) ) );
+}
@@ -0,0 +1,91 @@
+#include <gtest/gtest.h>
+#include <occlusionbuffer.h>
+#include <VMGraphics/camera.h>
+#include <limits>
+
+namespace
+{
+constexpr float NeverOpaque = std::numeric_limits<float>::infinity();
+
+/**
+ * @brief A 32 x 16 film of 8 x 8 tiles whose left half turned opaque at distance 10
+ */
+void RecordFrame( vm::OcclusionBuffer &buffer )
+{
+	buffer.BeginFrame( 32, 16 );
+	for ( int y = 0; y < 16; y++ ) {
+		for ( int x = 0; x < 32; x++ ) {
+			buffer.Record( x, y, x < 16 ? 10.f - x * 0.1f : NeverOpaque );
+		}
+	}
+}
+}  // namespace
+
+TEST( test_occlusionbuffer, previous_frame_answers )
+{
+	using namespace vm;
+	OcclusionBuffer buffer( 8 );
+	RecordFrame( buffer );
+	// nothing is published while the first frame records
+	ASSERT_FALSE( buffer.Occluded( 0, 0, 4, 4, 100.f ) );
+	buffer.EndFrame( Transform(), Point3f( 0, 0, 0 ), Vec3f( 0, 0, 1 ) );
+	ASSERT_TRUE( buffer.Valid() );
+	ASSERT_DOUBLE_EQ( buffer.OpaqueTileRatio(), 0.5 );
+
+	ASSERT_TRUE( buffer.Occluded( 0, 0, 15, 15, 11.f ) );
+	// in front of the opaque surface
+	ASSERT_FALSE( buffer.Occluded( 0, 0, 15, 15, 9.f ) );
+	// a footprint reaching into the transparent half
+	ASSERT_FALSE( buffer.Occluded( 10, 0, 17, 4, 11.f ) );
+	// clipped to the film, or off it
+	ASSERT_TRUE( buffer.Occluded( -20, -5, 3, 3, 11.f ) );
+	ASSERT_FALSE( buffer.Occluded( 40, 0, 50, 4, 11.f ) );
+
+	// the next frame records without disturbing the published one
+	buffer.BeginFrame( 32, 16 );
+	buffer.Record( 0, 0, NeverOpaque );
+	ASSERT_TRUE( buffer.Occluded( 0, 0, 4, 4, 11.f ) );
+	buffer.EndFrame( Transform(), Point3f( 0, 0, 0 ), Vec3f( 0, 0, 1 ) );
+	ASSERT_FALSE( buffer.Occluded( 0, 0, 4, 4, 11.f ) );
+}
+
+TEST( test_occlusionbuffer, resize_drops_the_published_frame )
+{
+	using namespace vm;
+	OcclusionBuffer buffer( 8 );
+	RecordFrame( buffer );
+	buffer.EndFrame( Transform(), Point3f( 0, 0, 0 ), Vec3f( 0, 0, 1 ) );
+	buffer.BeginFrame( 64, 16 );
+	ASSERT_FALSE( buffer.Valid() );
+	ASSERT_FALSE( buffer.Occluded( 0, 0, 4, 4, 11.f ) );
+}
+
+TEST( test_occlusionbuffer, boxes_through_a_perspective_camera )
+{
+	using namespace vm;
+	// the camera of the renderer: at z = 50 looking at the origin, +x to the right
+	constexpr int Width = 64, Height = 64;
+	const Point3f eye( 0, 0, 50 );
+	ViewingTransform camera( eye, Vec3f( 0, 1, 0 ), Point3f( 0, 0, 0 ) );
+	const auto screenToPerps = Translate( -1, 1, 0 ) * Scale( 2, -2, 1 ) * Scale( 1.0 / Width, 1.0 / Height, 1.0 );
+	const auto screenToWorld = camera.GetViewMatrixWrapper().LookAt().Inversed() * Perspective( 60, 1, 0.01, 1000 ).Inversed() * screenToPerps;
+
+	// the left half of the film turned opaque 20 from the eye
+	OcclusionBuffer buffer( 8 );
+	buffer.BeginFrame( Width, Height );
+	for ( int y = 0; y < Height; y++ ) {
+		for ( int x = 0; x < Width; x++ ) {
+			buffer.Record( x, y, x < Width / 2 ? 20.f : NeverOpaque );
+		}
+	}
+	buffer.EndFrame( screenToWorld.Inversed(), eye, camera.GetViewMatrixWrapper().GetFront() );
+
+	// around the origin, 45 from the eye, on the left, on the right and across the middle
+	ASSERT_TRUE( buffer.Occluded( Point3f( -10, -5, -5 ), Point3f( -5, 5, 5 ) ) );
+	ASSERT_FALSE( buffer.Occluded( Point3f( 5, -5, -5 ), Point3f( 10, 5, 5 ) ) );
+	ASSERT_FALSE( buffer.Occluded( Point3f( -10, -5, -5 ), Point3f( 5, 5, 5 ) ) );
+	// on the left but in front of the opaque distance
+	ASSERT_FALSE( buffer.Occluded( Point3f( -8, -2, 35 ), Point3f( -5, 2, 40 ) ) );
+	// reaching behind the eye
+	ASSERT_FALSE( buffer.Occluded( Point3f( -10, -5, -5 ), Point3f( -5, 5, 60 ) ) );
+}
@@ -0,0 +1,53 @@
+#include <gtest/gtest.h>
+#include <pixelorder.h>
+#include <cstdlib>
+
+namespace
+{
+void ExpectEachPixelOnce( const std::vector<vm::Vec2i> &pixels, int width, int height )
+{
+	ASSERT_EQ( pixels.size(), size_t( width ) * height );
+	std::vector<int> visited( size_t( width ) * height, 0 );
+	for ( const auto &p : pixels ) {
+		ASSERT_TRUE( p.x >= 0 && p.x < width && p.y >= 0 && p.y < height );
+		visited[ p.y * width + p.x ]++;
+	}
+	for ( const auto v : visited ) {
+		ASSERT_EQ( v, 1 );
+	}
+}
+}  // namespace
+
+TEST( test_pixelorder, cover_film )
+{
+	using namespace vm;
+	for ( const auto order : { PixelOrder::RowMajor, PixelOrder::Morton, PixelOrder::Hilbert } ) {
+		ExpectEachPixelOnce( GeneratePixelOrder( 64, 64, order, 16 ), 64, 64 );
+		// film size is not a multiple of tile size
+		ExpectEachPixelOnce( GeneratePixelOrder( 100, 37, order, 32 ), 100, 37 );
+		ExpectEachPixelOnce( GeneratePixelOrder( 7, 3, order, 5 ), 7, 3 );
+	}
+}
+
+TEST( test_pixelorder, hilbert_adjacent )
+{
+	using namespace vm;
+	const auto pixels = GeneratePixelOrder( 32, 32, PixelOrder::Hilbert, 32 );
+	for ( size_t i = 1; i < pixels.size(); i++ ) {
+		const auto d = std::abs( pixels[ i ].x - pixels[ i - 1 ].x ) + std::abs( pixels[ i ].y - pixels[ i - 1 ].y );
+		ASSERT_EQ( d, 1 );
+	}
+}
+
+TEST( test_pixelorder, morton_quadrants )
+{
+	using namespace vm;
+	const auto pixels = GeneratePixelOrder( 4, 4, PixelOrder::Morton, 4 );
+	// every group of 4 consecutive pixels is a 2x2 quad
+	for ( size_t i = 0; i < pixels.size(); i += 4 ) {
+		for ( size_t j = 1; j < 4; j++ ) {
+			ASSERT_EQ( pixels[ i + j ].x / 2, pixels[ i ].x / 2 );
+			ASSERT_EQ( pixels[ i + j ].y / 2, pixels[ i ].y / 2 );
+		}
+	}
+}
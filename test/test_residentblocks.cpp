@@ -0,0 +1,28 @@
+#include <gtest/gtest.h>
+#include <residentblocks.h>
+#include <vector>
+
+TEST( test_residentblocks, pointers_into_the_mapping )
+{
+	using namespace vm;
+	constexpr size_t blockBytes = 4096, blockCount = 16, headerBytes = 36;
+	std::vector<char> file( headerBytes + blockCount * blockBytes );
+	ResidentBlockTable table(
+	  [ & ]( size_t blockID ) -> const void * { return file.data() + headerBytes + blockID * blockBytes; },
+	  blockCount, blockBytes, true, false );
+	ASSERT_TRUE( table.Valid() );
+	ASSERT_EQ( table.BlockCount(), blockCount );
+	// no copy, later changes of the file are visible
+	file[ headerBytes + 3 * blockBytes ] = 42;
+	ASSERT_EQ( *(const char *)table.GetPage( 3 ), 42 );
+}
+
+TEST( test_residentblocks, missing_block )
+{
+	using namespace vm;
+	std::vector<char> file( 4 * 4096 );
+	ResidentBlockTable table(
+	  [ & ]( size_t blockID ) -> const void * { return blockID == 2 ? nullptr : file.data() + blockID * 4096; },
+	  4, 4096, false, false );
+	ASSERT_FALSE( table.Valid() );
+}
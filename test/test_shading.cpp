@@ -0,0 +1,98 @@
+#include <gtest/gtest.h>
+#include <shading.h>
+#include <algorithm>
+#include <random>
+
+TEST( test_shading, gradient_page_matches_estimate )
+{
+	using namespace vm;
+	constexpr int side = 32;
+	std::vector<unsigned char> block( side * side * side );
+	std::default_random_engine e;
+	std::uniform_int_distribution<int> u( 0, 255 );
+	for ( auto &v : block ) v = u( e );
+
+	std::vector<int8_t> page( GradientPageBytes( side ) );
+	ComputeGradientPage( block.data(), side, page.data() );
+
+	// at voxel centers the trilinear samples are exact, the page only drops the half
+	for ( int z = 0; z < side; z++ ) {
+		for ( int y = 0; y < side; y++ ) {
+			for ( int x = 0; x < side; x++ ) {
+				const Point3f p( x, y, z );
+				const auto expected = EstimateGradient( block.data(), side, p );
+				const auto cached = SampleGradientPage( page.data(), side, p );
+				ASSERT_NEAR( expected.x, cached.x, 0.5 );
+				ASSERT_NEAR( expected.y, cached.y, 0.5 );
+				ASSERT_NEAR( expected.z, cached.z, 0.5 );
+			}
+		}
+	}
+}
+
+TEST( test_shading, gradient_cache_lru )
+{
+	using namespace vm;
+	constexpr int side = 32;
+	std::vector<unsigned char> block( side * side * side, 0 );
+	GradientCache cache( side, 2 );
+	cache.GetPage( 0, block.data() );
+	cache.GetPage( 1, block.data() );
+	cache.GetPage( 0, block.data() );  // hit, 1 becomes the victim
+	cache.GetPage( 2, block.data() );
+	cache.GetPage( 0, block.data() );  // still resident
+	ASSERT_EQ( cache.HitCount(), 2 );
+	ASSERT_EQ( cache.MissCount(), 3 );
+	cache.GetPage( 1, block.data() );
+	ASSERT_EQ( cache.MissCount(), 4 );
+}
+
+TEST( test_shading, gradient_sidecar )
+{
+	using namespace vm;
+	ASSERT_EQ( GradientSidecarFileName( "data/foo.lvd" ), "data/foo.grad.lvd" );
+	ASSERT_EQ( GradientSidecarFileName( "data.v1/foo" ), "data.v1/foo.grad.lvd" );
+
+	constexpr int side = 32;
+	const auto planeBytes = GradientPageBytes( side ) / 3;
+	std::vector<unsigned char> block( side * side * side );
+	std::default_random_engine e;
+	std::uniform_int_distribution<int> u( 0, 255 );
+	for ( auto &v : block ) v = u( e );
+	std::vector<int8_t> page( GradientPageBytes( side ) );
+	ComputeGradientPage( block.data(), side, page.data() );
+
+	// what the sidecar stores, one block per component
+	std::vector<unsigned char> stored( GradientPageBytes( side ) );
+	for ( int c = 0; c < 3; c++ ) {
+		ToggleGradientBias( page.data() + c * planeBytes, stored.data() + c * planeBytes, planeBytes );
+	}
+	ASSERT_EQ( stored[ 0 ], ( unsigned char )( page[ 0 ] + 128 ) );
+
+	GradientCache cache( side, 1 );
+	cache.SetPageLoader( [ & ]( size_t blockID, int8_t *dst ) {
+		if ( blockID != 0 ) return false;
+		ToggleGradientBias( stored.data(), dst, stored.size() );
+		return true;
+	} );
+	// the loader is used for the loaded block, an empty scalar block shows it is not computed
+	std::vector<unsigned char> empty( block.size(), 0 );
+	const auto loaded = cache.GetPage( 0, empty.data() );
+	ASSERT_TRUE( std::equal( page.begin(), page.end(), loaded ) );
+	const auto computed = cache.GetPage( 1, empty.data() );
+	ASSERT_EQ( computed[ 0 ], 0 );
+}
+
+TEST( test_shading, shade )
+{
+	using namespace vm;
+	ShadingParams params;
+	const Vec3f diffuse( 1, 0.5, 0.25 );
+	const Vec3f light( 0, 0, 1 );
+	// the normal points against the gradient, a surface facing the light is fully lit
+	const auto lit = Shade( ShadingModel::BlinnPhong, params, diffuse, Vec3f( 0, 0, -10 ), light, light );
+	ASSERT_NEAR( lit.x, diffuse.x * ( params.ka + params.kd ) + params.ks, 1e-4 );
+	// no gradient, no shading
+	const auto flat = Shade( ShadingModel::Phong, params, diffuse, Vec3f( 0, 0, 0 ), light, light );
+	ASSERT_FLOAT_EQ( flat.y, diffuse.y );
+}
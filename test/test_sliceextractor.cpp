@@ -0,0 +1,166 @@
+#include <gtest/gtest.h>
+#include <sliceextractor.h>
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <thread>
+#include <vector>
+
+namespace
+{
+constexpr int Side = 8;
+
+/**
+ * @brief 2x2x2 blocks, voxel ( x, y, z ) of the grid holds ( 3x + 5y + 7z ) % 256
+ */
+std::vector<std::vector<uint8_t>> MakeBlocks()
+{
+	std::vector<std::vector<uint8_t>> blocks( 8, std::vector<uint8_t>( Side * Side * Side ) );
+	for ( int b = 0; b < 8; b++ ) {
+		for ( int z = 0; z < Side; z++ ) {
+			for ( int y = 0; y < Side; y++ ) {
+				for ( int x = 0; x < Side; x++ ) {
+					const int gx = x + ( b & 1 ) * Side, gy = y + ( b >> 1 & 1 ) * Side, gz = z + ( b >> 2 ) * Side;
+					blocks[ b ][ ( z * Side + y ) * Side + x ] = ( 3 * gx + 5 * gy + 7 * gz ) % 256;
+				}
+			}
+		}
+	}
+	return blocks;
+}
+
+float Voxel( const std::vector<uint8_t> &block, int x, int y, int z )
+{
+	x = std::min( x, Side - 1 );
+	y = std::min( y, Side - 1 );
+	z = std::min( z, Side - 1 );
+	return block[ ( z * Side + y ) * Side + x ];
+}
+
+/**
+ * @brief Samples in the block of the voxel, repeating its edge voxels beyond it
+ */
+float Reference( const std::vector<std::vector<uint8_t>> &blocks, float x, float y, float z )
+{
+	const int vx = int( std::floor( x ) ), vy = int( std::floor( y ) ), vz = int( std::floor( z ) );
+	if ( vx < 0 || vy < 0 || vz < 0 || vx >= 2 * Side || vy >= 2 * Side || vz >= 2 * Side ) {
+		return 0;
+	}
+	const auto &block = blocks[ vx / Side + 2 * ( vy / Side ) + 4 * ( vz / Side ) ];
+	const float lx = x - vx / Side * Side, ly = y - vy / Side * Side, lz = z - vz / Side * Side;
+	const int ix = int( lx ), iy = int( ly ), iz = int( lz );
+	const float fx = lx - ix, fy = ly - iy, fz = lz - iz;
+	float value = 0;
+	for ( int k = 0; k < 8; k++ ) {
+		const int dx = k & 1, dy = k >> 1 & 1, dz = k >> 2;
+		value += Voxel( block, ix + dx, iy + dy, iz + dz ) * ( dx ? fx : 1 - fx ) * ( dy ? fy : 1 - fy ) * ( dz ? fz : 1 - fz );
+	}
+	return value;
+}
+}  // namespace
+
+TEST( test_sliceextractor, axis_aligned_slices_copy_voxels )
+{
+	using namespace vm;
+	const auto blocks = MakeBlocks();
+	SliceExtractor extractor( [ &blocks ]( size_t id ) { return blocks[ id ].data(); }, Vec3i( 2, 2, 2 ), Side, 3 );
+	const Vec3i size( 2 * Side, 2 * Side, 2 * Side );
+	for ( int axis = 0; axis < 3; axis++ ) {
+		const auto plane = AxisAlignedSlice( axis, 11, size );
+		ASSERT_EQ( plane.width, 2 * Side );
+		ASSERT_EQ( plane.height, 2 * Side );
+		std::vector<uint8_t> slice( plane.width * plane.height );
+		extractor.Extract( plane, slice.data() );
+		// only the layer of blocks holding the slice
+		ASSERT_EQ( extractor.FetchedBlockCount(), 4 );
+		for ( int y = 0; y < plane.height; y++ ) {
+			for ( int x = 0; x < plane.width; x++ ) {
+				const auto p = plane.origin + plane.u * x + plane.v * y;
+				ASSERT_EQ( slice[ y * plane.width + x ], ( 3 * int( p.x ) + 5 * int( p.y ) + 7 * int( p.z ) ) % 256 );
+			}
+		}
+	}
+}
+
+TEST( test_sliceextractor, oblique_slices_interpolate_within_blocks )
+{
+	using namespace vm;
+	const auto blocks = MakeBlocks();
+	SliceExtractor extractor( [ &blocks ]( size_t id ) { return blocks[ id ].data(); }, Vec3i( 2, 2, 2 ), Side, 4 );
+	SlicePlane plane;
+	plane.origin = Point3f( -1.25f, 0.5f, 3.3f );
+	plane.u = Vec3f( 0.7f, 0.1f, 0.05f );
+	plane.v = Vec3f( 0.f, 0.6f, 0.45f );
+	plane.width = 29;
+	plane.height = 23;
+	std::vector<uint8_t> slice( plane.width * plane.height );
+	extractor.Extract( plane, slice.data() );
+	for ( int y = 0; y < plane.height; y++ ) {
+		for ( int x = 0; x < plane.width; x++ ) {
+			const float px = plane.origin.x + plane.v.x * y + plane.u.x * x;
+			const float py = plane.origin.y + plane.v.y * y + plane.u.y * x;
+			const float pz = plane.origin.z + plane.v.z * y + plane.u.z * x;
+			ASSERT_NEAR( slice[ y * plane.width + x ], Reference( blocks, px, py, pz ), 0.51f ) << x << " " << y;
+		}
+	}
+}
+
+TEST( test_sliceextractor, missing_blocks_and_outside_are_zero )
+{
+	using namespace vm;
+	const auto blocks = MakeBlocks();
+	SliceExtractor extractor( [ &blocks ]( size_t id ) { return id == 0 ? nullptr : blocks[ id ].data(); }, Vec3i( 2, 2, 2 ), Side, 2 );
+	const auto plane = ObliqueSlice( Point3f( Side, Side, 2 ), Vec3f( 1, 0, 0 ), Vec3f( 0, 1, 0 ), 4 * Side, 4 * Side, 1.f );
+	std::vector<uint8_t> slice( plane.width * plane.height, 1 );
+	extractor.Extract( plane, slice.data() );
+	ASSERT_EQ( extractor.FetchedBlockCount(), 4 );
+	// rows run downwards, block 0 shows in the lower left of the film
+	const int cx = plane.width / 2, cy = plane.height / 2;
+	ASSERT_EQ( slice[ 0 ], 0 );
+	ASSERT_EQ( slice[ ( cy + 2 ) * plane.width + cx - 2 ], 0 );
+	ASSERT_EQ( slice[ ( cy - 3 ) * plane.width + cx + 2 ], ( 3 * ( Side + 2 ) + 5 * ( Side + 3 ) + 7 * 2 ) % 256 );
+}
+
+TEST( test_sliceextractor, pages_may_be_evicted_by_the_next_fetch )
+{
+	using namespace vm;
+	const auto blocks = MakeBlocks();
+	// a cache of one page: every fetch evicts the page of the previous one before it loads
+	std::vector<uint8_t> cached( Side * Side * Side );
+	auto Fetch = [ & ]( size_t id ) {
+		std::fill( cached.begin(), cached.end(), uint8_t( 0xff ) );
+		std::this_thread::sleep_for( std::chrono::microseconds( 100 ) );
+		cached = blocks[ id ];
+		return cached.data();
+	};
+	SliceExtractor extractor( Fetch, Vec3i( 2, 2, 2 ), Side, 4 );
+	const Vec3i size( 2 * Side, 2 * Side, 2 * Side );
+	const auto plane = AxisAlignedSlice( 2, 5, size );
+	std::vector<uint8_t> slice( plane.width * plane.height );
+	for ( int i = 0; i < 20; i++ ) {
+		extractor.Extract( plane, slice.data() );
+		for ( int y = 0; y < plane.height; y++ ) {
+			for ( int x = 0; x < plane.width; x++ ) {
+				const auto p = plane.origin + plane.u * x + plane.v * y;
+				ASSERT_EQ( slice[ y * plane.width + x ], ( 3 * int( p.x ) + 5 * int( p.y ) + 7 * int( p.z ) ) % 256 );
+			}
+		}
+	}
+}
+
+TEST( test_sliceextractor, uniform_volume_slices_have_no_seams )
+{
+	using namespace vm;
+	constexpr int side = 16, count = 4;
+	const std::vector<uint8_t> block( side * side * side, 100 );
+	SliceExtractor extractor( [ &block ]( size_t ) { return block.data(); }, Vec3i( count, count, count ), side, 4 );
+	const float center = count * side / 2.f;
+	const auto plane = ObliqueSlice( Point3f( center, center, center ), Vec3f( 1, 0.3f, 0.2f ), Vec3f( -0.1f, 1, 0.4f ), 48, 48, 1.f );
+	std::vector<uint8_t> slice( plane.width * plane.height );
+	extractor.Extract( plane, slice.data() );
+	for ( int y = 0; y < plane.height; y++ ) {
+		for ( int x = 0; x < plane.width; x++ ) {
+			ASSERT_EQ( slice[ y * plane.width + x ], 100 ) << x << " " << y;
+		}
+	}
+}
@@ -0,0 +1,42 @@
+#include <gtest/gtest.h>
+#include <timeseries.h>
+
+TEST( test_timeseries, quality_before_frames )
+{
+	using namespace vm;
+	FrameRateController controller( 0.1, 0.01f, 8 );
+	ASSERT_FLOAT_EQ( controller.Step(), 0.01f );
+
+	// twice over budget: the step grows first and no timestep is skipped
+	ASSERT_EQ( controller.Update( 0.2 ), 1 );
+	ASSERT_GT( controller.Step(), 0.02f );
+	ASSERT_LE( controller.Step(), 0.08f );
+
+	// far over budget: the step saturates, only then frames are dropped
+	ASSERT_EQ( controller.Update( 5.0 ), 1 );
+	ASSERT_FLOAT_EQ( controller.Step(), 0.08f );
+	ASSERT_EQ( controller.Update( 0.35 ), 3 );
+
+	// fast frames bring the quality back step by step
+	float previous = controller.Step();
+	for ( int i = 0; i < 20; i++ ) {
+		ASSERT_EQ( controller.Update( 0.001 ), 1 );
+		ASSERT_LE( controller.Step(), previous );
+		previous = controller.Step();
+	}
+	ASSERT_FLOAT_EQ( controller.Step(), 0.01f );
+}
+
+TEST( test_timeseries, steady_state )
+{
+	using namespace vm;
+	FrameRateController controller( 0.1, 0.01f, 8 );
+	// render time proportional to 1 / step, 0.3(s) at the base step
+	double seconds = 0;
+	for ( int i = 0; i < 50; i++ ) {
+		seconds = 0.3 * 0.01 / controller.Step();
+		ASSERT_EQ( controller.Update( seconds ), 1 );
+	}
+	ASSERT_LE( seconds, 0.1 );
+	ASSERT_GE( seconds, 0.05 );
+}
@@ -0,0 +1,124 @@
+#include <gtest/gtest.h>
+#include <virtualpagetable.h>
+#include <cstring>
+
+namespace
+{
+bool FillWithID( size_t blockID, void *page )
+{
+	memset( page, int( blockID ), 16 );
+	return true;
+}
+}  // namespace
+
+TEST( test_virtualpagetable, miss_then_refine )
+{
+	using namespace vm;
+	VirtualPageTable table( 8, 16, 4 );
+	ASSERT_EQ( table.Lookup( 3 ), nullptr );
+	ASSERT_EQ( table.Lookup( 3 ), nullptr );  // recorded once
+	ASSERT_EQ( table.Lookup( 5 ), nullptr );
+	ASSERT_EQ( table.MissedBlockCount(), 2 );
+
+	ASSERT_EQ( table.Refine( FillWithID ), 2 );
+	ASSERT_EQ( table.MissedBlockCount(), 0 );
+	auto page = (const unsigned char *)table.Lookup( 3 );
+	ASSERT_NE( page, nullptr );
+	ASSERT_EQ( page[ 0 ], 3 );
+	page = (const unsigned char *)table.Lookup( 5 );
+	ASSERT_NE( page, nullptr );
+	ASSERT_EQ( page[ 15 ], 5 );
+}
+
+TEST( test_virtualpagetable, batch_larger_than_pool )
+{
+	using namespace vm;
+	VirtualPageTable table( 8, 16, 2 );
+	for ( size_t i = 0; i < 5; i++ ) {
+		table.Lookup( i );
+	}
+	// only two fit, the others have to be missed again
+	ASSERT_EQ( table.Refine( FillWithID ), 2 );
+	size_t mapped = 0;
+	for ( size_t i = 0; i < 5; i++ ) {
+		mapped += table.Mapped( i );
+	}
+	ASSERT_EQ( mapped, 2 );
+	ASSERT_EQ( table.Lookup( 4 ), nullptr );
+	ASSERT_EQ( table.MissedBlockCount(), 1 );
+}
+
+TEST( test_virtualpagetable, clock_keeps_referenced_pages )
+{
+	using namespace vm;
+	VirtualPageTable table( 8, 16, 3 );
+	for ( size_t i = 0; i < 3; i++ ) {
+		table.Lookup( i );
+	}
+	table.Refine( FillWithID );
+
+	// all pages start referenced, the clock clears every bit and takes the first page
+	table.Lookup( 3 );
+	table.Refine( FillWithID );
+	ASSERT_TRUE( table.Mapped( 3 ) );
+	ASSERT_FALSE( table.Mapped( 0 ) );
+
+	// of the pages that lost their bit only 1 is used again before the next miss
+	ASSERT_NE( table.Lookup( 1 ), nullptr );
+	table.Lookup( 6 );
+	table.Refine( FillWithID );
+	ASSERT_TRUE( table.Mapped( 6 ) );
+	ASSERT_TRUE( table.Mapped( 1 ) );
+	ASSERT_FALSE( table.Mapped( 2 ) );
+	ASSERT_TRUE( table.Mapped( 3 ) );
+	ASSERT_EQ( table.LoadedBlockCount(), 5 );
+}
+
+TEST( test_virtualpagetable, demoted_pages_are_evicted_first )
+{
+	using namespace vm;
+	VirtualPageTable table( 8, 16, 3 );
+	for ( size_t i = 0; i < 3; i++ ) {
+		table.Lookup( i );
+	}
+	table.Refine( FillWithID );
+	ASSERT_FALSE( table.Demote( 5 ) );
+
+	// the clock would take page 0 first
+	ASSERT_TRUE( table.Demote( 2 ) );
+	table.Lookup( 5 );
+	table.Refine( FillWithID );
+	ASSERT_FALSE( table.Mapped( 2 ) );
+	ASSERT_TRUE( table.Mapped( 0 ) && table.Mapped( 1 ) && table.Mapped( 5 ) );
+
+	// a lookup after the demotion keeps the page
+	ASSERT_TRUE( table.Demote( 1 ) );
+	ASSERT_NE( table.Lookup( 1 ), nullptr );
+	table.Lookup( 6 );
+	table.Refine( FillWithID );
+	ASSERT_TRUE( table.Mapped( 1 ) );
+	ASSERT_TRUE( table.Mapped( 6 ) );
+}
+
+TEST( test_virtualpagetable, hidden_pages_are_demoted_once )
+{
+	using namespace vm;
+	VirtualPageTable table( 8, 16, 3 );
+	for ( size_t i = 0; i < 3; i++ ) {
+		table.Lookup( i );
+	}
+	table.Refine( FillWithID );
+	// a block hidden frame after frame, with and without lookups in between
+	for ( int frame = 0; frame < 100; frame++ ) {
+		if ( frame % 2 ) {
+			table.Lookup( 2 );
+		}
+		ASSERT_TRUE( table.Demote( 2 ) );
+	}
+	ASSERT_EQ( table.DemotedPageCount(), 1 );
+	table.Lookup( 5 );
+	table.Refine( FillWithID );
+	ASSERT_EQ( table.DemotedPageCount(), 0 );
+	ASSERT_FALSE( table.Mapped( 2 ) );
+	ASSERT_TRUE( table.Mapped( 5 ) );
+}
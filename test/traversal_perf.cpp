@@ -0,0 +1,62 @@
+#include <VMUtils/timer.hpp>
+#include <VMat/geometry.h>
+#include <gridtraversal.h>
+#include <iostream>
+#include <string>
+
+/**
+ * Compares walking the block grid with the VMat interval iterator, with the 3D-DDA clipping
+ * every ray itself and with the 3D-DDA starting from the shared entries of 8 x 8 pixel tiles.
+ * Rays leave a pinhole camera looking at a 1024^3 volume of 64^3 blocks, from outside and
+ * from inside the volume. Prints the rays per second and the cells visited, which have to
+ * agree between all three.
+ *
+ * usage: traversal_perf [film side] [repetitions]
+ */
+
+int main( int argc, char **argv )
+{
+	using namespace vm;
+	const int side = argc > 1 ? std::stoi( argv[ 1 ] ) : 1024;
+	const int repetitions = argc > 2 ? std::stoi( argv[ 2 ] ) : 3;
+	const Bound3i bound( Point3i( 0, 0, 0 ), Point3i( 1024, 1024, 1024 ) );
+	const Vec3i gridCount( 16, 16, 16 );
+	const auto grid = bound.GenGrid( gridCount );
+	GridTraversal traversal( Point3f( 0, 0, 0 ), Point3f( 1024, 1024, 1024 ), gridCount );
+
+	for ( const auto eye : { Point3f( -700, 300, 450 ), Point3f( 500, 520, 480 ) } ) {
+		// the film spans 90 degrees
+		auto Direction = [ side ]( int x, int y ) {
+			return Vec3f( 1.f, 2.f * ( y + 0.5f ) / side - 1.f, 2.f * ( x + 0.5f ) / side - 1.f );
+		};
+		auto Run = [ & ]( const char *name, auto start ) {
+			size_t cells = 0;
+			Timer timer;
+			timer.start();
+			for ( int r = 0; r < repetitions; r++ ) {
+				for ( int y = 0; y < side; y++ ) {
+					for ( int x = 0; x < side; x++ ) {
+						auto iter = start( x, y, Direction( x, y ) );
+						while ( iter.Valid() ) {
+							++iter;
+							cells++;
+						}
+					}
+				}
+			}
+			const double sec = timer.elapsed().s();
+			std::cout << "  " << name << ": " << double( side ) * side * repetitions / sec / 1e6 << " Mrays/s, "
+					  << cells / repetitions << " cells per frame\n";
+		};
+		std::cout << "eye " << eye.x << " " << eye.y << " " << eye.z << ", " << side << "^2 rays\n";
+		Run( "VMat iterator", [ & ]( int, int, const Vec3f &d ) { return grid.IntersectWith( Ray( d, eye ) ); } );
+		Run( "3D-DDA", [ & ]( int, int, const Vec3f &d ) { return traversal.IntersectWith( eye, d ); } );
+		Timer timer;
+		timer.start();
+		traversal.PrepareTiles( eye, side, side, 8, Direction );
+		std::cout << "  tiles prepared in " << timer.elapsed().s() << "(s), " << traversal.SharedTileCount() << " of "
+				  << traversal.TileCount() << " share their entry\n";
+		Run( "3D-DDA, tiles", [ & ]( int x, int y, const Vec3f &d ) { return traversal.Start( x, y, d ); } );
+	}
+	return 0;
+}